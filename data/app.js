@@ -66,6 +66,51 @@ class ApiService {
     const response = await this.request(path);
     return response.json();
   }
+
+  async getBinary(path) {
+    const response = await this.request(path);
+    return response.arrayBuffer();
+  }
+}
+
+// ============================================================================
+// Binary power log (/api/log_data?format=bin)
+// ============================================================================
+
+/**
+ * Decodes the binary log format into the same shape as the JSON response.
+ * Columns are little-endian and 4-byte aligned after a 16-byte header, so
+ * they are read as typed array views without copying.
+ */
+function decodePowerLog(buffer) {
+  const view = new DataView(buffer);
+  const magic = String.fromCharCode(...new Uint8Array(buffer, 0, 4));
+  if (magic !== 'PLOG' || view.getUint8(4) !== 2) {
+    throw new Error('Unsupported log format');
+  }
+  const headerSize = view.getUint16(6, true);
+  const count = view.getUint32(8, true);
+  if (buffer.byteLength !== headerSize + count * 6 * 4) {
+    throw new Error('Incomplete log data');  // Streamed range was overwritten
+  }
+  const column = (Type, index) => new Type(buffer, headerSize + index * count * 4, count);
+
+  // Rounded like the JSON format so tooltips don't show float noise
+  const rounded = (values, decimals) => {
+    const f = 10 ** decimals;
+    return Array.from(values, v => Math.round(v * f) / f);
+  };
+
+  return {
+    seq: view.getUint32(12, true),
+    reset: (view.getUint8(5) & 0x01) !== 0,
+    timestamps: Array.from(column(Uint32Array, 0)),
+    power: rounded(column(Float32Array, 1), 2),
+    energy: rounded(column(Float32Array, 2), 3),
+    cost: rounded(column(Float32Array, 3), 4),
+    min: rounded(column(Float32Array, 4), 2),
+    max: rounded(column(Float32Array, 5), 2)
+  };
 }
 
 // ============================================================================
@@ -90,9 +135,13 @@ class AppState {
       relayIp: '',
       deviceIp: '',
       wifiSsid: '',
+      offState: 'none',
+      relaysJson: '[]',
+      offElapsedMs: 0,
       loggingEnabled: false,
       logCount: 0,
       logMaxCount: 0,
+      logSpan: 0,
       logDuration: 0
     };
     
@@ -187,15 +236,19 @@ class UIController {
       logDurationInfo: document.getElementById('logDurationInfo'),
       tariffHigh: document.getElementById('tariffHigh'),
       tariffLow: document.getElementById('tariffLow'),
+      tariffMid: document.getElementById('tariffMid'),
       tariffCurrency: document.getElementById('tariffCurrency'),
       tariffStartHour: document.getElementById('tariffStartHour'),
       tariffEndHour: document.getElementById('tariffEndHour'),
+      tariffSchedule: document.getElementById('tariffSchedule'),
       authUsername: document.getElementById('authUsername'),
       authPassword: document.getElementById('authPassword'),
       logStats: document.getElementById('logStats'),
       logCount: document.getElementById('logCount'),
       logDuration: document.getElementById('logDuration'),
-      logTotalEnergy: document.getElementById('logTotalEnergy')
+      logTotalEnergy: document.getElementById('logTotalEnergy'),
+      auxRelayCard: document.getElementById('auxRelayCard'),
+      auxRelayList: document.getElementById('auxRelayList')
     };
   }
 
@@ -225,6 +278,19 @@ class UIController {
       this.elements.btnSaveIp.addEventListener('click', () => this.saveRelayIp());
     }
     
+    document.querySelectorAll('.btn-save-aux').forEach(btn => {
+      btn.addEventListener('click', () => this.saveAuxRelay(parseInt(btn.dataset.relay, 10)));
+    });
+    
+    if (this.elements.auxRelayList) {
+      this.elements.auxRelayList.addEventListener('click', (e) => {
+        const btn = e.target.closest('button[data-relay]');
+        if (btn) {
+          this.api.call(`/api/relay_cmd?id=${btn.dataset.relay}&cmd=${btn.dataset.cmd}`);
+        }
+      });
+    }
+    
     if (this.elements.btnResetWifi) {
       this.elements.btnResetWifi.addEventListener('click', () => this.resetWifi());
     }
@@ -298,6 +364,7 @@ class UIController {
     this.renderTimer(state);
     this.renderRelay(state);
     this.renderRelayReport(state);
+    this.renderAuxRelays(state);
     this.renderNetworkInfo(state);
     this.renderWarnings(state);
     this.renderLogging(state);
@@ -347,8 +414,17 @@ class UIController {
 
   renderRelay(state) {
     const isOn = state.reportValid ? state.relayState : null;
-    const text = isOn === null ? '?' : (isOn ? 'ON' : 'OFF');
-    const className = isOn === null ? 'bg-secondary' : (isOn ? 'bg-success' : 'bg-danger');
+    let text = isOn === null ? '?' : (isOn ? 'ON' : 'OFF');
+    let className = isOn === null ? 'bg-secondary' : (isOn ? 'bg-success' : 'bg-danger');
+    
+    // OFF command sent but not yet confirmed by the relay report
+    if (state.offState === 'pending') {
+      text = 'OFF…';
+      className = 'bg-warning';
+    } else if (state.offState === 'failed' && isOn) {
+      text = 'OFF FAILED';
+      className = 'bg-danger';
+    }
     
     if (this.elements.relayStateBadge) {
       this.elements.relayStateBadge.textContent = text;
@@ -387,6 +463,62 @@ class UIController {
     }
   }
 
+  renderAuxRelays(state) {
+    let relays = [];
+    try {
+      relays = JSON.parse(state.relaysJson);
+    } catch (error) {
+      return;
+    }
+    const aux = relays.filter(r => r.id !== 0);
+    const printer = relays.find(r => r.id === 0);
+    const driver0 = document.getElementById('relayDriver0');
+    if (printer && driver0 && document.activeElement !== driver0 && !driver0.dataset.loaded) {
+      driver0.value = printer.driver;
+      driver0.dataset.loaded = '1';
+    }
+    
+    if (this.elements.auxRelayCard) {
+      this.elements.auxRelayCard.style.display = aux.length ? 'block' : 'none';
+    }
+    if (this.elements.auxRelayList) {
+      this.elements.auxRelayList.innerHTML = aux.map(r => {
+        const isOn = r.report_valid ? r.relay : null;
+        let text = isOn === null ? '?' : (isOn ? 'ON' : 'OFF');
+        let className = isOn === null ? 'bg-secondary' : (isOn ? 'bg-success' : 'bg-danger');
+        if (r.off_state === 'pending') {
+          text = 'OFF…';
+          className = 'bg-warning';
+        }
+        const power = r.report_valid ? `${r.power.toFixed(1)} W` : '-';
+        const offInMs = Math.max(0, r.off_delay_ms - state.offElapsedMs);
+        const countdown = r.off_armed ? ` · off in ${Math.ceil(offInMs / 60000)} min` : '';
+        return `<div class='d-flex align-items-center gap-2 mb-2'>
+            <span class='chip ${className} text-light'>${text}</span>
+            <span class='flex-fill'>${r.name}<br><span class='text-muted'>${power}${countdown}</span></span>
+            <button class='btn btn-sm btn-success' data-relay='${r.id}' data-cmd='on' type='button'><i class='bi bi-lightning-charge'></i></button>
+            <button class='btn btn-sm btn-danger' data-relay='${r.id}' data-cmd='off' type='button'><i class='bi bi-power'></i></button>
+          </div>`;
+      }).join('');
+    }
+    
+    // Fill the settings form, but never overwrite a field being edited
+    aux.forEach(r => {
+      const fill = (id, apply) => {
+        const el = document.getElementById(id);
+        if (el && document.activeElement !== el && !el.dataset.loaded) {
+          apply(el);
+          el.dataset.loaded = '1';
+        }
+      };
+      fill(`auxName${r.id}`, el => { el.value = r.name; });
+      fill(`auxIp${r.id}`, el => { el.value = r.ip; });
+      fill(`auxAuto${r.id}`, el => { el.checked = r.auto_off; });
+      fill(`auxDriver${r.id}`, el => { el.value = r.driver; });
+      fill(`auxDelay${r.id}`, el => { el.value = Math.round(r.off_delay_ms / 60000); });
+    });
+  }
+
   renderNetworkInfo(state) {
     if (state.deviceIp && this.elements.deviceIp) {
       this.elements.deviceIp.textContent = state.deviceIp;
@@ -464,6 +596,7 @@ class UIController {
         this.elements.logStats.style.display = 'block';
         if (this.elements.logCount) {
           this.elements.logCount.textContent = `${state.logCount} / ${state.logMaxCount}`;
+          this.elements.logCount.title = `History: ${Math.floor(state.logSpan / 60000)}m`;
         }
         if (this.elements.logDuration && state.loggingEnabled) {
           const minutes = Math.floor(state.logDuration / 60000);
@@ -484,12 +617,33 @@ class UIController {
     
     try {
       await this.api.call(`/api/set_relay_ip?ip=${encodeURIComponent(ip)}`);
+      const driver = document.getElementById('relayDriver0');
+      if (driver) {
+        await this.api.call(`/api/relay_set?id=0&driver=${driver.value}`);
+      }
       await new Promise(resolve => setTimeout(resolve, 500));
     } catch (error) {
       alert('Failed to save IP address');
     }
   }
 
+  async saveAuxRelay(id) {
+    const name = document.getElementById(`auxName${id}`).value.trim();
+    const ip = document.getElementById(`auxIp${id}`).value.trim();
+    const autoOff = document.getElementById(`auxAuto${id}`).checked ? 1 : 0;
+    const delay = parseInt(document.getElementById(`auxDelay${id}`).value, 10) || 10;
+    const driver = document.getElementById(`auxDriver${id}`).value;
+    
+    let query = `id=${id}&ip=${encodeURIComponent(ip)}&driver=${driver}&auto_off=${autoOff}&delay_min=${delay}`;
+    if (name) query += `&name=${encodeURIComponent(name)}`;
+    
+    try {
+      await this.api.call(`/api/relay_set?${query}`);
+    } catch (error) {
+      alert('Failed to save relay settings');
+    }
+  }
+
   async resetWifi() {
     if (!confirm('This will reset WiFi settings and restart the device. You will need to reconnect to the "M5Stack-AutoOff" access point to reconfigure. Continue?')) {
       return;
@@ -539,22 +693,38 @@ class UIController {
     const high = this.elements.tariffHigh.value;
     const low = this.elements.tariffLow.value;
     const curr = this.elements.tariffCurrency.value.trim();
+    const mid = this.elements.tariffMid.value;
     const start = this.elements.tariffStartHour.value;
     const end = this.elements.tariffEndHour.value;
+    const schedule = this.elements.tariffSchedule.value.trim();
     
     if (!high || !low || !curr) {
       alert('Please fill in all tariff fields');
       return;
     }
     
-    if (parseFloat(high) <= 0 || parseFloat(low) <= 0) {
+    if (parseFloat(high) <= 0 || parseFloat(low) <= 0 || (mid && parseFloat(mid) <= 0)) {
       alert('Tariff values must be positive numbers');
       return;
     }
     
     try {
-      const url = `/api/tariff_set?high=${encodeURIComponent(high)}&low=${encodeURIComponent(low)}&currency=${encodeURIComponent(curr)}&start=${encodeURIComponent(start)}&end=${encodeURIComponent(end)}`;
+      const prices = mid ? [high, low, mid] : [high, low];
+      let url = `/api/tariff_set?prices=${encodeURIComponent(prices.join(','))}&currency=${encodeURIComponent(curr)}`;
+      // An edited schedule wins, otherwise a changed low window replaces it on every day
+      const loaded = (window.app && window.app.tariffManager && window.app.tariffManager.loaded) || {};
+      if (schedule !== loaded.schedule) {
+        url += `&schedule=${encodeURIComponent(schedule)}`;
+      } else if (start !== String(loaded.start_hour) || end !== String(loaded.end_hour)) {
+        url += `&start=${encodeURIComponent(start)}&end=${encodeURIComponent(end)}`;
+      }
       await this.api.request(url);
+      if (window.app && window.app.tariffManager) {
+        await window.app.tariffManager.load();  // Schedule as compiled by the device
+      }
+      if (window.app && window.app.powerGraph) {
+        window.app.powerGraph.setCurrency(curr);
+      }
       alert('Tariff settings saved successfully!');
     } catch (error) {
       alert('Failed to save tariff settings: ' + error.message);
@@ -594,22 +764,26 @@ class UIController {
 
   async loadAutoLog() {
     try {
-      const data = await this.api.getJson('/api/autolog_get');
-      if (data.enabled !== undefined) {
-        this.elements.autoLogEnabled.checked = data.enabled;
-      }
-      if (data.threshold !== undefined) {
-        this.elements.autoLogThreshold.value = data.threshold;
-      }
-      if (data.debounce !== undefined) {
-        this.elements.autoLogDebounce.value = data.debounce;
-      }
-      console.log('[UI] Auto-logging settings loaded:', data);
+      this.applyAutoLog(await this.api.getJson('/api/autolog_get'));
     } catch (error) {
       console.error('[UI] Failed to load auto-logging settings:', error);
     }
   }
 
+  /** Fill the form from a /api/autolog_get document */
+  applyAutoLog(data) {
+    if (data.enabled !== undefined) {
+      this.elements.autoLogEnabled.checked = data.enabled;
+    }
+    if (data.threshold !== undefined) {
+      this.elements.autoLogThreshold.value = data.threshold;
+    }
+    if (data.debounce !== undefined) {
+      this.elements.autoLogDebounce.value = data.debounce;
+    }
+    console.log('[UI] Auto-logging settings loaded:', data);
+  }
+
   async saveLogInterval() {
     const interval = this.elements.logInterval.value;
     
@@ -636,36 +810,49 @@ class UIController {
 
   async loadLogInterval() {
     try {
-      const data = await this.api.getJson('/api/loginterval_get');
-      if (data.interval !== undefined) {
-        this.elements.logInterval.value = data.interval;
-        this.updateLogDurationInfo(data.interval, data.maxMinutes);
-      }
-      console.log('[UI] Log interval loaded:', data);
+      this.applyLogInterval(await this.api.getJson('/api/loginterval_get'));
     } catch (error) {
       console.error('[UI] Failed to load log interval:', error);
     }
   }
 
+  /** Fill the form from a /api/loginterval_get document */
+  applyLogInterval(data) {
+    if (data.maxEntries !== undefined) {
+      this.logMaxEntries = data.maxEntries;
+    }
+    if (data.rollupMinutes !== undefined) {
+      this.logRollupMinutes = data.rollupMinutes;
+    }
+    if (data.interval !== undefined) {
+      this.elements.logInterval.value = data.interval;
+      this.updateLogDurationInfo(data.interval, data.maxMinutes);
+    }
+    console.log('[UI] Log interval loaded:', data);
+  }
+
   updateLogDurationInfo(interval, maxMinutes) {
     if (!this.elements.logDurationInfo) return;
     
     // If called from input event, calculate from input value
+    const maxEntries = this.logMaxEntries || 360;
     if (!interval) {
       interval = parseInt(this.elements.logInterval.value) || 10;
-      maxMinutes = Math.floor((500 * interval) / 60);
+      maxMinutes = Math.floor((maxEntries * interval) / 60);
     }
+    const historyMinutes = Math.max(maxMinutes, this.logRollupMinutes || 0);
     
-    const hours = Math.floor(maxMinutes / 60);
-    const minutes = maxMinutes % 60;
+    const formatMinutes = (total) => {
+      const hours = Math.floor(total / 60);
+      const minutes = total % 60;
+      return hours > 0 ? `${hours}h ${minutes}m` : `${minutes} minutes`;
+    };
     
-    let durationText = 'Maximum log duration: ';
-    if (hours > 0) {
-      durationText += `${hours}h ${minutes}m`;
-    } else {
-      durationText += `${minutes} minutes`;
+    let durationText = `Full resolution: ${formatMinutes(maxMinutes)}`;
+    durationText += ` (${maxEntries} data points × ${interval}s interval)`;
+    if (historyMinutes > maxMinutes) {
+      durationText += `, older data as 1-min/10-min averages up to ${formatMinutes(historyMinutes)}`;
     }
-    durationText += ` (500 data points × ${interval}s interval)`;
     
     this.elements.logDurationInfo.textContent = durationText;
   }
@@ -710,10 +897,15 @@ class UIController {
 // Status Poller
 // ============================================================================
 
+/**
+ * Fallback while the event stream is down: fetches status and log status
+ * with one /api/batch request per interval.
+ */
 class StatusPoller {
-  constructor(api, state, interval = 500) {
+  constructor(api, state, logStatus, interval = 500) {
     this.api = api;
     this.state = state;
+    this.logStatus = logStatus;
     this.interval = interval;
     this.timerId = null;
     this.isRunning = false;
@@ -738,29 +930,37 @@ class StatusPoller {
 
   async poll() {
     try {
-      const data = await this.api.getJson('/api/status');
-      
-      this.state.update({
-        autoMode: data.auto_mode,
-        timerRunning: data.timer,
-        remainingMs: data.remaining_ms,
-        totalMs: data.total_ms,
-        timerMinutes: data.timer_minutes,
-        relayState: data.relay,
-        reportValid: data.report_valid,
-        power: data.power || 0,
-        ws: data.ws || 0,
-        temperature: data.temperature || 0,
-        energyBoot: data.energy_boot || 0,
-        timeBoot: data.time_boot || 0,
-        relayIp: data.relay_ip || '',
-        deviceIp: data.device_ip || '',
-        wifiSsid: data.wifi_ssid || ''
-      });
+      const data = await this.api.getJson('/api/batch?parts=status,log_status');
+      this.apply(data.status);
+      this.logStatus.apply(data.log_status);
     } catch (error) {
       console.error('[Poller] Status poll error:', error);
     }
   }
+
+  /** Map a /api/status document (polled or pushed) into the app state */
+  apply(data) {
+    this.state.update({
+      autoMode: data.auto_mode,
+      timerRunning: data.timer,
+      remainingMs: data.remaining_ms,
+      totalMs: data.total_ms,
+      timerMinutes: data.timer_minutes,
+      relayState: data.relay,
+      reportValid: data.report_valid,
+      power: data.power || 0,
+      ws: data.ws || 0,
+      temperature: data.temperature || 0,
+      energyBoot: data.energy_boot || 0,
+      timeBoot: data.time_boot || 0,
+      relayIp: data.relay_ip || '',
+      deviceIp: data.device_ip || '',
+      wifiSsid: data.wifi_ssid || '',
+      offState: data.off_state || 'none',
+      relaysJson: JSON.stringify(data.relays || []),
+      offElapsedMs: data.off_elapsed_ms || 0
+    });
+  }
 }
 
 // ============================================================================
@@ -774,6 +974,8 @@ class PowerGraph {
     this.chart = null;
     this.updateInterval = 2000;
     this.timerId = null;
+    this.cursor = 0;  // seq of the last /api/log_data response
+    this.currency = '';  // From the tariff settings, see setCurrency()
   }
 
   init() {
@@ -824,6 +1026,28 @@ class PowerGraph {
             tension: 0.3,
             fill: true,
             yAxisID: 'y2'
+          },
+          // Power band of each log interval, max is filled down to min
+          {
+            label: 'Power min',
+            data: [],
+            borderColor: 'rgba(249, 104, 49, 0.3)',
+            borderWidth: 1,
+            pointRadius: 0,
+            tension: 0.3,
+            fill: false,
+            yAxisID: 'y'
+          },
+          {
+            label: 'Power max',
+            data: [],
+            borderColor: 'rgba(249, 104, 49, 0.3)',
+            backgroundColor: 'rgba(249, 104, 49, 0.15)',
+            borderWidth: 1,
+            pointRadius: 0,
+            tension: 0.3,
+            fill: '-1',
+            yAxisID: 'y'
           }
         ]
       },
@@ -840,7 +1064,8 @@ class PowerGraph {
             position: 'top',
             labels: {
               color: '#e5e7eb',
-              font: { size: 11 }
+              font: { size: 11 },
+              filter: item => item.datasetIndex < 3  // Band is explained by the tooltip
             }
           },
           tooltip: {
@@ -927,16 +1152,38 @@ class PowerGraph {
     this.updateCurrencyLabel();
   }
 
+  /** Currency of the cost axis and total, set whenever tariffs are loaded or saved */
+  setCurrency(currency) {
+    this.currency = currency;
+    this.updateCurrencyLabel();
+  }
+
   async update() {
     if (!this.chart) return;
 
     try {
-      const data = await this.api.getJson('/api/log_data');
-      
-      this.chart.data.labels = data.timestamps;
-      this.chart.data.datasets[0].data = data.power;
-      this.chart.data.datasets[1].data = data.energy;
-      this.chart.data.datasets[2].data = data.cost;
+      // Only the points logged since the last update, all of them on reset
+      const data = decodePowerLog(
+        await this.api.getBinary(`/api/log_data?format=bin&since=${this.cursor}`));
+      this.cursor = data.seq;
+
+      const chartData = this.chart.data;
+      const series = [data.power, data.energy, data.cost, data.min, data.max];
+      if (data.reset) {
+        chartData.labels = data.timestamps;
+        series.forEach((values, i) => { chartData.datasets[i].data = values; });
+      } else if (data.timestamps.length > 0) {
+        chartData.labels.push(...data.timestamps);
+        series.forEach((values, i) => chartData.datasets[i].data.push(...values));
+
+        // Older samples are consolidated into rollups on the device; reload
+        // the merged history once the chart holds twice what all tiers hold
+        if (chartData.labels.length > 2 * (this.state.getState().logMaxCount || 582)) {
+          this.cursor = 0;
+        }
+      } else {
+        return;
+      }
       this.chart.update('none');
     } catch (error) {
       console.error('[Graph] Update error:', error);
@@ -946,6 +1193,7 @@ class PowerGraph {
   clear() {
     if (!this.chart) return;
     
+    this.cursor = 0;  // Next update fetches everything again
     this.chart.data.labels = [];
     this.chart.data.datasets.forEach(dataset => {
       dataset.data = [];
@@ -960,7 +1208,7 @@ class PowerGraph {
       const state = this.state.getState();
       if (state.loggingEnabled) {
         await this.update();
-        await this.updateTotalEnergy();
+        this.updateTotalEnergy();
       }
     }, this.updateInterval);
   }
@@ -972,21 +1220,16 @@ class PowerGraph {
     }
   }
 
-  async updateCurrencyLabel() {
-    if (!this.chart) return;
+  updateCurrencyLabel() {
+    if (!this.chart || !this.currency) return;
     
-    try {
-      const tariff = await this.api.getJson('/api/tariff_get');
-      if (this.chart.options.scales.y2) {
-        this.chart.options.scales.y2.title.text = `Cost (${tariff.currency})`;
-        this.chart.update('none');
-      }
-    } catch (error) {
-      console.error('[Graph] Failed to update currency label:', error);
+    if (this.chart.options.scales.y2) {
+      this.chart.options.scales.y2.title.text = `Cost (${this.currency})`;
+      this.chart.update('none');
     }
   }
 
-  async updateTotalEnergy() {
+  updateTotalEnergy() {
     const energyEl = document.getElementById('logTotalEnergy');
     if (!energyEl || !this.chart) return;
     
@@ -1001,12 +1244,9 @@ class PowerGraph {
     const totalEnergy = energyData[energyData.length - 1] || 0;
     const totalCost = costData[costData.length - 1] || 0;
     
-    try {
-      const tariff = await this.api.getJson('/api/tariff_get');
-      energyEl.textContent = `${totalEnergy.toFixed(2)} Wh (${totalCost.toFixed(3)} ${tariff.currency})`;
-    } catch {
-      energyEl.textContent = `${totalEnergy.toFixed(2)} Wh`;
-    }
+    energyEl.textContent = this.currency
+      ? `${totalEnergy.toFixed(2)} Wh (${totalCost.toFixed(3)} ${this.currency})`
+      : `${totalEnergy.toFixed(2)} Wh`;
   }
 }
 
@@ -1015,39 +1255,113 @@ class PowerGraph {
 // ============================================================================
 
 class LogStatusManager {
-  constructor(api, state) {
-    this.api = api;
+  constructor(state) {
     this.state = state;
-    this.updateInterval = 2000;
-    this.timerId = null;
+  }
+
+  /** Map a /api/log_status document (polled or pushed) into the app state */
+  apply(status) {
+    this.state.update({
+      loggingEnabled: status.enabled,
+      logCount: status.count,
+      logMaxCount: status.max,
+      logSpan: status.span_ms,
+      logDuration: status.duration_ms
+    });
+  }
+}
+
+// ============================================================================
+// Live Channel
+// ============================================================================
+
+/**
+ * Receives status and log status pushed over /api/events (Server-Sent Events).
+ * Falls back to the interval poller while the stream is unavailable, e.g. on
+ * browsers without EventSource or when all subscriber slots are taken.
+ */
+class LiveChannel {
+  constructor(statusPoller, logStatus) {
+    this.statusPoller = statusPoller;
+    this.logStatus = logStatus;
+    this.source = null;
+    this.openTimer = null;
+    this.retryTimer = null;
+    this.openTimeout = 5000;
+    this.retryDelay = 60000;
   }
 
   start() {
-    if (this.timerId) return;
-    
-    this.update();
-    this.timerId = setInterval(() => this.update(), this.updateInterval);
+    if (typeof EventSource === 'undefined') {
+      console.log('[Live] EventSource not supported, polling');
+      this.fallback();
+      return;
+    }
+    this.connect();
   }
 
   stop() {
-    if (this.timerId) {
-      clearInterval(this.timerId);
-      this.timerId = null;
-    }
+    this.close();
+    clearTimeout(this.retryTimer);
+    this.retryTimer = null;
+    this.statusPoller.stop();
   }
 
-  async update() {
+  connect() {
+    this.close();
+    this.source = new EventSource('/api/events');
+
+    this.source.addEventListener('status', (e) => this.onEvent(e, this.statusPoller));
+    this.source.addEventListener('log', (e) => this.onEvent(e, this.logStatus));
+
+    this.source.onopen = () => {
+      clearTimeout(this.openTimer);
+      this.statusPoller.stop();
+      console.log('[Live] Event stream connected');
+    };
+
+    // EventSource reconnects by itself; poll meanwhile, give up if it closed
+    this.source.onerror = () => {
+      this.fallback();
+      if (this.source && this.source.readyState === EventSource.CLOSED) {
+        this.close();
+        this.scheduleRetry();
+      }
+    };
+
+    this.openTimer = setTimeout(() => {
+      if (this.source && this.source.readyState !== EventSource.OPEN) {
+        console.warn('[Live] Event stream not opening, polling');
+        this.close();
+        this.fallback();
+        this.scheduleRetry();
+      }
+    }, this.openTimeout);
+  }
+
+  onEvent(event, target) {
     try {
-      const status = await this.api.getJson('/api/log_status');
-      
-      this.state.update({
-        loggingEnabled: status.enabled,
-        logCount: status.count,
-        logMaxCount: status.max,
-        logDuration: status.duration_ms
-      });
+      target.apply(JSON.parse(event.data));
     } catch (error) {
-      console.error('[LogStatus] Update error:', error);
+      console.error('[Live] Bad event:', error);
+    }
+  }
+
+  fallback() {
+    this.statusPoller.start();
+  }
+
+  scheduleRetry() {
+    clearTimeout(this.retryTimer);
+    this.retryTimer = setTimeout(() => this.connect(), this.retryDelay);
+  }
+
+  close() {
+    clearTimeout(this.openTimer);
+    this.openTimer = null;
+    if (this.source) {
+      this.source.close();
+      this.source = null;
     }
   }
 }
@@ -1059,36 +1373,46 @@ class LogStatusManager {
 class TariffManager {
   constructor(api) {
     this.api = api;
+    this.loaded = null;  // Last /api/tariff_get document, to send only what was edited
   }
 
   async load() {
     try {
-      const data = await this.api.getJson('/api/tariff_get');
-      
-      const elements = {
-        tariffHigh: document.getElementById('tariffHigh'),
-        tariffLow: document.getElementById('tariffLow'),
-        tariffCurrency: document.getElementById('tariffCurrency'),
-        tariffStartHour: document.getElementById('tariffStartHour'),
-        tariffEndHour: document.getElementById('tariffEndHour')
-      };
-      
-      if (elements.tariffHigh) elements.tariffHigh.value = data.high;
-      if (elements.tariffLow) elements.tariffLow.value = data.low;
-      if (elements.tariffCurrency) elements.tariffCurrency.value = data.currency;
-      if (elements.tariffStartHour) elements.tariffStartHour.value = data.start_hour;
-      if (elements.tariffEndHour) elements.tariffEndHour.value = data.end_hour;
-      
-      console.log('[Tariff] Settings loaded');
-      
-      // Update graph currency label
-      if (window.app && window.app.powerGraph) {
-        window.app.powerGraph.updateCurrencyLabel();
-      }
+      this.apply(await this.api.getJson('/api/tariff_get'));
     } catch (error) {
       console.error('[Tariff] Failed to load settings:', error);
     }
   }
+
+  /** Fill the form from a /api/tariff_get document */
+  apply(data) {
+    const elements = {
+      tariffHigh: document.getElementById('tariffHigh'),
+      tariffLow: document.getElementById('tariffLow'),
+      tariffMid: document.getElementById('tariffMid'),
+      tariffCurrency: document.getElementById('tariffCurrency'),
+      tariffStartHour: document.getElementById('tariffStartHour'),
+      tariffEndHour: document.getElementById('tariffEndHour'),
+      tariffSchedule: document.getElementById('tariffSchedule')
+    };
+    
+    this.loaded = data;
+    const prices = data.prices || [data.high, data.low];
+    if (elements.tariffHigh) elements.tariffHigh.value = data.high;
+    if (elements.tariffLow) elements.tariffLow.value = data.low;
+    if (elements.tariffMid) elements.tariffMid.value = prices.length > 2 ? prices[2] : '';
+    if (elements.tariffCurrency) elements.tariffCurrency.value = data.currency;
+    if (elements.tariffStartHour) elements.tariffStartHour.value = data.start_hour;
+    if (elements.tariffEndHour) elements.tariffEndHour.value = data.end_hour;
+    if (elements.tariffSchedule) elements.tariffSchedule.value = data.schedule || '';
+    
+    console.log('[Tariff] Settings loaded');
+    
+    // Update graph currency label
+    if (window.app && window.app.powerGraph) {
+      window.app.powerGraph.setCurrency(data.currency);
+    }
+  }
 }
 
 // ============================================================================
@@ -1184,7 +1508,12 @@ class FileManager {
     
     this.files.forEach(file => {
       const sizeKB = (file.size / 1024).toFixed(1);
-      const filename = file.name.replace('/log_', '').replace('.csv', '');
+      const filename = file.name.replace('/log_', '').replace(/\.(bin|csv)$/, '');
+      let details = `${sizeKB} KB`;
+      if (file.duration_s !== undefined) {
+        const minutes = Math.round(file.duration_s / 60);
+        details += ` · ${minutes} min · ${file.energy_wh.toFixed(1)} Wh`;
+      }
       
       html += `
         <div class="list-group-item d-flex justify-content-between align-items-center" 
@@ -1193,7 +1522,7 @@ class FileManager {
             <div class="fw-semibold" style="font-size:0.9rem;">
               <i class="bi bi-file-earmark-text"></i> ${filename}
             </div>
-            <div class="text-muted" style="font-size:0.75rem;">${sizeKB} KB</div>
+            <div class="text-muted" style="font-size:0.75rem;">${details}</div>
           </div>
           <div>
             <button class="btn btn-sm btn-outline-light btn-icon me-1" 
@@ -1255,9 +1584,10 @@ class Application {
     this.api = new ApiService();
     this.state = new AppState();
     this.ui = new UIController(this.api, this.state);
-    this.statusPoller = new StatusPoller(this.api, this.state);
+    this.logStatus = new LogStatusManager(this.state);
+    this.statusPoller = new StatusPoller(this.api, this.state, this.logStatus);
     this.powerGraph = new PowerGraph(this.api, this.state);
-    this.logStatus = new LogStatusManager(this.api, this.state);
+    this.liveChannel = new LiveChannel(this.statusPoller, this.logStatus);
     this.tariffManager = new TariffManager(this.api);
     this.fileManager = new FileManager(this.api);
   }
@@ -1266,12 +1596,9 @@ class Application {
     console.log('[App] Initializing...');
     
     try {
-      this.statusPoller.start();
+      this.liveChannel.start();
       this.powerGraph.init();
-      this.logStatus.start();
-      await this.tariffManager.load();
-      await this.ui.loadAutoLog();
-      await this.ui.loadLogInterval();
+      await this.loadSettings();
       await this.fileManager.loadFiles();
       
       console.log('[App] ✓ Application ready');
@@ -1280,10 +1607,21 @@ class Application {
     }
   }
 
+  /** All settings forms in one /api/batch request */
+  async loadSettings() {
+    try {
+      const data = await this.api.getJson('/api/batch?parts=tariff,autolog,loginterval');
+      this.tariffManager.apply(data.tariff);
+      this.ui.applyAutoLog(data.autolog);
+      this.ui.applyLogInterval(data.loginterval);
+    } catch (error) {
+      console.error('[App] Failed to load settings:', error);
+    }
+  }
+
   destroy() {
-    this.statusPoller.stop();
+    this.liveChannel.stop();
     this.powerGraph.stopAutoUpdate();
-    this.logStatus.stop();
   }
 }
 
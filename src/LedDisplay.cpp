@@ -49,6 +49,18 @@ void showAutoOffDisabledRed() {
   drawI(0xFF0000);  // Red "I"
 }
 
+void showOffPending() {
+  clearMatrix();
+  M5.dis.fillpix(0x330000);  // Dark red background
+  drawI(0xFF8000);           // Orange "I"
+}
+
+void showOffConfirmed() {
+  clearMatrix();
+  M5.dis.fillpix(0x330000);  // Dark red background
+  drawI(0xFF0000);           // Red "I"
+}
+
 void showAutoOffEnabledRed() {
   clearMatrix();
   M5.dis.fillpix(0x000000);
@@ -6,7 +6,8 @@
  * - Green "I" (vertical line) = Auto-off DISABLED
  * - Blue "X" (diagonal cross) = Auto-off ENABLED
  * - Orange progress bar (bottom-up) = Timer countdown active
- * - Red "I" = Power-off command sent
+ * - Orange "I" = Power-off command sent, waiting for confirmation
+ * - Red "I" = Power-off confirmed
  */
 
 #pragma once
@@ -53,3 +54,15 @@ void showAutoOffDisabledRed();
  * @note Used during timer countdown to show remaining time visually
  */
 void drawProgressBar(uint8_t filledRows);
+
+/**
+ * @brief Display orange "I" on dark red background (power-off pending)
+ * @note Shown while the OFF command is sent, retried or not yet confirmed by /report
+ */
+void showOffPending();
+
+/**
+ * @brief Display red "I" on dark red background (power-off confirmed)
+ * @note Shown once /report confirms the relay is off after an auto-off
+ */
+void showOffConfirmed();
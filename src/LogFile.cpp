@@ -0,0 +1,172 @@
+/**
+ * @file LogFile.cpp
+ * @brief Binary log file encoding and CSV transcoding
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+#include <time.h>
+#include "LogFile.h"
+#include "PowerLog.h"
+
+static_assert(sizeof(LogFileHeader) == LOG_FILE_HEADER_SIZE, "Log file header layout");
+static_assert(sizeof(LogFileRecord) == 20, "Log file record layout");
+
+void logFileInitHeader(LogFileHeader& header, uint32_t startTime, uint32_t intervalS,
+                       float tariffHigh, float tariffLow) {
+  memset(&header, 0, sizeof(header));
+  header.magic      = LOG_FILE_MAGIC;
+  header.version    = LOG_FILE_VERSION;
+  header.headerSize = sizeof(LogFileHeader);
+  header.recordSize = sizeof(LogFileRecord);
+  header.startTime  = startTime < LOG_FILE_CLOCK_VALID ? 0 : startTime;  // NTP not synced yet
+  header.intervalS  = intervalS;
+  header.tariffHigh = tariffHigh;
+  header.tariffLow  = tariffLow;
+}
+
+void logFileEncode(LogFileRecord& record, uint32_t timestamp, float power, float minPower,
+                   float maxPower, float energy, float cost, bool lowTariff) {
+  record.timestamp = timestamp;
+  record.energy    = energy > 0 ? (uint32_t)lroundf(energy / POWER_LOG_ENERGY_UNIT_WH) : 0;
+  record.power     = powerLogQuantizePower(power);
+  record.flags     = lowTariff ? LOG_FILE_FLAG_LOW_TARIFF : 0;
+  record.reserved  = 0;
+  record.minPower  = powerLogQuantizePower(minPower);
+  record.maxPower  = powerLogQuantizePower(maxPower);
+  record.cost      = cost > 0 ? (uint32_t)lroundf(cost / POWER_LOG_COST_UNIT) : 0;
+}
+
+/**
+ * @brief Record size a supported header must declare
+ */
+static size_t recordSizeOf(uint8_t version) {
+  switch (version) {
+    case 1:  return LOG_FILE_RECORD_SIZE_V1;
+    case 2:  return LOG_FILE_RECORD_SIZE_V2;
+    case LOG_FILE_VERSION: return sizeof(LogFileRecord);
+    default: return 0;
+  }
+}
+
+size_t logFileOpen(File& file, LogFileHeader& header) {
+  size_t fileSize = file.size();
+  file.seek(0);
+  if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+      header.magic != LOG_FILE_MAGIC || recordSizeOf(header.version) == 0 ||
+      header.headerSize < sizeof(header) || header.headerSize > fileSize ||
+      header.recordSize != recordSizeOf(header.version)) {
+    return 0;
+  }
+  file.seek(header.headerSize);
+  return (fileSize - header.headerSize) / header.recordSize;
+}
+
+size_t logFileReadRecords(File& file, const LogFileHeader& header, LogFileRecord* out, size_t count) {
+  size_t size = header.recordSize;
+  size_t n = file.read((uint8_t*)out, count * size) / size;
+  if (size == sizeof(LogFileRecord)) return n;
+
+  // Spread the shorter records out in place, from the last one down
+  for (size_t i = n; i-- > 0;) {
+    LogFileRecord& r = out[i];
+    memmove(&r, (const uint8_t*)out + i * size, size);
+    if (size < LOG_FILE_RECORD_SIZE_V2) {
+      r.minPower = r.power;
+      r.maxPower = r.power;
+    }
+    // Cost was not stored, priced at the header's tariffs
+    float energyWh = r.energy * POWER_LOG_ENERGY_UNIT_WH;
+    float price = (r.flags & LOG_FILE_FLAG_LOW_TARIFF) ? header.tariffLow : header.tariffHigh;
+    r.cost = (uint32_t)lroundf((energyWh / 1000.0f) * price / POWER_LOG_COST_UNIT);
+  }
+  return n;
+}
+
+bool logFileSummarize(File& file, const char* name, LogFileInfo& info) {
+  memset(&info, 0, sizeof(info));
+  if (strlen(name) >= LOG_INDEX_NAME_MAX) return false;
+
+  LogFileHeader header;
+  size_t records = logFileOpen(file, header);
+  if (records == 0) return false;
+
+  LogFileRecord last;
+  file.seek(header.headerSize + (records - 1) * header.recordSize);
+  if (logFileReadRecords(file, header, &last, 1) != 1) return false;
+
+  strlcpy(info.name, name, sizeof(info.name));
+  info.size      = file.size();
+  info.startTime = header.startTime;
+  info.durationS = last.timestamp / 1000;
+  info.energyWh  = last.energy * POWER_LOG_ENERGY_UNIT_WH;
+  info.cost      = last.cost * POWER_LOG_COST_UNIT;
+  return true;
+}
+
+void logFileName(char* out, size_t cap, time_t end) {
+  struct tm timeinfo;
+  localtime_r(&end, &timeinfo);
+  snprintf(out, cap, "/log_%04d%02d%02d_%02d%02d%02d.bin",
+           timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
+           timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+}
+
+LogFileCsvWriter::LogFileCsvWriter(File file)
+    : file_(file), started_(false), chunkLen_(0), chunkPos_(0), lineLen_(0), linePos_(0) {
+  memset(&header_, 0, sizeof(header_));
+  remaining_ = logFileOpen(file_, header_);
+  valid_ = header_.magic == LOG_FILE_MAGIC && recordSizeOf(header_.version) != 0 &&
+           header_.recordSize == recordSizeOf(header_.version);
+}
+
+LogFileCsvWriter::~LogFileCsvWriter() {
+  file_.close();
+}
+
+bool LogFileCsvWriter::nextLine() {
+  linePos_ = 0;
+  lineLen_ = 0;  // Stays empty once the file is done, read() then returns 0
+  if (!started_) {
+    started_ = true;
+    lineLen_ = strlcpy(line_, "Time(s),Power(W),Energy(Wh),Cost,MinPower(W),MaxPower(W)\n", sizeof(line_));
+    return true;
+  }
+
+  if (chunkPos_ == chunkLen_) {
+    if (remaining_ == 0) return false;
+    size_t n = remaining_ < 16 ? remaining_ : 16;
+    if (logFileReadRecords(file_, header_, chunk_, n) != n) {
+      remaining_ = 0;  // File shrank, end the CSV here
+      return false;
+    }
+    remaining_ -= n;
+    chunkLen_ = n;
+    chunkPos_ = 0;
+  }
+
+  const LogFileRecord& r = chunk_[chunkPos_++];
+  int len = snprintf(line_, sizeof(line_), "%u,%.2f,%.4f,%.6f,%.2f,%.2f\n",
+                     r.timestamp / 1000,  // Convert ms to seconds
+                     r.power * POWER_LOG_POWER_UNIT_W,
+                     r.energy * POWER_LOG_ENERGY_UNIT_WH,
+                     r.cost * POWER_LOG_COST_UNIT,
+                     r.minPower * POWER_LOG_POWER_UNIT_W,
+                     r.maxPower * POWER_LOG_POWER_UNIT_W);
+  lineLen_ = len < (int)sizeof(line_) ? len : sizeof(line_) - 1;
+  return true;
+}
+
+size_t LogFileCsvWriter::read(uint8_t* out, size_t cap) {
+  if (!valid_) return 0;
+  size_t written = 0;
+  while (written < cap) {
+    if (linePos_ == lineLen_ && !nextLine()) break;
+    size_t n = lineLen_ - linePos_;
+    if (n > cap - written) n = cap - written;
+    memcpy(out + written, line_ + linePos_, n);
+    linePos_ += n;
+    written += n;
+  }
+  return written;
+}
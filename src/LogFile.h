@@ -0,0 +1,147 @@
+/**
+ * @file LogFile.h
+ * @brief Binary format of saved log files (/log_*.bin) and their CSV transcoder
+ *
+ * A saved log is a fixed header followed by one fixed-size record per
+ * sample, 20 bytes instead of ~50 bytes per CSV row. The session WAL (see
+ * LogWal.h) is written in the same format, so finishing a session only
+ * renames the file. CSV is produced while streaming by LogFileCsvWriter
+ * (/api/files/download), with the columns the CSV logs had plus the power
+ * band of each interval.
+ *
+ * Little-endian:
+ * - Header (LogFileHeader, 28 bytes): "PLGF", schema version (u8), flags
+ *   (u8), header size (u16), record size (u16), reserved (u16), start time
+ *   (u32, Unix time, 0 if the clock was not set), log interval in seconds
+ *   (u32), high and low tariff price per kWh at logging start (f32 each,
+ *   informational since version 3)
+ * - Records (LogFileRecord) until the end of the file. A record torn by a
+ *   reset is ignored.
+ *
+ * Readers skip a header larger than they know, so fields can be appended
+ * without breaking older files. Older records are shorter and read back
+ * widened:
+ * - version 1 (12 bytes): no min/max power, min = max = average
+ * - version 1 and 2 (16 bytes): no cost, derived as energy x the header
+ *   price of the record's tariff band
+ */
+
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include "LogIndex.h"
+
+constexpr uint32_t LOG_FILE_MAGIC           = 0x46474C50;  ///< "PLGF"
+constexpr uint8_t  LOG_FILE_VERSION         = 3;
+constexpr size_t   LOG_FILE_HEADER_SIZE     = 28;
+constexpr size_t   LOG_FILE_RECORD_SIZE_V1  = 12;          ///< Version 1 records end before minPower
+constexpr size_t   LOG_FILE_RECORD_SIZE_V2  = 16;          ///< Version 2 records end before cost
+constexpr uint8_t  LOG_FILE_FLAG_LOW_TARIFF = 0x01;        ///< LogFileRecord::flags
+constexpr uint32_t LOG_FILE_CLOCK_VALID     = 1600000000;  ///< Earlier Unix times mean NTP has not synced
+
+/**
+ * @brief First bytes of a log file
+ */
+struct LogFileHeader {
+  uint32_t magic;
+  uint8_t  version;
+  uint8_t  flags;
+  uint16_t headerSize;
+  uint16_t recordSize;
+  uint16_t reserved;
+  uint32_t startTime;   ///< Unix time of logging start, 0 if unknown
+  uint32_t intervalS;   ///< Log interval in seconds
+  float    tariffHigh;  ///< Price per kWh at logging start
+  float    tariffLow;
+};
+
+/**
+ * @brief One stored sample
+ */
+struct LogFileRecord {
+  uint32_t timestamp;  ///< Milliseconds since logging started
+  uint32_t energy;     ///< POWER_LOG_ENERGY_UNIT_WH since logging started
+  uint16_t power;      ///< POWER_LOG_POWER_UNIT_W, average over the interval
+  uint8_t  flags;      ///< LOG_FILE_FLAG_*
+  uint8_t  reserved;
+  uint16_t minPower;   ///< POWER_LOG_POWER_UNIT_W (version 2)
+  uint16_t maxPower;   ///< POWER_LOG_POWER_UNIT_W (version 2)
+  uint32_t cost;       ///< POWER_LOG_COST_UNIT since logging started (version 3)
+};
+
+/**
+ * @brief Fill a header for a new file
+ * @param startTime Unix time of logging start (time() before NTP sync is stored as 0)
+ */
+void logFileInitHeader(LogFileHeader& header, uint32_t startTime, uint32_t intervalS,
+                       float tariffHigh, float tariffLow);
+
+/**
+ * @brief Quantize one sample into a record
+ */
+void logFileEncode(LogFileRecord& record, uint32_t timestamp, float power, float minPower,
+                   float maxPower, float energy, float cost, bool lowTariff);
+
+/**
+ * @brief Read and check the header, leaves the file at the first record
+ * @return Number of complete records, 0 if the file is not a valid log
+ */
+size_t logFileOpen(File& file, LogFileHeader& header);
+
+/**
+ * @brief Read records at the current position, older versions widened
+ * @param header Header returned by logFileOpen()
+ * @return Records read
+ */
+size_t logFileReadRecords(File& file, const LogFileHeader& header, LogFileRecord* out, size_t count);
+
+/**
+ * @brief Summary of a log file from its header and last record
+ * @param name Path used for the index entry
+ * @return false if the file is not a valid log or has no records
+ */
+bool logFileSummarize(File& file, const char* name, LogFileInfo& info);
+
+/**
+ * @brief Name of a log file ending at the given time, "/log_YYYYMMDD_HHMMSS.bin"
+ */
+void logFileName(char* out, size_t cap, time_t end);
+
+/**
+ * @brief Incremental CSV transcoder of a binary log file
+ *
+ * Produces "Time(s),Power(W),Energy(Wh),Cost,MinPower(W),MaxPower(W)" and one
+ * row per record, piece by piece into caller buffers of any size, so the
+ * download is sent with chunked transfer encoding.
+ */
+class LogFileCsvWriter {
+ public:
+  explicit LogFileCsvWriter(File file);
+  ~LogFileCsvWriter();
+
+  /**
+   * @brief File has a valid header
+   */
+  bool valid() const { return valid_; }
+
+  /**
+   * @brief Write the next part of the CSV
+   * @return Bytes written, 0 once the file is complete
+   */
+  size_t read(uint8_t* out, size_t cap);
+
+ private:
+  bool nextLine();
+
+  File          file_;
+  LogFileHeader header_;
+  bool          valid_;
+  bool          started_;    ///< Column header written
+  size_t        remaining_;  ///< Records not read from the file yet
+  LogFileRecord chunk_[16];  ///< Records read ahead
+  size_t        chunkLen_;
+  size_t        chunkPos_;
+  char          line_[96];   ///< Formatted row not yet copied out
+  size_t        lineLen_;
+  size_t        linePos_;
+};
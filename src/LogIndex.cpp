@@ -0,0 +1,286 @@
+/**
+ * @file LogIndex.cpp
+ * @brief Implementation of the saved log file index
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SPIFFS.h>
+#include <time.h>
+#include "LogIndex.h"
+#include "LogFile.h"
+
+static const char* const INDEX_PATH = "/logindex.bin";
+static const uint32_t INDEX_MAGIC   = 0x5844494C;  // "LIDX"
+static const uint16_t INDEX_VERSION = 1;
+
+/**
+ * @brief Header of /logindex.bin, followed by count LogFileInfo records
+ */
+struct IndexHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+};
+
+static LogFileInfo entries[LOG_INDEX_MAX];
+static uint8_t     entryCount = 0;
+
+static bool isLogFileName(const String& name) {
+  return name.startsWith("/log_") && (name.endsWith(".bin") || name.endsWith(".csv"));
+}
+
+/**
+ * @brief Position of name, or where it would be inserted
+ */
+static uint8_t lowerBound(const char* name) {
+  uint8_t lo = 0, hi = entryCount;
+  while (lo < hi) {
+    uint8_t mid = (lo + hi) / 2;
+    if (strcmp(entries[mid].name, name) < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+static void saveIndex() {
+  File file = SPIFFS.open(INDEX_PATH, FILE_WRITE);
+  if (!file) {
+    Serial.println("Log index: failed to write");
+    return;
+  }
+  IndexHeader header = { INDEX_MAGIC, INDEX_VERSION, entryCount };
+  file.write((const uint8_t*)&header, sizeof(header));
+  file.write((const uint8_t*)entries, sizeof(LogFileInfo) * entryCount);
+  file.close();
+}
+
+static bool loadIndex() {
+  File file = SPIFFS.open(INDEX_PATH, FILE_READ);
+  if (!file) return false;
+
+  IndexHeader header;
+  bool ok = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+            header.magic == INDEX_MAGIC && header.version == INDEX_VERSION &&
+            header.count <= LOG_INDEX_MAX;
+  if (ok) {
+    size_t bytes = sizeof(LogFileInfo) * header.count;
+    ok = file.read((uint8_t*)entries, bytes) == bytes;
+  }
+  file.close();
+
+  entryCount = ok ? header.count : 0;
+  for (uint8_t i = 0; i < entryCount; i++) {
+    entries[i].name[LOG_INDEX_NAME_MAX - 1] = '\0';
+  }
+  return ok;
+}
+
+/**
+ * @brief Save time from log_YYYYMMDD_HHMMSS.* (local time, see logFileName()), 0 if not parsable
+ */
+static uint32_t nameTime(const char* name) {
+  struct tm t = {};
+  if (sscanf(name, "/log_%4d%2d%2d_%2d%2d%2d", &t.tm_year, &t.tm_mon, &t.tm_mday,
+             &t.tm_hour, &t.tm_min, &t.tm_sec) != 6) {
+    return 0;
+  }
+  t.tm_year -= 1900;
+  t.tm_mon  -= 1;
+  t.tm_isdst = -1;
+  return (uint32_t)mktime(&t);
+}
+
+/**
+ * @brief Summarize a log file, binary from its header and last record,
+ *        CSV (saved before the binary format) from its name and last data line
+ */
+static bool scanLogFile(File& file, const String& name, LogFileInfo& info) {
+  if (name.endsWith(".bin")) {
+    if (!logFileSummarize(file, name.c_str(), info)) return false;
+    if (info.startTime == 0) {
+      // Clock was not set at logging start, the name has the save time
+      uint32_t saved = nameTime(info.name);
+      info.startTime = saved > info.durationS ? saved - info.durationS : saved;
+    }
+    return true;
+  }
+
+  memset(&info, 0, sizeof(info));
+  if (name.length() >= LOG_INDEX_NAME_MAX) return false;
+  strlcpy(info.name, name.c_str(), sizeof(info.name));
+  info.size = file.size();
+
+  // Start time from log_YYYYMMDD_HHMMSS.csv
+  info.startTime = nameTime(info.name);
+
+  // Last line holds the totals, rows are well below 64 bytes
+  char tail[96];
+  size_t from = info.size > sizeof(tail) - 1 ? info.size - (sizeof(tail) - 1) : 0;
+  file.seek(from);
+  size_t len = file.read((uint8_t*)tail, sizeof(tail) - 1);
+  tail[len] = '\0';
+  while (len > 0 && (tail[len - 1] == '\n' || tail[len - 1] == '\r')) tail[--len] = '\0';
+  const char* line = strrchr(tail, '\n');
+  line = line ? line + 1 : tail;
+
+  unsigned seconds;
+  float power;
+  if (sscanf(line, "%u,%f,%f,%f", &seconds, &power, &info.energyWh, &info.cost) == 4) {
+    info.durationS = seconds;
+    info.startTime = info.startTime > seconds ? info.startTime - seconds : info.startTime;
+  }
+  return true;
+}
+
+/**
+ * @brief Next log file of a directory walk
+ * @return false at the end of the directory
+ */
+static bool nextLogFile(File& root, File& file, String& name) {
+  while ((file = root.openNextFile())) {
+    name = String(file.name());
+    if (!name.startsWith("/")) name = "/" + name;
+    if (!file.isDirectory() && isLogFileName(name)) return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Insert an entry, pushing out the oldest one if the table is full
+ * @return false if the file is older than every indexed one and was not added
+ */
+static bool insertNewest(const LogFileInfo& info) {
+  if (entryCount == LOG_INDEX_MAX) {
+    if (strcmp(info.name, entries[0].name) < 0) return false;
+    memmove(&entries[0], &entries[1], sizeof(LogFileInfo) * (entryCount - 1));
+    entryCount--;
+  }
+  uint8_t pos = lowerBound(info.name);
+  memmove(&entries[pos + 1], &entries[pos], sizeof(LogFileInfo) * (entryCount - pos));
+  entries[pos] = info;
+  entryCount++;
+  return true;
+}
+
+/**
+ * @brief Delete the log files that are older than every indexed one and not in the index
+ * @return Files deleted
+ *
+ * Names are collected in small batches and removed after each directory
+ * walk, the walk is not changed while it runs.
+ */
+static uint16_t deleteEvicted() {
+  uint16_t deleted = 0;
+  char batch[8][LOG_INDEX_NAME_MAX];
+  uint8_t n;
+  do {
+    n = 0;
+    File root = SPIFFS.open("/");
+    File file;
+    String name;
+    while (n < 8 && nextLogFile(root, file, name)) {
+      if (entryCount > 0 && strcmp(name.c_str(), entries[0].name) >= 0) continue;  // Kept or unreadable
+      strlcpy(batch[n++], name.c_str(), LOG_INDEX_NAME_MAX);
+    }
+    root.close();
+    for (uint8_t i = 0; i < n; i++) {
+      if (!SPIFFS.remove(batch[i])) return deleted;  // Avoid walking again over the same file
+      Serial.printf("Log index: deleted %s (over %u files)\n", batch[i], LOG_INDEX_MAX);
+      deleted++;
+    }
+  } while (n == 8);
+  return deleted;
+}
+
+void logIndexBegin() {
+  bool loaded = loadIndex();
+  bool changed = !loaded;
+
+  // Known files first, so entries of deleted files don't take room from new ones
+  bool seen[LOG_INDEX_MAX] = {};
+  uint16_t unknown = 0;
+  File root = SPIFFS.open("/");
+  File file;
+  String name;
+  while (nextLogFile(root, file, name)) {
+    uint8_t pos = lowerBound(name.c_str());
+    if (pos >= entryCount || name != entries[pos].name) {
+      unknown++;
+      continue;
+    }
+    seen[pos] = true;
+    if (entries[pos].size != file.size()) {
+      LogFileInfo info;
+      if (scanLogFile(file, name, info)) entries[pos] = info;
+      changed = true;
+    }
+  }
+  root.close();
+
+  // Drop entries of files deleted outside the index
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < entryCount; i++) {
+    if (seen[i]) entries[kept++] = entries[i];
+  }
+  changed |= kept != entryCount;
+  entryCount = kept;
+
+  // New files; beyond LOG_INDEX_MAX the newest are kept like auto-cleanup would
+  uint16_t evicted = 0;
+  if (unknown > 0) {
+    root = SPIFFS.open("/");
+    while (nextLogFile(root, file, name)) {
+      if (logIndexFind(name.c_str())) continue;
+      LogFileInfo info;
+      if (!scanLogFile(file, name, info)) continue;
+      bool full = entryCount == LOG_INDEX_MAX;
+      if (!insertNewest(info) || full) evicted++;
+      changed = true;
+    }
+    root.close();
+  }
+
+  if (changed) saveIndex();
+  if (evicted > 0) {
+    // Not indexed means never evicted by ensureSpaceForLog(), the flash would leak
+    uint16_t deleted = deleteEvicted();
+    Serial.printf("Log index: %u files over the limit, %u deleted\n", evicted, deleted);
+  }
+  Serial.printf("Log index: %u files%s\n", entryCount, changed ? " (rebuilt)" : "");
+}
+
+bool logIndexAdd(const LogFileInfo& info) {
+  uint8_t pos = lowerBound(info.name);
+  if (pos < entryCount && strcmp(entries[pos].name, info.name) == 0) {
+    entries[pos] = info;
+  } else {
+    if (entryCount >= LOG_INDEX_MAX) return false;
+    memmove(&entries[pos + 1], &entries[pos], sizeof(LogFileInfo) * (entryCount - pos));
+    entries[pos] = info;
+    entryCount++;
+  }
+  saveIndex();
+  return true;
+}
+
+void logIndexRemove(const char* name) {
+  uint8_t pos = lowerBound(name);
+  if (pos >= entryCount || strcmp(entries[pos].name, name) != 0) return;
+  memmove(&entries[pos], &entries[pos + 1], sizeof(LogFileInfo) * (entryCount - pos - 1));
+  entryCount--;
+  saveIndex();
+}
+
+const LogFileInfo* logIndexFind(const char* name) {
+  uint8_t pos = lowerBound(name);
+  return (pos < entryCount && strcmp(entries[pos].name, name) == 0) ? &entries[pos] : nullptr;
+}
+
+uint8_t logIndexCount() {
+  return entryCount;
+}
+
+const LogFileInfo& logIndexAt(uint8_t i) {
+  return entries[i];
+}
@@ -0,0 +1,79 @@
+/**
+ * @file LogIndex.h
+ * @brief In-RAM index of the saved log files (/log_*.bin, older /log_*.csv) on SPIFFS
+ *
+ * Listing files, finding the oldest one for auto-cleanup and the per-file
+ * summary (start, duration, energy, cost) are answered from this table
+ * instead of walking the SPIFFS directory. saveLogToFile(), the session
+ * export of LogWal and deleteLogFile() keep it up to date, every change is
+ * written to /logindex.bin.
+ *
+ * Entries are sorted by name. Names carry the save time
+ * (log_YYYYMMDD_HHMMSS.bin), so the oldest file is always entry 0 and
+ * lookups by name are a binary search.
+ *
+ * At boot the stored index is checked against one directory walk: files
+ * that are missing are dropped, files that are new or changed in size are
+ * summarized from their header and last record (last line for CSV). If
+ * there are more than LOG_INDEX_MAX files (copied in, or an older firmware
+ * that did not cap them), the oldest are deleted, as auto-cleanup would
+ * have done: a file outside the index is never evicted and would hold its
+ * flash forever.
+ */
+
+#pragma once
+#include <Arduino.h>
+
+constexpr uint8_t LOG_INDEX_MAX      = 64;  ///< Saved log files tracked (older ones are evicted)
+constexpr uint8_t LOG_INDEX_NAME_MAX = 32;  ///< SPIFFS object name length
+
+/**
+ * @brief Summary of one saved log file
+ */
+struct LogFileInfo {
+  char     name[LOG_INDEX_NAME_MAX];  ///< Path with leading '/', e.g. "/log_20250101_120000.bin"
+  uint32_t size;                      ///< File size in bytes
+  uint32_t startTime;                 ///< Unix time of the first sample, 0 if unknown
+  uint32_t durationS;                 ///< Time of the last sample in seconds
+  float    energyWh;                  ///< Energy at the last sample
+  float    cost;                      ///< Cost at the last sample
+};
+
+/**
+ * @brief Load /logindex.bin and reconcile it with the files on SPIFFS
+ * @note Call once after SPIFFS.begin()
+ */
+void logIndexBegin();
+
+/**
+ * @brief Add or replace the entry of a saved file and persist the index
+ * @return false if the table is full (caller evicts the oldest file first)
+ */
+bool logIndexAdd(const LogFileInfo& info);
+
+/**
+ * @brief Remove the entry of a deleted file and persist the index
+ */
+void logIndexRemove(const char* name);
+
+/**
+ * @brief Entry of a file, nullptr if it is not indexed
+ */
+const LogFileInfo* logIndexFind(const char* name);
+
+/**
+ * @brief Number of indexed files
+ */
+uint8_t logIndexCount();
+
+/**
+ * @brief Entry i in name (= age) order, 0 is the oldest file
+ */
+const LogFileInfo& logIndexAt(uint8_t i);
+
+/**
+ * @brief Oldest indexed file, nullptr if there is none
+ */
+inline const LogFileInfo* logIndexOldest() {
+  return logIndexCount() > 0 ? &logIndexAt(0) : nullptr;
+}
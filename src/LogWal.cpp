@@ -0,0 +1,338 @@
+/**
+ * @file LogWal.cpp
+ * @brief Implementation of the session WAL writer task
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SPIFFS.h>
+#include <time.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "LogWal.h"
+#include "LogIndex.h"
+#include "WebUi.h"
+
+// From main.cpp
+void cleanupOldestLog();
+bool ensureSpaceForLog(size_t requiredBytes);
+
+static const char* const WAL_PATH = "/session.wal";
+static const char* const PARKED_PATH = "/session_%u.wal";  ///< Oldest parked session first
+
+enum WalCommandType : uint8_t {
+  WalCmdStart,   ///< Create the WAL, finishing a previous one first
+  WalCmdWrite,   ///< Append a block and hand it back
+  WalCmdFinish   ///< Close the WAL and save it as a log file
+};
+
+struct WalCommand {
+  WalCommandType type;
+  uint8_t  block;
+  uint16_t count;        ///< Records in block
+  LogFileHeader header;  ///< WalCmdStart only
+};
+
+static LogFileRecord blocks[LOG_WAL_BLOCKS][LOG_WAL_BLOCK_RECORDS];
+
+static QueueHandle_t commandQueue = nullptr;
+static QueueHandle_t freeQueue    = nullptr;  ///< Indexes of blocks loop() may fill
+static TaskHandle_t  writerTask   = nullptr;
+
+// Owned by loop()
+static int8_t   currentBlock = -1;  ///< Block being filled, -1 = none taken
+static uint16_t currentCount = 0;
+static uint32_t currentSince = 0;   ///< millis() of the first record in the block
+static uint32_t droppedCount = 0;
+
+// Owned by the writer task
+static bool     walOpen    = false;
+static uint32_t walRecords = 0;
+static uint8_t  parkedMask = 0;  ///< Bit N: /session_N.wal exists
+static volatile uint32_t writerDropped = 0;  ///< Records of blocks not stored, read by loop()
+
+static bool sendCommand(const WalCommand& cmd) {
+  if (!commandQueue || xQueueSend(commandQueue, &cmd, 0) != pdTRUE) {
+    Serial.printf("Log WAL: command %u not queued\n", cmd.type);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Queue the block being filled for writing
+ */
+static void flushCurrentBlock() {
+  if (currentBlock < 0 || currentCount == 0) return;
+  WalCommand cmd = { WalCmdWrite, (uint8_t)currentBlock, currentCount };
+  if (!sendCommand(cmd)) {
+    droppedCount += currentCount;
+    currentCount = 0;  // Reuse the block
+    return;
+  }
+  currentBlock = -1;
+  currentCount = 0;
+}
+
+/**
+ * @brief Move a session without start time aside until the clock is set
+ * @return false if every parking slot is taken
+ */
+static bool parkSession(const char* path) {
+  for (uint8_t n = 0; n < LOG_WAL_PARKED; n++) {
+    if (parkedMask & (1 << n)) continue;
+    char parked[LOG_INDEX_NAME_MAX];
+    snprintf(parked, sizeof(parked), PARKED_PATH, n);
+    if (!SPIFFS.rename(path, parked)) return false;
+    parkedMask |= 1 << n;
+    Serial.printf("Log WAL: clock not set, session parked as %s\n", parked);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Save a session file as /log_*.bin and add it to the log index
+ * @param path WAL or parked session
+ * @param end End time to use if the header has no start time, 0 = park the file
+ * @note Runs on the writer task, takes StateLock only around index updates
+ */
+static void saveSession(const char* path, time_t end) {
+  File file = SPIFFS.open(path, FILE_READ);
+  LogFileInfo info;
+  bool hasData = file && logFileSummarize(file, path, info);
+  file.close();
+  if (!hasData) {
+    SPIFFS.remove(path);
+    Serial.println("Log WAL: session has no data, discarded");
+    return;
+  }
+
+  // Named after the last sample like a log saved at stop time
+  if (info.startTime != 0) {
+    end = (time_t)(info.startTime + info.durationS);
+  } else if (end == 0) {
+    if (parkSession(path)) return;
+    end = time(nullptr);  // No slot left, keep the session under an uptime name
+  }
+  char filename[LOG_INDEX_NAME_MAX];
+  logFileName(filename, sizeof(filename), end);
+  {
+    StateLock lock;
+    if (logIndexCount() >= LOG_INDEX_MAX) {
+      cleanupOldestLog();
+    }
+  }
+
+  if (SPIFFS.exists(filename)) SPIFFS.remove(filename);
+  if (!SPIFFS.rename(path, filename)) {
+    Serial.printf("Log WAL: failed to rename session to %s\n", filename);
+    return;  // Retried at the next start or boot
+  }
+
+  strlcpy(info.name, filename, sizeof(info.name));
+  info.startTime = (uint32_t)end - info.durationS;
+  {
+    StateLock lock;
+    logIndexAdd(info);
+  }
+  Serial.printf("Log WAL: session saved to %s (%u bytes)\n", filename, info.size);
+}
+
+/**
+ * @brief Save the WAL, parking it if it has no start time and the clock is not set
+ */
+static void finishWal() {
+  walOpen = false;
+  if (!SPIFFS.exists(WAL_PATH)) return;
+  time_t now = time(nullptr);
+  saveSession(WAL_PATH, now >= (time_t)LOG_FILE_CLOCK_VALID ? now : 0);
+}
+
+/**
+ * @brief Name the parked sessions once the clock is set
+ *
+ * Their real end time is unknown. They are named a second apart before
+ * now, oldest first, so they sort and get evicted in the order they ran.
+ */
+static void saveParkedSessions() {
+  time_t now = time(nullptr);
+  if (parkedMask == 0 || now < (time_t)LOG_FILE_CLOCK_VALID) return;
+  for (uint8_t n = 0; n < LOG_WAL_PARKED; n++) {
+    if (!(parkedMask & (1 << n))) continue;
+    char parked[LOG_INDEX_NAME_MAX];
+    snprintf(parked, sizeof(parked), PARKED_PATH, n);
+    saveSession(parked, now - (LOG_WAL_PARKED - n));
+    if (!SPIFFS.exists(parked)) parkedMask &= ~(1 << n);  // Else retried at the next poll
+  }
+}
+
+static void openWal(const LogFileHeader& header) {
+  finishWal();  // Stop was never queued
+
+  File file = SPIFFS.open(WAL_PATH, FILE_WRITE);
+  if (!file) {
+    Serial.println("Log WAL: failed to create session file");
+    return;
+  }
+  file.write((const uint8_t*)&header, sizeof(header));
+  file.close();
+  walOpen = true;
+  walRecords = 0;
+}
+
+/**
+ * @brief Count records that did not make it into the WAL
+ */
+static void dropRecords(uint32_t count) {
+  writerDropped = writerDropped + count;  // Only the writer task writes it
+}
+
+static void appendBlock(uint8_t block, uint16_t count) {
+  if (!walOpen) {
+    dropRecords(count);  // Session file could not be created
+    return;
+  }
+  if (walRecords + count > LOG_WAL_MAX_RECORDS) {
+    if (walRecords < LOG_WAL_MAX_RECORDS) Serial.println("Log WAL: session limit reached");
+    walRecords = LOG_WAL_MAX_RECORDS;
+    dropRecords(count);
+    return;
+  }
+
+  size_t bytes = count * sizeof(LogFileRecord);
+  bool enoughSpace;
+  {
+    StateLock lock;
+    enoughSpace = ensureSpaceForLog(bytes);  // Deletes the oldest logs when flash runs low
+  }
+  if (!enoughSpace) {
+    Serial.println("Log WAL: flash full, block dropped");
+    dropRecords(count);
+    return;
+  }
+
+  // Closed after every block, so the data is committed before the next one
+  File file = SPIFFS.open(WAL_PATH, FILE_APPEND);
+  if (!file) {
+    Serial.println("Log WAL: failed to append");
+    dropRecords(count);
+    return;
+  }
+  size_t written = file.write((const uint8_t*)blocks[block], bytes);
+  if (written != bytes) {
+    Serial.println("Log WAL: short write, flash full?");
+    dropRecords(count - written / sizeof(LogFileRecord));  // A torn last record is ignored when read
+  }
+  file.close();
+  walRecords += count;
+}
+
+static void walWriter(void*) {
+  WalCommand cmd;
+  for (;;) {
+    TickType_t wait = parkedMask ? pdMS_TO_TICKS(LOG_WAL_CLOCK_POLL_MS) : portMAX_DELAY;
+    bool received = xQueueReceive(commandQueue, &cmd, wait) == pdTRUE;
+    saveParkedSessions();
+    if (!received) continue;
+    switch (cmd.type) {
+      case WalCmdStart:
+        openWal(cmd.header);
+        break;
+      case WalCmdWrite:
+        appendBlock(cmd.block, cmd.count);
+        xQueueSend(freeQueue, &cmd.block, 0);
+        break;
+      case WalCmdFinish:
+        finishWal();
+        break;
+    }
+  }
+}
+
+void logWalBegin() {
+  commandQueue = xQueueCreate(LOG_WAL_BLOCKS + 4, sizeof(WalCommand));
+  freeQueue    = xQueueCreate(LOG_WAL_BLOCKS, sizeof(uint8_t));
+  if (!commandQueue || !freeQueue) {
+    Serial.println("Log WAL: queue allocation failed");
+    return;
+  }
+  for (uint8_t i = 0; i < LOG_WAL_BLOCKS; i++) {
+    xQueueSend(freeQueue, &i, 0);
+  }
+  for (uint8_t n = 0; n < LOG_WAL_PARKED; n++) {
+    char parked[LOG_INDEX_NAME_MAX];
+    snprintf(parked, sizeof(parked), PARKED_PATH, n);
+    if (SPIFFS.exists(parked)) parkedMask |= 1 << n;
+  }
+
+  // Same core as the relay workers, loop() stays on core 1
+  if (xTaskCreatePinnedToCore(walWriter, "logwal", LOG_WAL_WRITER_STACK, nullptr, 1, &writerTask, 0) != pdPASS) {
+    Serial.println("Log WAL: task creation failed");
+    writerTask = nullptr;
+    return;
+  }
+
+  // Session interrupted by a reset or power loss
+  if (SPIFFS.exists(WAL_PATH)) {
+    Serial.println("Log WAL: recovering unsaved session");
+    WalCommand cmd = { WalCmdFinish };
+    sendCommand(cmd);
+  }
+}
+
+void logWalStart(uint32_t startTime, uint32_t intervalS, float tariffHigh, float tariffLow) {
+  WalCommand cmd = { WalCmdStart };
+  logFileInitHeader(cmd.header, startTime, intervalS, tariffHigh, tariffLow);
+  sendCommand(cmd);
+}
+
+void logWalAppend(uint32_t timestamp, float power, float minPower, float maxPower,
+                  float energy, float cost, bool lowTariff) {
+  if (currentBlock < 0) {
+    uint8_t block;
+    if (!freeQueue || xQueueReceive(freeQueue, &block, 0) != pdTRUE) {
+      droppedCount++;
+      return;
+    }
+    currentBlock = block;
+    currentCount = 0;
+    currentSince = millis();
+  }
+
+  logFileEncode(blocks[currentBlock][currentCount++], timestamp, power, minPower, maxPower,
+                energy, cost, lowTariff);
+  if (currentCount == LOG_WAL_BLOCK_RECORDS) flushCurrentBlock();
+}
+
+void logWalLoop(uint32_t now) {
+  if (currentCount > 0 && now - currentSince >= LOG_WAL_FLUSH_MS) flushCurrentBlock();
+}
+
+void logWalStop() {
+  flushCurrentBlock();
+  WalCommand cmd = { WalCmdFinish };
+  sendCommand(cmd);
+}
+
+bool logWalSync(uint32_t timeoutMs) {
+  flushCurrentBlock();
+  if (!freeQueue) return false;
+
+  // Every block is back in the free queue once the writer has stored it
+  uint32_t start = millis();
+  uint8_t held = currentBlock >= 0 ? 1 : 0;
+  while (uxQueueMessagesWaiting(freeQueue) + held < LOG_WAL_BLOCKS) {
+    if (millis() - start >= timeoutMs) {
+      Serial.println("Log WAL: sync timed out");
+      return false;
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+  return true;
+}
+
+uint32_t logWalDropped() {
+  return droppedCount + writerDropped;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file LogWal.h
+ * @brief Crash-safe write-ahead log of the running logging session on SPIFFS
+ *
+ * Every sample handed to powerLogPush() is also appended to /session.wal, so
+ * a brownout or restart loses at most the samples of one unflushed block
+ * instead of the whole session.
+ *
+ * logWalAppend() only copies the sample into one of LOG_WAL_BLOCKS static
+ * block buffers. A full block, or a partial one after LOG_WAL_FLUSH_MS, is
+ * handed to a writer task that appends it to the file, so loop() never
+ * waits on flash. If every block is still queued the sample is dropped and
+ * counted, as are the records of a block the writer could not store.
+ *
+ * The WAL is written in the saved log format (see LogFile.h) with the tariff
+ * prices at logging start in its header. When logging stops the writer
+ * renames it to /log_*.bin and adds it to the log index, no conversion
+ * pass is needed. A WAL found at boot is finished the same way, so the
+ * session interrupted by a reset still ends up as a saved log.
+ *
+ * Log files are named and evicted by their end time. A session started
+ * before NTP synced has no start time in its header and only relative
+ * record timestamps, so if the clock is still not set when it is finished
+ * (typically a session recovered at boot) it is parked as
+ * /session_N.wal and named once the clock is valid, instead of getting a
+ * 1970 name that would make it the first log to be evicted.
+ */
+
+#pragma once
+#include <Arduino.h>
+#include "LogFile.h"
+
+constexpr size_t   LOG_WAL_BLOCK_RECORDS = 16;     ///< Records per block (320 bytes)
+constexpr uint8_t  LOG_WAL_BLOCKS        = 4;      ///< Block buffers, full ones wait for the writer
+constexpr uint32_t LOG_WAL_FLUSH_MS      = 30000;  ///< Age of a partial block before it is written
+constexpr uint32_t LOG_WAL_MAX_RECORDS   = 17280;  ///< Session length kept (~340KB, 48 h at 10 s)
+constexpr uint32_t LOG_WAL_WRITER_STACK  = 4096;   ///< Stack size of the writer task
+constexpr uint8_t  LOG_WAL_PARKED        = 2;      ///< Sessions waiting for the clock to be named (not evicted meanwhile)
+constexpr uint32_t LOG_WAL_CLOCK_POLL_MS = 10000;  ///< Clock check interval while sessions are parked
+
+/**
+ * @brief Start the writer task and finish a session left over from before a reset
+ * @note Call once in setup() after stateMutex is created, the writer takes StateLock
+ *       to update the log index
+ */
+void logWalBegin();
+
+/**
+ * @brief Open a new WAL for a logging session
+ * @param startTime Unix time of logging start (time() before NTP sync is stored as 0)
+ * @param intervalS Log interval in seconds
+ * @param tariffHigh Price per kWh snapshot for the file header
+ * @param tariffLow Price per kWh snapshot for the file header
+ */
+void logWalStart(uint32_t startTime, uint32_t intervalS, float tariffHigh, float tariffLow);
+
+/**
+ * @brief Add one sample to the current block
+ * @param timestamp Milliseconds since logging started
+ * @param power Watts, average over the interval
+ * @param minPower Watts, lowest poll in the interval
+ * @param maxPower Watts, highest poll in the interval
+ * @param energy Wh since logging started
+ * @param cost Cost since logging started
+ * @param lowTariff Sample taken in the low tariff window
+ */
+void logWalAppend(uint32_t timestamp, float power, float minPower, float maxPower,
+                  float energy, float cost, bool lowTariff);
+
+/**
+ * @brief Hand a partial block to the writer once it is LOG_WAL_FLUSH_MS old
+ * @param now millis()
+ */
+void logWalLoop(uint32_t now);
+
+/**
+ * @brief Flush the session and save it as a log file in the background
+ * @note The file appears in the log index when the writer is done
+ */
+void logWalStop();
+
+/**
+ * @brief Flush the current block and wait until the writer has stored every block
+ * @param timeoutMs Longest wait, the writer may be waiting for StateLock
+ * @return true if all samples are on flash
+ * @note Call before ESP.restart(), without holding StateLock (the writer takes it
+ *       to make room on flash, the sync would always time out)
+ */
+bool logWalSync(uint32_t timeoutMs);
+
+/**
+ * @brief Samples that did not reach the WAL
+ *
+ * No free block buffer, or a block the writer could not store: no session
+ * file open, session limit reached, flash full or a failed write.
+ */
+uint32_t logWalDropped();
@@ -0,0 +1,102 @@
+/**
+ * @file PollScheduler.cpp
+ * @brief Implementation of the adaptive relay poll interval
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "PollScheduler.h"
+
+PollPolicy pollPolicy = { 1000, 5000, 15000, 60000, 5.0f };
+
+/**
+ * @brief Scheduler history of one relay
+ */
+struct PollTrack {
+  PollMode mode      = PollNormal;
+  float    power     = 0.0f;
+  bool     powerSeen = false;
+};
+
+static PollTrack tracks[MAX_RELAYS];
+
+void loadPollPolicy() {
+  Preferences prefs;
+  prefs.begin("coreone", true); // Read-only
+  pollPolicy.fastMs       = prefs.getUInt("poll_fast", 1000);
+  pollPolicy.normalMs     = prefs.getUInt("poll_norm", 5000);
+  pollPolicy.idleMs       = prefs.getUInt("poll_idle", 15000);
+  pollPolicy.maxBackoffMs = prefs.getUInt("poll_max", 60000);
+  pollPolicy.powerDeltaW  = prefs.getFloat("poll_delta", 5.0f);
+  prefs.end();
+
+  Serial.printf("Poll policy: fast=%ums normal=%ums idle=%ums backoff<=%ums delta=%.1fW\n",
+                pollPolicy.fastMs, pollPolicy.normalMs, pollPolicy.idleMs,
+                pollPolicy.maxBackoffMs, pollPolicy.powerDeltaW);
+}
+
+void savePollPolicy() {
+  pollPolicy.fastMs       = constrain(pollPolicy.fastMs,       (uint32_t)500,  (uint32_t)10000);
+  pollPolicy.normalMs     = constrain(pollPolicy.normalMs,     pollPolicy.fastMs, (uint32_t)60000);
+  pollPolicy.idleMs       = constrain(pollPolicy.idleMs,       pollPolicy.normalMs, (uint32_t)300000);
+  pollPolicy.maxBackoffMs = constrain(pollPolicy.maxBackoffMs, pollPolicy.normalMs, (uint32_t)600000);
+  pollPolicy.powerDeltaW  = constrain(pollPolicy.powerDeltaW,  0.5f, 500.0f);
+
+  Preferences prefs;
+  prefs.begin("coreone", false);
+  prefs.putUInt("poll_fast", pollPolicy.fastMs);
+  prefs.putUInt("poll_norm", pollPolicy.normalMs);
+  prefs.putUInt("poll_idle", pollPolicy.idleMs);
+  prefs.putUInt("poll_max", pollPolicy.maxBackoffMs);
+  prefs.putFloat("poll_delta", pollPolicy.powerDeltaW);
+  prefs.end();
+
+  Serial.println("Poll policy saved");
+}
+
+uint32_t pollSchedulerNext(uint8_t relayId, bool reportOk, uint32_t errors, bool busy, bool relayOn, float power) {
+  PollTrack& t = tracks[relayId < MAX_RELAYS ? relayId : PRIMARY_RELAY];
+  if (!reportOk) {
+    t.powerSeen = false;
+    t.mode = PollBackoff;
+
+    // normal, 2x, 4x, ... capped at maxBackoffMs
+    uint32_t shift = errors > 0 ? errors - 1 : 0;
+    if (shift > 16) shift = 16;
+    uint64_t delayMs = (uint64_t)pollPolicy.normalMs << shift;
+    if (delayMs > pollPolicy.maxBackoffMs) delayMs = pollPolicy.maxBackoffMs;
+
+    // +-25% jitter so several controllers don't retry in lockstep
+    uint32_t span = (uint32_t)delayMs / 2;
+    return (uint32_t)delayMs - span / 2 + (span ? random(span) : 0);
+  }
+
+  bool changing = t.powerSeen && fabsf(power - t.power) >= pollPolicy.powerDeltaW;
+  t.power = power;
+  t.powerSeen = true;
+
+  if (busy || changing) {
+    t.mode = PollFast;
+    return pollPolicy.fastMs;
+  }
+  if (!relayOn) {
+    t.mode = PollIdle;
+    return pollPolicy.idleMs;
+  }
+  t.mode = PollNormal;
+  return pollPolicy.normalMs;
+}
+
+PollMode pollSchedulerMode(uint8_t relayId) {
+  return tracks[relayId < MAX_RELAYS ? relayId : PRIMARY_RELAY].mode;
+}
+
+const char* pollModeName(PollMode mode) {
+  switch (mode) {
+    case PollFast:    return "fast";
+    case PollNormal:  return "normal";
+    case PollIdle:    return "idle";
+    case PollBackoff: return "backoff";
+  }
+  return "?";
+}
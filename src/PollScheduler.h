@@ -0,0 +1,72 @@
+/**
+ * @file PollScheduler.h
+ * @brief Adaptive relay report poll interval
+ *
+ * Chooses the delay until the next /report poll from the current activity:
+ * - Fast while the auto-off timer runs, logging is active or power changes quickly
+ * - Idle (slow) while the relay is switched off
+ * - Normal otherwise
+ * - Exponential backoff with jitter while the relay is unreachable
+ *
+ * Every relay is scheduled independently with the shared policy.
+ * Policy parameters are persisted in the "coreone" NVS namespace.
+ */
+
+#pragma once
+#include <Arduino.h>
+#include "Relays.h"
+
+/**
+ * @brief Poll scheduler modes
+ */
+enum PollMode {
+  PollFast,     ///< Timer running, logging or power changing quickly
+  PollNormal,   ///< Relay on, nothing special going on
+  PollIdle,     ///< Relay off, printer idle
+  PollBackoff   ///< Relay unreachable, exponential backoff
+};
+
+/**
+ * @brief Poll policy parameters (stored in NVS)
+ */
+struct PollPolicy {
+  uint32_t fastMs;        ///< Interval while busy (default 1 s)
+  uint32_t normalMs;      ///< Interval while relay is on (default 5 s)
+  uint32_t idleMs;        ///< Interval while relay is off (default 15 s)
+  uint32_t maxBackoffMs;  ///< Upper bound of the error backoff (default 60 s)
+  float    powerDeltaW;   ///< Power change between polls that counts as "changing quickly"
+};
+
+extern PollPolicy pollPolicy;  ///< Active poll policy
+
+/**
+ * @brief Load poll policy from NVS, falling back to defaults
+ */
+void loadPollPolicy();
+
+/**
+ * @brief Clamp policy to sane ranges and save it to NVS
+ */
+void savePollPolicy();
+
+/**
+ * @brief Compute the delay until the next poll after a report result
+ * @param relayId Relay slot the report belongs to
+ * @param reportOk Last report succeeded
+ * @param errors Consecutive failed reports
+ * @param busy Auto-off timer running or logging active
+ * @param relayOn Relay state from the last good report
+ * @param power Power from the last good report in watts
+ * @return Delay until the next poll in milliseconds
+ */
+uint32_t pollSchedulerNext(uint8_t relayId, bool reportOk, uint32_t errors, bool busy, bool relayOn, float power);
+
+/**
+ * @brief Mode chosen by the last pollSchedulerNext() call for a relay
+ */
+PollMode pollSchedulerMode(uint8_t relayId);
+
+/**
+ * @brief Printable name of a poll mode ("fast", "normal", "idle", "backoff")
+ */
+const char* pollModeName(PollMode mode);
@@ -0,0 +1,576 @@
+/**
+ * @file PowerLog.cpp
+ * @brief Power log storage and /api/log_data streaming
+ */
+
+#include <Arduino.h>
+#include "PowerLog.h"
+
+PowerLogRecord powerLog[MAX_LOG_ENTRIES];
+size_t powerLogCount = 0;
+size_t powerLogIndex = 0;  // Circular buffer index
+uint32_t powerLogSeq = 0;
+
+static uint8_t  lowTariffBits[(MAX_LOG_ENTRIES + 7) / 8];  ///< Bit set = logged in the low tariff
+static uint8_t  anchorBits[(MAX_LOG_ENTRIES + 7) / 8];     ///< Bit set = slot holds a PowerLogAnchor
+static size_t   sampleCount = 0;  ///< Samples in the ring, powerLogCount without anchors
+static uint32_t baseTime   = 0;  ///< Quantized time before the oldest record
+static uint32_t baseEnergy = 0;  ///< Quantized energy before the oldest record
+static uint32_t baseCost   = 0;  ///< Quantized cost before the oldest record
+static uint32_t lastTime   = 0;  ///< Quantized time of the newest record
+static uint32_t lastEnergy = 0;  ///< Quantized energy of the newest record
+static uint32_t lastCost   = 0;  ///< Quantized cost of the newest record
+
+/**
+ * @brief Rollup ring of one tier and its open bucket
+ */
+struct RollupTier {
+  PowerLogRollup* ring;
+  size_t   capacity;
+  uint32_t bucketMs;
+  size_t   count     = 0;      ///< Closed buckets in ring
+  uint32_t closed    = 0;      ///< Buckets closed since boot, never reset
+  size_t   index     = 0;      ///< Next write position
+  uint16_t samples   = 0;      ///< Samples in the open bucket, 0 = none open
+  uint32_t slot      = 0;      ///< Bucket number of the open bucket
+  uint32_t sum       = 0;      ///< Power sum of the open bucket
+  uint16_t minPower  = 0;
+  uint16_t maxPower  = 0;
+  uint32_t energy    = 0;      ///< Energy at the latest sample
+  uint32_t cost      = 0;      ///< Cost at the latest sample
+  bool     lowTariff = false;  ///< Tariff band of the latest sample
+
+  RollupTier(PowerLogRollup* ring, size_t capacity, uint32_t bucketMs)
+      : ring(ring), capacity(capacity), bucketMs(bucketMs) {}
+};
+
+static PowerLogRollup fineRing[POWER_LOG_FINE_ENTRIES];
+static PowerLogRollup coarseRing[POWER_LOG_COARSE_ENTRIES];
+static RollupTier fineTier(fineRing, POWER_LOG_FINE_ENTRIES, POWER_LOG_FINE_MS);
+static RollupTier coarseTier(coarseRing, POWER_LOG_COARSE_ENTRIES, POWER_LOG_COARSE_MS);
+
+static_assert(sizeof(powerLog) + sizeof(lowTariffBits) + sizeof(anchorBits) + sizeof(fineRing) + sizeof(coarseRing)
+                  <= POWER_LOG_RAM_BUDGET,
+              "Power log tiers exceed POWER_LOG_RAM_BUDGET");
+
+/**
+ * @brief Add a sample to the open bucket, closing the previous bucket first
+ */
+static void tierAdd(RollupTier& t, uint32_t timestampMs, const PowerLogRecord& sample, uint32_t energy,
+                    uint32_t cost, bool lowTariff) {
+  uint32_t slot = timestampMs / t.bucketMs;
+  if (t.samples > 0 && slot != t.slot) {
+    PowerLogRollup& r = t.ring[t.index];
+    r.slot     = (t.slot & ~POWER_LOG_ROLLUP_LOW_TARIFF) | (t.lowTariff ? POWER_LOG_ROLLUP_LOW_TARIFF : 0);
+    r.minPower = t.minPower;
+    r.avgPower = (t.sum + t.samples / 2) / t.samples;
+    r.maxPower = t.maxPower;
+    r.energy   = t.energy;
+    r.cost     = t.cost;
+    t.index = (t.index + 1) % t.capacity;
+    if (t.count < t.capacity) t.count++;
+    t.closed++;
+    t.samples = 0;
+  }
+  if (t.samples == 0) {
+    t.slot     = slot;
+    t.sum      = 0;
+    t.minPower = 0xFFFF;
+    t.maxPower = 0;
+  }
+  t.sum += sample.power;
+  if (sample.minPower < t.minPower) t.minPower = sample.minPower;
+  if (sample.maxPower > t.maxPower) t.maxPower = sample.maxPower;
+  t.energy    = energy;
+  t.cost      = cost;
+  t.lowTariff = lowTariff;
+  if (t.samples < 0xFFFF) t.samples++;
+}
+
+static void tierClear(RollupTier& t) {
+  t.count   = 0;
+  t.index   = 0;
+  t.samples = 0;
+}
+
+static size_t tierOldest(const RollupTier& t) {
+  return (t.index + t.capacity - t.count) % t.capacity;
+}
+
+/**
+ * @brief Closed buckets that end at or before limitMs, from the oldest on
+ */
+static size_t tierCountBefore(const RollupTier& t, uint32_t limitMs) {
+  size_t oldest = tierOldest(t);
+  size_t n = 0;
+  while (n < t.count) {
+    uint32_t slot = t.ring[(oldest + n) % t.capacity].slot & ~POWER_LOG_ROLLUP_LOW_TARIFF;
+    if ((slot + 1) * t.bucketMs > limitMs) break;
+    n++;
+  }
+  return n;
+}
+
+static_assert(sizeof(PowerLogAnchor) == sizeof(PowerLogRecord), "Anchor must fit one ring slot");
+
+static bool fitsDelta(uint32_t value, uint32_t previous) {
+  return value <= previous || value - previous <= 0xFFFF;
+}
+
+/**
+ * @brief Delta of a value that never decreases in the log (a counter reset logs 0)
+ */
+static uint16_t delta(uint32_t value, uint32_t previous) {
+  return value <= previous ? 0 : (uint16_t)(value - previous);
+}
+
+static void setBit(uint8_t* bits, size_t ringIndex, bool on) {
+  uint8_t bit = 1 << (ringIndex % 8);
+  if (on) bits[ringIndex / 8] |= bit;
+  else bits[ringIndex / 8] &= ~bit;
+}
+
+static bool isLowTariff(size_t ringIndex) {
+  return lowTariffBits[ringIndex / 8] & (1 << (ringIndex % 8));
+}
+
+static bool isAnchor(size_t ringIndex) {
+  return anchorBits[ringIndex / 8] & (1 << (ringIndex % 8));
+}
+
+static PowerLogAnchor anchorAt(size_t ringIndex) {
+  PowerLogAnchor a;
+  memcpy(&a, &powerLog[ringIndex], sizeof(a));
+  return a;
+}
+
+/**
+ * @brief Take the next ring slot, folding the one it overwrites into the base values
+ * @return Ring index of the slot
+ */
+static size_t claimSlot(bool anchor) {
+  size_t slot = powerLogIndex;
+  if (powerLogCount == MAX_LOG_ENTRIES) {
+    if (isAnchor(slot)) {
+      PowerLogAnchor a = anchorAt(slot);
+      baseTime   = a.time;
+      baseEnergy = a.energy;
+      baseCost   = a.cost;
+    } else {
+      const PowerLogRecord& old = powerLog[slot];
+      baseTime   += old.timeDelta;
+      baseEnergy += old.energyDelta;
+      baseCost   += old.costDelta;
+      sampleCount--;
+    }
+  } else {
+    powerLogCount++;
+  }
+  setBit(anchorBits, slot, anchor);
+  if (!anchor) sampleCount++;
+  powerLogIndex = (slot + 1) % MAX_LOG_ENTRIES;
+  return slot;
+}
+
+/**
+ * @brief Decode one record from quantized absolute time, energy and cost
+ */
+static void decode(size_t ringIndex, uint32_t time, uint32_t energy, uint32_t cost, PowerLogEntry& out) {
+  out.timestamp = time * POWER_LOG_TIME_UNIT_MS;
+  out.power     = powerLog[ringIndex].power * POWER_LOG_POWER_UNIT_W;
+  out.minPower  = powerLog[ringIndex].minPower * POWER_LOG_POWER_UNIT_W;
+  out.maxPower  = powerLog[ringIndex].maxPower * POWER_LOG_POWER_UNIT_W;
+  out.energy    = energy * POWER_LOG_ENERGY_UNIT_WH;
+  out.lowTariff = isLowTariff(ringIndex);
+  out.cost      = cost * POWER_LOG_COST_UNIT;
+}
+
+/**
+ * @brief Decode a rollup as one entry at the end of its bucket
+ */
+static void decodeRollup(const RollupTier& t, size_t ringIndex, PowerLogEntry& out) {
+  const PowerLogRollup& r = t.ring[ringIndex];
+  bool lowTariff = r.slot & POWER_LOG_ROLLUP_LOW_TARIFF;
+  out.timestamp = ((r.slot & ~POWER_LOG_ROLLUP_LOW_TARIFF) + 1) * t.bucketMs;
+  out.power     = r.avgPower * POWER_LOG_POWER_UNIT_W;
+  out.minPower  = r.minPower * POWER_LOG_POWER_UNIT_W;
+  out.maxPower  = r.maxPower * POWER_LOG_POWER_UNIT_W;
+  out.energy    = r.energy * POWER_LOG_ENERGY_UNIT_WH;
+  out.cost      = r.cost * POWER_LOG_COST_UNIT;
+  out.lowTariff = lowTariff;
+}
+
+void powerLogBegin() {
+  // Lower half of the range, comparisons never wrap in practice
+  powerLogSeq = esp_random() >> 1;
+}
+
+void powerLogPush(uint32_t timestamp, float power, float minPower, float maxPower,
+                  float energy, float cost, bool lowTariff) {
+  uint32_t time = (timestamp + POWER_LOG_TIME_UNIT_MS / 2) / POWER_LOG_TIME_UNIT_MS;
+  uint32_t energyQ = energy > 0 ? (uint32_t)lroundf(energy / POWER_LOG_ENERGY_UNIT_WH) : 0;
+  uint32_t costQ = cost > 0 ? (uint32_t)lroundf(cost / POWER_LOG_COST_UNIT) : 0;
+
+  if (!fitsDelta(time, lastTime) || !fitsDelta(energyQ, lastEnergy) || !fitsDelta(costQ, lastCost)) {
+    // Escape: absolute values in the slot before the sample, its deltas are then 0
+    PowerLogAnchor a = { time, energyQ, costQ };
+    memcpy(&powerLog[claimSlot(true)], &a, sizeof(a));
+    lastTime   = time;
+    lastEnergy = energyQ;
+    lastCost   = costQ;
+  }
+
+  size_t slot = claimSlot(false);
+  PowerLogRecord& r = powerLog[slot];
+  r.timeDelta   = delta(time, lastTime);
+  r.power       = powerLogQuantizePower(power);
+  r.minPower    = powerLogQuantizePower(minPower);
+  r.maxPower    = powerLogQuantizePower(maxPower);
+  r.energyDelta = delta(energyQ, lastEnergy);
+  r.costDelta   = delta(costQ, lastCost);
+  lastTime   += r.timeDelta;
+  lastEnergy += r.energyDelta;
+  lastCost   += r.costDelta;
+  setBit(lowTariffBits, slot, lowTariff);
+
+  // Consolidate into the rollup tiers as samples arrive
+  uint32_t timeMs = lastTime * POWER_LOG_TIME_UNIT_MS;
+  tierAdd(fineTier, timeMs, r, lastEnergy, lastCost, lowTariff);
+  tierAdd(coarseTier, timeMs, r, lastEnergy, lastCost, lowTariff);
+  powerLogSeq++;
+}
+
+void powerLogClear() {
+  powerLogCount = 0;
+  powerLogIndex = 0;
+  sampleCount = 0;
+  baseTime = baseEnergy = baseCost = 0;
+  lastTime = lastEnergy = lastCost = 0;
+  tierClear(fineTier);
+  tierClear(coarseTier);
+  powerLogSeq++;
+}
+
+bool powerLogLast(PowerLogEntry& out) {
+  if (powerLogCount == 0) return false;
+  decode((powerLogIndex + MAX_LOG_ENTRIES - 1) % MAX_LOG_ENTRIES, lastTime, lastEnergy, lastCost, out);
+  return true;
+}
+
+static const char* const SECTION_HEADERS[] = {
+  "{\"timestamps\":[", "],\"power\":[", "],\"energy\":[", "],\"cost\":[", "],\"min\":[", "],\"max\":["
+};
+static const unsigned char SECTION_DECIMALS[] = { 0, 2, 3, 4, 2, 2 };
+constexpr uint8_t SECTION_COUNT = sizeof(SECTION_DECIMALS);
+
+/**
+ * @brief Quantized time of the oldest sample
+ */
+static uint32_t oldestSampleTime() {
+  size_t slot = powerLogOldest();
+  uint32_t time = baseTime;
+  if (isAnchor(slot)) {
+    time = anchorAt(slot).time;
+    slot = (slot + 1) % MAX_LOG_ENTRIES;
+  }
+  return time + powerLog[slot].timeDelta;
+}
+
+PowerLogRange powerLogRange() {
+  PowerLogRange range = { powerLogOldest(), sampleCount, powerLogSeq, false, 0, 0, 0, 0 };
+  if (sampleCount == 0) return range;
+
+  // Each tier only contributes what is older than the next finer one
+  uint32_t limitMs = oldestSampleTime() * POWER_LOG_TIME_UNIT_MS;
+  range.fineStart = tierOldest(fineTier);
+  range.fineCount = tierCountBefore(fineTier, limitMs);
+  if (range.fineCount > 0) {
+    limitMs = (fineRing[range.fineStart].slot & ~POWER_LOG_ROLLUP_LOW_TARIFF) * POWER_LOG_FINE_MS;
+  }
+  range.coarseStart = tierOldest(coarseTier);
+  range.coarseCount = tierCountBefore(coarseTier, limitMs);
+  return range;
+}
+
+uint32_t powerLogSpanMs() {
+  PowerLogRange range = powerLogRange();
+  if (range.count == 0) return 0;
+  uint32_t oldestMs = oldestSampleTime() * POWER_LOG_TIME_UNIT_MS;
+  if (range.coarseCount > 0) {
+    oldestMs = ((coarseRing[range.coarseStart].slot & ~POWER_LOG_ROLLUP_LOW_TARIFF) + 1) * POWER_LOG_COARSE_MS;
+  } else if (range.fineCount > 0) {
+    oldestMs = ((fineRing[range.fineStart].slot & ~POWER_LOG_ROLLUP_LOW_TARIFF) + 1) * POWER_LOG_FINE_MS;
+  }
+  return lastTime * POWER_LOG_TIME_UNIT_MS - oldestMs;
+}
+
+PowerLogRange powerLogRange(uint32_t since) {
+  PowerLogRange range = powerLogRange();
+  uint32_t oldestSeq = powerLogSeq - sampleCount;
+  range.reset = since < oldestSeq || since > powerLogSeq;
+  if (!range.reset) {
+    range.count = powerLogSeq - since;
+    // Slot of the first new sample, anchors do not count as samples
+    range.start = powerLogIndex;
+    for (size_t n = 0; n < range.count;) {
+      range.start = (range.start + MAX_LOG_ENTRIES - 1) % MAX_LOG_ENTRIES;
+      if (!isAnchor(range.start)) n++;
+    }
+    range.coarseCount = range.fineCount = 0;  // Client already has the older history
+  }
+  return range;
+}
+
+PowerLogReader::PowerLogReader(const PowerLogRange& range) : range_(range), failed_(false) {
+  // Values before the first record of the range, summed from the closer end
+  size_t oldest = powerLogOldest();
+  size_t offset = (range.start + MAX_LOG_ENTRIES - oldest) % MAX_LOG_ENTRIES;
+  bool found = false;
+  if (offset > powerLogCount / 2) {
+    // Back from the newest sample, deltas cannot be undone across an anchor
+    uint32_t time = 0, energy = 0, cost = 0;
+    found = true;
+    for (size_t k = offset; k < powerLogCount; k++) {
+      size_t slot = (oldest + k) % MAX_LOG_ENTRIES;
+      if (isAnchor(slot)) {
+        found = false;
+        break;
+      }
+      const PowerLogRecord& r = powerLog[slot];
+      time   += r.timeDelta;
+      energy += r.energyDelta;
+      cost   += r.costDelta;
+    }
+    time_   = lastTime - time;
+    energy_ = lastEnergy - energy;
+    cost_   = lastCost - cost;
+  }
+  if (!found) {
+    // Forward from the last anchor before the range, or from the base values
+    size_t k = offset;
+    while (k > 0 && !isAnchor((oldest + k - 1) % MAX_LOG_ENTRIES)) k--;
+    PowerLogAnchor a = { baseTime, baseEnergy, baseCost };
+    if (k > 0) a = anchorAt((oldest + k - 1) % MAX_LOG_ENTRIES);
+    time_   = a.time;
+    energy_ = a.energy;
+    cost_   = a.cost;
+    for (; k < offset; k++) {
+      const PowerLogRecord& r = powerLog[(oldest + k) % MAX_LOG_ENTRIES];
+      time_   += r.timeDelta;
+      energy_ += r.energyDelta;
+      cost_   += r.costDelta;
+    }
+  }
+
+  // Copy what the next pushes can overwrite while the range is streamed
+  slot_ = range_.start;
+  for (size_t k = 0; k < POWER_LOG_READER_HEAD && k < range_.coarseCount; k++) {
+    decodeRollup(coarseTier, (range_.coarseStart + k) % POWER_LOG_COARSE_ENTRIES, head_[0][k]);
+  }
+  for (size_t k = 0; k < POWER_LOG_READER_HEAD && k < range_.fineCount; k++) {
+    decodeRollup(fineTier, (range_.fineStart + k) % POWER_LOG_FINE_ENTRIES, head_[1][k]);
+  }
+  for (size_t k = 0; k < POWER_LOG_READER_HEAD && k < range_.count; k++) {
+    nextSample(head_[2][k]);
+  }
+  serial_[0]  = coarseTier.closed - coarseTier.count;
+  serial_[1]  = fineTier.closed - fineTier.count;
+  tailSlot_   = slot_;
+  tailTime_   = time_;
+  tailEnergy_ = energy_;
+  tailCost_   = cost_;
+  rewind();
+}
+
+void PowerLogReader::rewind() {
+  item_   = 0;
+  slot_   = tailSlot_;
+  time_   = tailTime_;
+  energy_ = tailEnergy_;
+  cost_   = tailCost_;
+}
+
+/**
+ * @brief Decode the sample at slot_ and move past it
+ */
+void PowerLogReader::nextSample(PowerLogEntry& out) {
+  while (isAnchor(slot_)) {
+    PowerLogAnchor a = anchorAt(slot_);
+    time_   = a.time;
+    energy_ = a.energy;
+    cost_   = a.cost;
+    slot_   = (slot_ + 1) % MAX_LOG_ENTRIES;
+  }
+  const PowerLogRecord& r = powerLog[slot_];
+  time_   += r.timeDelta;
+  energy_ += r.energyDelta;
+  cost_   += r.costDelta;
+  decode(slot_, time_, energy_, cost_, out);
+  slot_ = (slot_ + 1) % MAX_LOG_ENTRIES;
+}
+
+bool PowerLogReader::fail() {
+  if (!failed_) Serial.println("Power log: streamed range was overwritten, response ended early");
+  failed_ = true;
+  return false;
+}
+
+bool PowerLogReader::next(PowerLogEntry& out) {
+  if (failed_) return false;
+
+  // Tier and index within it: coarse rollups, fine rollups, samples
+  const size_t counts[3] = { range_.coarseCount, range_.fineCount, range_.count };
+  uint8_t tier = 0;
+  size_t k = item_;
+  while (tier < 3 && k >= counts[tier]) k -= counts[tier++];
+  if (tier == 3) return false;
+
+  if (k < POWER_LOG_READER_HEAD) {
+    out = head_[tier][k];
+  } else if (tier < 2) {
+    const RollupTier& t = tier == 0 ? coarseTier : fineTier;
+    if (serial_[tier] + k < t.closed - t.count) return fail();
+    decodeRollup(t, ((tier == 0 ? range_.coarseStart : range_.fineStart) + k) % t.capacity, out);
+  } else {
+    // The oldest sample may have lost its anchor already, so it counts as overwritten
+    if (range_.seq - range_.count + k <= powerLogSeq - sampleCount) return fail();
+    nextSample(out);
+  }
+  item_++;
+  return true;
+}
+
+/**
+ * @brief Field of an entry as raw 32-bit value
+ * @param field 0..5 = timestamp, power, energy, cost, min power, max power
+ */
+static const void* entryField(const PowerLogEntry& e, uint8_t field) {
+  switch (field) {
+    case 0:  return &e.timestamp;
+    case 1:  return &e.power;
+    case 2:  return &e.energy;
+    case 3:  return &e.cost;
+    case 4:  return &e.minPower;
+    default: return &e.maxPower;
+  }
+}
+
+PowerLogJsonWriter::PowerLogJsonWriter(const PowerLogRange& range, bool cursor)
+    : range_(range), reader_(range), cursor_(cursor), section_(0), item_(0), opened_(false),
+      tokenLen_(0), tokenPos_(0) {}
+
+/**
+ * @brief Format the next header, value or closing bracket into token_
+ * @return false once the document is complete
+ */
+bool PowerLogJsonWriter::nextToken() {
+  tokenPos_ = 0;
+  tokenLen_ = 0;
+
+  if (section_ >= SECTION_COUNT) {
+    if (section_ == SECTION_COUNT) {
+      strcpy(token_, "]}");
+      tokenLen_ = 2;
+      section_++;
+      return true;
+    }
+    return false;
+  }
+
+  if (!opened_ && section_ == 0 && cursor_) {
+    tokenLen_ = snprintf(token_, sizeof(token_), "{\"seq\":%u,\"reset\":%s,\"timestamps\":[",
+                         (unsigned)range_.seq, range_.reset ? "true" : "false");
+    opened_ = true;
+    reader_.rewind();
+    return true;
+  }
+
+  if (!opened_) {
+    tokenLen_ = strlcpy(token_, SECTION_HEADERS[section_], sizeof(token_));
+    opened_ = true;
+    reader_.rewind();
+    return true;
+  }
+
+  if (item_ >= range_.total()) {
+    section_++;
+    item_   = 0;
+    opened_ = false;
+    return nextToken();
+  }
+
+  const PowerLogEntry& e = entry_;
+  if (!reader_.next(entry_)) return false;  // Overwritten, end the document here
+  char* p = token_;
+  if (item_ > 0) *p++ = ',';
+  if (section_ == 0) {
+    ultoa(e.timestamp, p, 10);
+  } else {
+    float v = *(const float*)entryField(e, section_);
+    unsigned char decimals = SECTION_DECIMALS[section_];
+    dtostrf(v, decimals + 2, decimals, p);  // Same as String(v, decimals)
+  }
+  tokenLen_ = strlen(token_);
+  item_++;
+  return true;
+}
+
+size_t PowerLogJsonWriter::read(uint8_t* out, size_t cap) {
+  size_t written = 0;
+  while (written < cap) {
+    if (tokenPos_ >= tokenLen_ && !nextToken()) break;
+    size_t n = tokenLen_ - tokenPos_;
+    if (n > cap - written) n = cap - written;
+    memcpy(out + written, token_ + tokenPos_, n);
+    tokenPos_ += n;
+    written   += n;
+  }
+  return written;
+}
+
+PowerLogBinaryWriter::PowerLogBinaryWriter(const PowerLogRange& range)
+    : range_(range), reader_(range), entryItem_(SIZE_MAX), pos_(0) {
+  uint32_t count = range.total();
+  uint16_t headerSize = POWER_LOG_BIN_HEADER_SIZE;
+  memcpy(header_, "PLOG", 4);
+  header_[4] = POWER_LOG_BIN_VERSION;
+  header_[5] = range.reset ? POWER_LOG_BIN_FLAG_RESET : 0;
+  memcpy(header_ + 6, &headerSize, 2);  // ESP32 is little-endian
+  memcpy(header_ + 8, &count, 4);
+  memcpy(header_ + 12, &range.seq, 4);
+}
+
+size_t PowerLogBinaryWriter::read(uint8_t* out, size_t cap) {
+  size_t written = 0;
+  size_t total = length();
+  while (written < cap && pos_ < total) {
+    size_t n;
+    if (pos_ < POWER_LOG_BIN_HEADER_SIZE) {
+      n = POWER_LOG_BIN_HEADER_SIZE - pos_;
+      if (n > cap - written) n = cap - written;
+      memcpy(out + written, header_ + pos_, n);
+    } else {
+      // Column and entry of the current byte, values may be split across calls
+      size_t offset = pos_ - POWER_LOG_BIN_HEADER_SIZE;
+      size_t value  = offset / 4;
+      size_t byte   = offset % 4;
+      uint8_t field = value / range_.total();
+      size_t item   = value % range_.total();
+      // Columns are written one after the other, each one is a pass over the range
+      if (entryItem_ == SIZE_MAX || item < entryItem_) {
+        reader_.rewind();
+        entryItem_ = SIZE_MAX;
+      }
+      while (entryItem_ != item && reader_.next(entry_)) {
+        entryItem_ = entryItem_ == SIZE_MAX ? 0 : entryItem_ + 1;
+      }
+      if (reader_.failed()) break;  // Overwritten, the response ends short
+      n = 4 - byte;
+      if (n > cap - written) n = cap - written;
+      memcpy(out + written, (const uint8_t*)entryField(entry_, field) + byte, n);
+    }
+    pos_    += n;
+    written += n;
+  }
+  return written;
+}
@@ -0,0 +1,390 @@
+/**
+ * @file PowerLog.h
+ * @brief In-RAM power/energy log ring buffer and its JSON stream
+ *
+ * logPowerData() in main.cpp feeds every poll of the printer relay into a
+ * PowerLogInterval and appends one entry per log interval with the average,
+ * minimum and maximum power of those polls, so spikes between two entries
+ * are kept and the poll rate does not change the log size. History is kept
+ * in three tiers of fixed size, RRD style:
+ * - full resolution for the last MAX_LOG_ENTRIES samples (60 min at 10 s)
+ * - 1-minute min/avg/max rollups for 2 h
+ * - 10-minute min/avg/max rollups for 17 h
+ * Every sample is added to the open bucket of both rollup tiers as it
+ * arrives (average of the averages, min of the minima, max of the maxima),
+ * a bucket is closed when the first sample of the next one comes in. When a
+ * tier is full its oldest entry is overwritten.
+ *
+ * The full log (/api/log_data, CSV export) is the merged, time-ordered view:
+ * 10-minute rollups older than the oldest 1-minute rollup, 1-minute rollups
+ * older than the oldest sample, then the samples. Rollups appear with their
+ * power band at the end time of their bucket.
+ *
+ * Samples are stored as 12-byte records of 16-bit fixed-point values (see
+ * PowerLogRecord) plus one tariff bit, instead of the 16-byte float entries
+ * (timestamp, power, energy, cost) of the 500-entry log before. All three
+ * tiers share the 8KB that log took (POWER_LOG_RAM_BUDGET): ~4.3KB for the
+ * samples, ~3.5KB for the two rollup rings. The log keeps 17 h instead of
+ * 83 min; full resolution covers the last hour. Min and max (4 bytes) and
+ * the cost delta (2 bytes) are part of each record: cost is not derived
+ * from energy, since TariffCostMeter prices every poll at the band and
+ * prices of that moment. Absolute values are quantized before the delta is
+ * taken, so rounding errors do not add up over the log:
+ * - timestamp: 100 ms
+ * - power (average, min, max): 0.1 W, up to 6553.5 W
+ * - energy: 0.01 Wh
+ * - cost: 0.00001; integrated per tariff band by TariffCostMeter when the
+ *   sample is logged, see Tariff.h
+ * A delta that does not fit 16 bits (a gap over 109 min, more than 655 Wh
+ * or 0.65 cost in one interval, e.g. in JPY or HUF) is not clamped: an
+ * anchor (PowerLogAnchor) with the absolute values takes the ring slot
+ * before the sample, and the sample's deltas start from it.
+ * PowerLogReader decodes them back to PowerLogEntry.
+ *
+ * Every appended entry gets the next sequence number, which is never reset.
+ * Clients pass the last seq they received as cursor (/api/log_data?since=)
+ * and only get newer entries, or all entries with "reset":true when their
+ * cursor is no longer valid (log cleared, ring wrapped past it, reboot).
+ */
+
+#pragma once
+#include <Arduino.h>
+
+#define MAX_LOG_ENTRIES 360  ///< Full resolution samples (~4.3KB RAM)
+
+constexpr size_t   POWER_LOG_RAM_BUDGET     = 8000;    ///< Samples, their flag bits and both rollup rings (500 x 16 bytes before)
+constexpr size_t   POWER_LOG_FINE_ENTRIES   = 120;     ///< 1-minute rollups (~1.9KB RAM)
+constexpr uint32_t POWER_LOG_FINE_MS        = 60000;
+constexpr size_t   POWER_LOG_COARSE_ENTRIES = 102;     ///< 10-minute rollups (~1.6KB RAM)
+constexpr uint32_t POWER_LOG_COARSE_MS      = 600000;
+
+constexpr size_t   POWER_LOG_MAX_ENTRIES    = MAX_LOG_ENTRIES + POWER_LOG_FINE_ENTRIES + POWER_LOG_COARSE_ENTRIES;  ///< All tiers
+constexpr uint32_t POWER_LOG_ROLLUP_MINUTES =
+    POWER_LOG_COARSE_ENTRIES * POWER_LOG_COARSE_MS / 60000 > POWER_LOG_FINE_ENTRIES * POWER_LOG_FINE_MS / 60000
+        ? POWER_LOG_COARSE_ENTRIES * POWER_LOG_COARSE_MS / 60000
+        : POWER_LOG_FINE_ENTRIES * POWER_LOG_FINE_MS / 60000;  ///< History the rollup tiers cover
+
+constexpr size_t   POWER_LOG_READER_HEAD    = 8;       ///< Entries per tier a reader copies up front (~670 bytes)
+
+constexpr uint32_t POWER_LOG_TIME_UNIT_MS = 100;    ///< Timestamp resolution
+constexpr float    POWER_LOG_POWER_UNIT_W = 0.1f;   ///< Power resolution
+constexpr float    POWER_LOG_ENERGY_UNIT_WH = 0.01f; ///< Energy resolution
+constexpr float    POWER_LOG_COST_UNIT      = 0.00001f; ///< Cost resolution (currency)
+
+/**
+ * @brief Watts to POWER_LOG_POWER_UNIT_W, clamped to 16 bits
+ */
+inline uint16_t powerLogQuantizePower(float power) {
+  float q = power / POWER_LOG_POWER_UNIT_W + 0.5f;
+  return q <= 0 ? 0 : (q >= 65535.0f ? 65535 : (uint16_t)q);
+}
+
+/**
+ * @brief One logged sample, decoded
+ */
+struct PowerLogEntry {
+  uint32_t timestamp;  ///< Milliseconds since logging started
+  float power;         ///< Watts, average over the interval
+  float minPower;      ///< Watts, lowest poll in the interval
+  float maxPower;      ///< Watts, highest poll in the interval
+  float energy;        ///< Wh cumulative
+  float cost;          ///< Cost in currency, cumulative
+  bool lowTariff;      ///< Logged in the low tariff window
+};
+
+/**
+ * @brief One stored sample, relative to the previous one
+ */
+struct PowerLogRecord {
+  uint16_t timeDelta;    ///< POWER_LOG_TIME_UNIT_MS since the previous record
+  uint16_t power;        ///< POWER_LOG_POWER_UNIT_W, average
+  uint16_t minPower;     ///< POWER_LOG_POWER_UNIT_W
+  uint16_t maxPower;     ///< POWER_LOG_POWER_UNIT_W
+  uint16_t energyDelta;  ///< POWER_LOG_ENERGY_UNIT_WH since the previous record
+  uint16_t costDelta;    ///< POWER_LOG_COST_UNIT since the previous record
+};
+
+/**
+ * @brief Escape slot before a sample whose deltas do not fit PowerLogRecord
+ */
+struct PowerLogAnchor {
+  uint32_t time;    ///< POWER_LOG_TIME_UNIT_MS since logging started
+  uint32_t energy;  ///< POWER_LOG_ENERGY_UNIT_WH since logging started
+  uint32_t cost;    ///< POWER_LOG_COST_UNIT since logging started
+};
+
+/**
+ * @brief Consolidated samples of one rollup bucket
+ */
+struct PowerLogRollup {
+  uint16_t slot;      ///< Bucket number since logging start (bit 15 = last sample in the low tariff)
+  uint16_t minPower;  ///< POWER_LOG_POWER_UNIT_W
+  uint16_t avgPower;  ///< POWER_LOG_POWER_UNIT_W
+  uint16_t maxPower;  ///< POWER_LOG_POWER_UNIT_W
+  uint32_t energy;    ///< POWER_LOG_ENERGY_UNIT_WH at the last sample of the bucket
+  uint32_t cost;      ///< POWER_LOG_COST_UNIT at the last sample of the bucket
+};
+
+constexpr uint16_t POWER_LOG_ROLLUP_LOW_TARIFF = 0x8000;  ///< Flag in PowerLogRollup::slot
+
+/**
+ * @brief Power of the polls within one log interval
+ */
+struct PowerLogInterval {
+  uint16_t count = 0;
+  float    sum = 0;
+  float    minPower = 0;
+  float    maxPower = 0;
+
+  void add(float power) {
+    if (count == 0 || power < minPower) minPower = power;
+    if (count == 0 || power > maxPower) maxPower = power;
+    sum += power;
+    if (count < 0xFFFF) count++;
+  }
+  float avg() const { return count > 0 ? sum / count : 0; }
+  void reset() { count = 0; sum = 0; }
+};
+
+extern PowerLogRecord powerLog[MAX_LOG_ENTRIES];  ///< Ring buffer storage
+extern size_t powerLogCount;                      ///< Used slots (samples and anchors)
+extern size_t powerLogIndex;                      ///< Next write position
+extern uint32_t powerLogSeq;                      ///< Sequence number of the next entry
+
+/**
+ * @brief Randomize the sequence start so cursors from before a reboot are invalid
+ */
+void powerLogBegin();
+
+/**
+ * @brief Append an entry, overwriting the oldest one when full
+ * @param timestamp Milliseconds since logging started
+ * @param power Watts, average over the interval
+ * @param minPower Watts, lowest poll in the interval
+ * @param maxPower Watts, highest poll in the interval
+ * @param energy Wh since logging started
+ * @param cost Cost since logging started (TariffCostMeter)
+ * @param lowTariff Sample taken in the low tariff window
+ */
+void powerLogPush(uint32_t timestamp, float power, float minPower, float maxPower,
+                  float energy, float cost, bool lowTariff);
+
+/**
+ * @brief Remove all entries
+ * @note Skips one sequence number, so a cursor taken before the clear is
+ *       older than any entry of the new log and gets a reset
+ */
+void powerLogClear();
+
+/**
+ * @brief Ring index of the oldest entry
+ */
+inline size_t powerLogOldest() {
+  return (powerLogCount < MAX_LOG_ENTRIES) ? 0 : powerLogIndex;
+}
+
+/**
+ * @brief Minutes at full resolution at a log interval
+ */
+inline uint32_t powerLogSampleMinutes(uint32_t intervalSeconds) {
+  return (MAX_LOG_ENTRIES * intervalSeconds) / 60;
+}
+
+/**
+ * @brief Minutes of history at a log interval, the longest of the three tiers
+ */
+inline uint32_t powerLogHistoryMinutes(uint32_t intervalSeconds) {
+  uint32_t samples = powerLogSampleMinutes(intervalSeconds);
+  return samples > POWER_LOG_ROLLUP_MINUTES ? samples : POWER_LOG_ROLLUP_MINUTES;
+}
+
+/**
+ * @brief Newest entry, decoded
+ * @return false if the log is empty
+ */
+bool powerLogLast(PowerLogEntry& out);
+
+/**
+ * @brief Entries selected for one /api/log_data response
+ */
+struct PowerLogRange {
+  size_t   start;        ///< Ring index of the first sample (or its anchor)
+  size_t   count;        ///< Number of samples
+  uint32_t seq;          ///< Cursor for the client's next request
+  bool     reset;        ///< Client cursor was invalid, all entries are selected
+  size_t   coarseStart;  ///< Ring index of the first 10-minute rollup
+  size_t   coarseCount;  ///< 10-minute rollups before the 1-minute ones
+  size_t   fineStart;    ///< Ring index of the first 1-minute rollup
+  size_t   fineCount;    ///< 1-minute rollups before the samples
+
+  /**
+   * @brief Entries in the merged view
+   */
+  size_t total() const { return coarseCount + fineCount + count; }
+};
+
+/**
+ * @brief Whole history: older rollups, then all samples
+ */
+PowerLogRange powerLogRange();
+
+/**
+ * @brief Time from the oldest entry of the whole history to the newest sample
+ * @return Milliseconds, 0 if the log is empty
+ */
+uint32_t powerLogSpanMs();
+
+/**
+ * @brief Samples after a client cursor, or the whole history with reset set
+ * @param since seq of the client's last response
+ */
+PowerLogRange powerLogRange(uint32_t since);
+
+/**
+ * @brief Sequential decoder of a range of records
+ *
+ * Yields the range's rollups first, then its samples. Positioning walks the
+ * sample deltas from the closer end of the log once, every next() after
+ * that is O(1).
+ *
+ * A streamed response reads the range over several StateLock sections, and
+ * every powerLogPush() in between overwrites the oldest sample (and, once a
+ * tier is full, the oldest rollup). The first POWER_LOG_READER_HEAD entries
+ * of each tier are therefore decoded at construction, the rest are read
+ * from the rings and checked by sequence number. If the log moved past
+ * them as well (a stream stalled for several log intervals, or the log was
+ * cleared), next() fails instead of returning entries that belong to other
+ * samples.
+ */
+class PowerLogReader {
+ public:
+  /**
+   * @param range Range taken under the same StateLock
+   */
+  explicit PowerLogReader(const PowerLogRange& range);
+
+  /**
+   * @brief Decode the next entry of the range
+   * @return false after the last one, or if it was overwritten (see failed())
+   * @note Caller must hold StateLock
+   */
+  bool next(PowerLogEntry& out);
+
+  /**
+   * @brief Start over at the first entry of the range
+   */
+  void rewind();
+
+  /**
+   * @brief An entry of the range was overwritten before it was read
+   */
+  bool failed() const { return failed_; }
+
+ private:
+  void nextSample(PowerLogEntry& out);
+  bool fail();
+
+  PowerLogRange range_;
+  size_t   item_;         ///< Entries decoded so far
+  size_t   slot_;         ///< Ring index of the next sample or its anchor
+  uint32_t time_;         ///< Quantized absolute values of the previous sample
+  uint32_t energy_;
+  uint32_t cost_;
+  size_t   tailSlot_;     ///< slot_/time_/energy_/cost_ after the copied samples
+  uint32_t tailTime_;
+  uint32_t tailEnergy_;
+  uint32_t tailCost_;
+  uint32_t serial_[2];    ///< Bucket serial of the first coarse and fine rollup
+  bool     failed_;
+  PowerLogEntry head_[3][POWER_LOG_READER_HEAD];  ///< First coarse, fine and sample entries
+};
+
+/**
+ * @brief Incremental writer for the /api/log_data JSON document
+ *
+ * Produces {"timestamps":[...],"power":[...],"energy":[...],"cost":[...],
+ * "min":[...],"max":[...]}
+ * piece by piece into caller buffers of any size, so the response is sent
+ * with chunked transfer encoding and memory use does not depend on the log
+ * length. Number formatting matches String(value, decimals).
+ *
+ * With a cursor the document starts with "seq" (cursor for the next
+ * request) and "reset" (true if the arrays replace, not extend, the
+ * client's data) and only contains entries from the cursor on.
+ *
+ * @note The range of entries is fixed at construction. If the log moved
+ *       past it while streaming (see PowerLogReader) the document ends
+ *       early, incomplete JSON the client rejects and requests again.
+ */
+class PowerLogJsonWriter {
+ public:
+  /**
+   * @param range Entries to write
+   * @param cursor Write the seq/reset header (request had a cursor)
+   */
+  PowerLogJsonWriter(const PowerLogRange& range, bool cursor);
+
+  /**
+   * @brief Write the next part of the document
+   * @param out Destination buffer
+   * @param cap Size of out
+   * @return Bytes written, 0 once the document is complete
+   * @note Caller must hold StateLock
+   */
+  size_t read(uint8_t* out, size_t cap);
+
+ private:
+  bool nextToken();
+
+  PowerLogRange range_;
+  PowerLogReader reader_;
+  PowerLogEntry  entry_;  ///< Entry of the current item
+  bool    cursor_;     ///< Write the seq/reset header
+  uint8_t section_;    ///< 0..5 = timestamps, power, energy, cost, min, max; 6 = done
+  size_t  item_;       ///< Next entry within the section, range_.total() = section closed
+  bool    opened_;     ///< Section header written
+  char    token_[64];  ///< Formatted piece not yet copied out (fits any float)
+  size_t  tokenLen_;
+  size_t  tokenPos_;
+};
+
+constexpr uint8_t  POWER_LOG_BIN_VERSION     = 2;
+constexpr size_t   POWER_LOG_BIN_HEADER_SIZE = 16;
+constexpr uint8_t  POWER_LOG_BIN_FLAG_RESET  = 0x01;
+constexpr uint8_t  POWER_LOG_BIN_COLUMNS     = 6;
+
+/**
+ * @brief Incremental writer for the binary log format (?format=bin)
+ *
+ * Little-endian, 4-byte aligned so a browser can view the columns as
+ * typed arrays without copying:
+ * - Header (16 bytes): "PLOG", version (u8), flags (u8, bit 0 = reset),
+ *   header size (u16), count (u32), seq (u32)
+ * - timestamp ms (u32 x count), then power W, energy Wh, cost, min power W,
+ *   max power W (f32 x count each)
+ */
+class PowerLogBinaryWriter {
+ public:
+  explicit PowerLogBinaryWriter(const PowerLogRange& range);
+
+  /**
+   * @brief Write the next part of the document
+   * @return Bytes written, 0 once the document is complete or the range
+   *         was overwritten (shorter than length(), see PowerLogReader)
+   * @note Caller must hold StateLock
+   */
+  size_t read(uint8_t* out, size_t cap);
+
+  /**
+   * @brief Size of the whole document
+   */
+  size_t length() const { return POWER_LOG_BIN_HEADER_SIZE + range_.total() * POWER_LOG_BIN_COLUMNS * sizeof(uint32_t); }
+
+ private:
+  PowerLogRange  range_;
+  PowerLogReader reader_;
+  PowerLogEntry  entry_;                        ///< Entry of the current value
+  size_t  entryItem_;                           ///< Item index of entry_, SIZE_MAX = none
+  size_t  pos_;                                 ///< Bytes written so far
+  uint8_t header_[POWER_LOG_BIN_HEADER_SIZE];
+};
@@ -0,0 +1,257 @@
+/**
+ * @file RelayClient.cpp
+ * @brief Implementation of the relay worker task
+ */
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include "RelayClient.h"
+#include "RelayDrivers.h"
+
+struct RelayRequest {
+  RelayRequestType type;
+  RelayDriverType  driver;
+  char             host[RELAY_HOST_MAX_LEN];
+  uint32_t         submitMs;
+};
+
+/**
+ * @brief Kept-alive TCP connection to a relay host
+ */
+struct PooledConnection {
+  char       host[RELAY_HOST_MAX_LEN];  ///< Host this socket is connected to, empty if unused
+  WiFiClient client;                    ///< Socket reused across requests
+};
+
+static QueueHandle_t resultQueue = nullptr;
+
+/**
+ * @brief Per-relay worker context
+ * @note Everything except requestQueue and stats is only touched by the worker task
+ */
+struct RelayWorker {
+  uint8_t             id;            ///< Relay slot served by this worker
+  QueueHandle_t       requestQueue;  ///< Requests for this relay
+  TaskHandle_t        task;          ///< Worker task, nullptr until first use
+  PooledConnection    conn;          ///< Kept-alive socket to the relay
+  StaticPoolAllocator allocator;     ///< Report parse memory
+  RelayClientStats    stats;         ///< Counters, written only by the worker task
+};
+
+static RelayWorker  workers[MAX_RELAYS];
+static JsonDocument reportFilters[RELAY_DRIVER_COUNT];  ///< Per driver, shared read-only by all workers
+
+/**
+ * @brief Get the worker's connection for a host, dropping the socket if the relay IP changed
+ */
+static PooledConnection& acquireConnection(RelayWorker& w, const char* host) {
+  if (strcmp(w.conn.host, host) != 0) {
+    w.conn.client.stop();
+    strlcpy(w.conn.host, host, sizeof(w.conn.host));
+  }
+  return w.conn;
+}
+
+/**
+ * @brief Perform one GET on the worker's socket, keeping it open if the relay allows
+ * @return HTTP status code or negative HTTPClient error
+ */
+template <typename Driver>
+static int performGet(RelayWorker& w, const RelayRequest& req, RelayResult& result) {
+  String url = "http://" + String(req.host) + Driver::path(req.type);
+
+  HTTPClient http;
+  http.setReuse(true);                           // HTTP/1.1 keep-alive
+  http.begin(w.conn.client, url);
+  http.setTimeout(RELAY_HTTP_TIMEOUT_MS);        // Fail fast if unreachable
+  http.setConnectTimeout(RELAY_HTTP_TIMEOUT_MS); // Also set connection timeout
+  int code = http.GET();
+
+  if (code == 200) {
+    if (req.type == RelayReqReport) {
+      if (http.getSize() >= 0) {
+        // Content-Length known: parse straight from the socket
+        result.ok = parseReport<Driver>(w.allocator, reportFilters[Driver::type], http.getStream(), result);
+      } else {
+        // Chunked body, let HTTPClient decode it first
+        String payload = http.getString();
+        result.ok = parseReport<Driver>(w.allocator, reportFilters[Driver::type], payload, result);
+      }
+    } else {
+      result.ok = true;
+    }
+  }
+  http.end();  // Leaves the socket open if the response allowed reuse
+  return code;
+}
+
+/**
+ * @brief Dispatch a GET to the configured driver
+ */
+static int performGetWithDriver(RelayWorker& w, const RelayRequest& req, RelayResult& result) {
+  switch (req.driver) {
+    case RelayDriverShellyGen1: return performGet<ShellyGen1Driver>(w, req, result);
+    case RelayDriverShellyGen2: return performGet<ShellyGen2Driver>(w, req, result);
+    case RelayDriverTasmota:    return performGet<TasmotaDriver>(w, req, result);
+    default:                    return performGet<MyStromDriver>(w, req, result);
+  }
+}
+
+/**
+ * @brief Whether a request that failed on a kept-alive socket may be sent again
+ * @note A toggle is not idempotent: after a read timeout or lost connection
+ *       the relay may already have switched, so it is only repeated if it
+ *       never left the device
+ */
+static bool retryable(RelayRequestType type, int httpCode) {
+  if (httpCode >= 0) return false;
+  if (type != RelayReqToggle) return true;  // Report, on and off give the same result twice
+  return httpCode == HTTPC_ERROR_CONNECTION_REFUSED ||
+         httpCode == HTTPC_ERROR_SEND_HEADER_FAILED ||
+         httpCode == HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+}
+
+/**
+ * @brief Execute one request, blocking only the worker task
+ */
+static void executeRequest(RelayWorker& w, const RelayRequest& req, RelayResult& result) {
+  memset(&result, 0, sizeof(result));
+  result.relayId  = w.id;
+  result.type     = req.type;
+  result.submitMs = req.submitMs;
+
+  if (WiFi.status() != WL_CONNECTED) return;
+
+  PooledConnection& conn = acquireConnection(w, req.host);
+  RelayClientStats& stats = w.stats;
+  uint32_t t0 = millis();
+  bool reused = conn.client.connected();
+  result.httpCode = performGetWithDriver(w, req, result);
+
+  // The relay may have closed an idle kept-alive socket, retry once on a fresh one
+  if (reused && retryable(req.type, result.httpCode)) {
+    conn.client.stop();
+    stats.reconnects++;
+    reused = false;
+    result.httpCode = performGetWithDriver(w, req, result);
+  }
+  if (result.httpCode < 0) {
+    conn.client.stop();
+  }
+
+  result.latencyMs = millis() - t0;
+
+  stats.requests++;
+  stats.lastLatencyMs = result.latencyMs;
+  if (reused) {
+    stats.reused++;
+  } else {
+    stats.handshakes++;
+  }
+  if (result.httpCode > 0) {
+    if (reused) {
+      stats.reusedLatencyTotalMs += result.latencyMs;
+      stats.reusedLatencyCount++;
+    } else {
+      stats.newLatencyTotalMs += result.latencyMs;
+      stats.newLatencyCount++;
+    }
+  } else {
+    stats.failures++;
+  }
+}
+
+static void relayWorker(void* arg) {
+  RelayWorker& w = *static_cast<RelayWorker*>(arg);
+  RelayRequest req;
+  RelayResult result;
+  for (;;) {
+    if (xQueueReceive(w.requestQueue, &req, portMAX_DELAY) != pdTRUE) continue;
+    executeRequest(w, req, result);
+    // Wait a bounded time while loop() is not draining (e.g. WiFi reconnect),
+    // a result dropped after that is expired by loop() after RELAY_REPORT_TIMEOUT_MS
+    xQueueSend(resultQueue, &result, pdMS_TO_TICKS(RELAY_RESULT_WAIT_MS));
+  }
+}
+
+/**
+ * @brief Start the worker task of a relay slot on first use
+ */
+static bool startWorker(RelayWorker& w) {
+  if (w.task) return true;
+
+  if (!w.requestQueue) {
+    w.requestQueue = xQueueCreate(RELAY_REQUEST_QUEUE_LEN, sizeof(RelayRequest));
+    if (!w.requestQueue) {
+      Serial.printf("RelayClient: queue allocation failed for relay %u\n", w.id);
+      return false;
+    }
+  }
+
+  // Run on core 0 next to the WiFi stack, loop() stays on core 1
+  char name[8];
+  snprintf(name, sizeof(name), "relay%u", w.id);
+  if (xTaskCreatePinnedToCore(relayWorker, name, RELAY_WORKER_STACK, &w, 1, &w.task, 0) != pdPASS) {
+    Serial.printf("RelayClient: task creation failed for relay %u\n", w.id);
+    w.task = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool relayClientBegin() {
+  if (resultQueue) return true;
+
+  MyStromDriver::initFilter(reportFilters[MyStromDriver::type]);
+  ShellyGen1Driver::initFilter(reportFilters[ShellyGen1Driver::type]);
+  ShellyGen2Driver::initFilter(reportFilters[ShellyGen2Driver::type]);
+  TasmotaDriver::initFilter(reportFilters[TasmotaDriver::type]);
+  for (uint8_t id = 0; id < MAX_RELAYS; id++) {
+    workers[id].id = id;
+  }
+
+  resultQueue = xQueueCreate(RELAY_RESULT_QUEUE_LEN, sizeof(RelayResult));
+  if (!resultQueue) {
+    Serial.println("RelayClient: queue allocation failed");
+    return false;
+  }
+  return true;
+}
+
+bool relayClientSubmit(uint8_t relayId, RelayDriverType driver, RelayRequestType type, const String& host) {
+  if (!resultQueue || relayId >= MAX_RELAYS) return false;
+
+  RelayWorker& w = workers[relayId];
+  if (!startWorker(w)) return false;
+
+  RelayRequest req;
+  req.type     = type;
+  req.driver   = driver;
+  req.submitMs = millis();
+  strlcpy(req.host, host.c_str(), sizeof(req.host));
+  return xQueueSend(w.requestQueue, &req, 0) == pdTRUE;
+}
+
+bool relayClientPoll(RelayResult& result) {
+  if (!resultQueue) return false;
+  return xQueueReceive(resultQueue, &result, 0) == pdTRUE;
+}
+
+void relayClientGetStats(RelayClientStats& out) {
+  memset(&out, 0, sizeof(out));
+  for (const RelayWorker& w : workers) {
+    const RelayClientStats& s = w.stats;
+    out.requests             += s.requests;
+    out.failures             += s.failures;
+    out.handshakes           += s.handshakes;
+    out.reused               += s.reused;
+    out.reconnects           += s.reconnects;
+    out.newLatencyTotalMs    += s.newLatencyTotalMs;
+    out.newLatencyCount      += s.newLatencyCount;
+    out.reusedLatencyTotalMs += s.reusedLatencyTotalMs;
+    out.reusedLatencyCount   += s.reusedLatencyCount;
+  }
+  out.lastLatencyMs = workers[PRIMARY_RELAY].stats.lastLatencyMs;
+}
@@ -0,0 +1,124 @@
+/**
+ * @file RelayClient.h
+ * @brief Non-blocking HTTP client for the relay device
+ *
+ * Relay HTTP requests run on dedicated FreeRTOS tasks so that loop() never
+ * waits on the network. Each relay slot has its own worker task and request
+ * queue, so a slow or unreachable relay does not delay polls of the others
+ * while requests to one relay stay in order. Requests are queued with
+ * relayClientSubmit() and the results of all workers are collected in loop()
+ * with relayClientPoll(), which keeps all global state updates on the main
+ * loop task.
+ *
+ * Each worker keeps its socket open between requests (HTTP/1.1 keep-alive),
+ * shared by the report poller and the command path, so most requests skip
+ * the TCP handshake. A request that fails on a kept-alive socket (closed by
+ * the relay while idle) is sent once more on a new one; a toggle only if it
+ * never left the device, so it cannot switch the relay twice.
+ *
+ * The HTTP protocol (myStrom, Shelly Gen1/Gen2, Tasmota) is chosen per request
+ * from the relay's configured driver, see RelayDrivers.h. Reports are parsed
+ * directly from the HTTP stream with the driver's field filter into a
+ * statically allocated document, so polling does not allocate heap memory.
+ */
+
+#pragma once
+#include <Arduino.h>
+#include "Relays.h"
+
+constexpr uint32_t RELAY_HTTP_TIMEOUT_MS   = 300;  ///< Connect and read timeout per request
+constexpr uint8_t  RELAY_REQUEST_QUEUE_LEN = 4;    ///< Pending requests per relay before submit fails
+constexpr uint8_t  RELAY_RESULT_QUEUE_LEN  = 8;    ///< Results of all workers waiting for loop()
+constexpr uint32_t RELAY_RESULT_WAIT_MS    = 1000; ///< Max wait of a worker for room in the result queue
+constexpr uint32_t RELAY_REPORT_TIMEOUT_MS = 8000; ///< Report result counted as lost, > full request queue (4 x 2 x 600 ms) + RELAY_RESULT_WAIT_MS
+constexpr size_t   RELAY_HOST_MAX_LEN      = 16;   ///< "xxx.xxx.xxx.xxx" + terminator
+constexpr size_t   RELAY_BOOT_ID_MAX_LEN   = 32;   ///< Boot ID buffer size incl. terminator
+constexpr size_t   RELAY_REPORT_POOL_SIZE  = 2048; ///< Static JSON memory for one filtered report (per worker)
+constexpr uint32_t RELAY_WORKER_STACK      = 6144; ///< Stack size of each worker task
+
+/**
+ * @brief Relay request types
+ */
+enum RelayRequestType {
+  RelayReqReport,   ///< Fetch JSON status (driver's status endpoint)
+  RelayReqOff,      ///< Switch relay off
+  RelayReqOn,       ///< Switch relay on
+  RelayReqToggle    ///< Toggle relay state
+};
+
+/**
+ * @brief Parsed relay status report, normalized across drivers
+ */
+struct RelayReport {
+  float    power;                             ///< Current power in watts
+  float    ws;                                ///< Watt-seconds measurement
+  bool     relay;                             ///< Relay state
+  float    temperature;                       ///< Device temperature
+  char     bootId[RELAY_BOOT_ID_MAX_LEN];     ///< Relay device boot ID
+  double   energyBoot;                        ///< Energy counter [Ws] (since boot or lifetime, depends on driver), double keeps 0.01 Wh at MWh lifetimes
+  uint32_t timeBoot;                          ///< Time since boot in seconds
+};
+
+/**
+ * @brief Result of a completed relay request
+ */
+struct RelayResult {
+  uint8_t          relayId;    ///< Relay slot this result belongs to
+  RelayRequestType type;       ///< Request type this result belongs to
+  int              httpCode;   ///< HTTP status code, negative HTTPClient error, 0 if WiFi down
+  bool             ok;         ///< Request succeeded (and report parsed for RelayReqReport)
+  const char*      error;      ///< Static parse error text when a report failed to parse
+  uint32_t         latencyMs;  ///< Time spent in the HTTP exchange
+  uint32_t         submitMs;   ///< millis() when the request was queued
+  RelayReport      report;     ///< Parsed report, valid if ok and type == RelayReqReport
+};
+
+/**
+ * @brief Connection and latency counters of the relay workers
+ * @note Latency totals only include requests that got an HTTP response
+ */
+struct RelayClientStats {
+  uint32_t requests;               ///< Completed requests
+  uint32_t failures;               ///< Requests without HTTP response
+  uint32_t handshakes;             ///< Requests that opened a new TCP connection
+  uint32_t reused;                 ///< Requests served on a kept-alive connection
+  uint32_t reconnects;             ///< Stale kept-alive sockets replaced by a retry
+  uint32_t newLatencyTotalMs;      ///< Latency sum of requests with handshake
+  uint32_t newLatencyCount;        ///< Number of samples in newLatencyTotalMs
+  uint32_t reusedLatencyTotalMs;   ///< Latency sum of requests on a reused socket
+  uint32_t reusedLatencyCount;     ///< Number of samples in reusedLatencyTotalMs
+  uint32_t lastLatencyMs;          ///< Latency of the most recent printer relay request
+};
+
+/**
+ * @brief Create the result queue and prepare the relay workers
+ * @return true on success
+ * @note Call once from setup(). Worker tasks are started on first use, so
+ *       unused relay slots cost no task stack.
+ */
+bool relayClientBegin();
+
+/**
+ * @brief Queue a request for the worker of a relay slot
+ * @param relayId Relay slot (0..MAX_RELAYS-1)
+ * @param driver Relay protocol
+ * @param type Request type
+ * @param host Relay IP address
+ * @return true if queued, false if the queue is full or the worker is not running
+ * @note Never blocks
+ */
+bool relayClientSubmit(uint8_t relayId, RelayDriverType driver, RelayRequestType type, const String& host);
+
+/**
+ * @brief Fetch the next completed request result
+ * @param result Filled with the result if one is available
+ * @return true if a result was returned
+ * @note Never blocks, call repeatedly in loop()
+ */
+bool relayClientPoll(RelayResult& result);
+
+/**
+ * @brief Copy the connection statistics summed over all workers
+ * @param out Receives the counters
+ */
+void relayClientGetStats(RelayClientStats& out);
@@ -0,0 +1,216 @@
+/**
+ * @file RelayCommand.cpp
+ * @brief Implementation of the verified relay command pipeline
+ */
+
+#include <Arduino.h>
+#include "RelayCommand.h"
+
+/**
+ * @brief Step within a pending command
+ */
+enum CmdPhase {
+  PhaseSend,      ///< Waiting for nextAttemptMs to submit the command
+  PhaseInFlight,  ///< Command submitted, waiting for HTTP result
+  PhaseVerify     ///< Command accepted, waiting for a report showing the target state
+};
+
+/**
+ * @brief Command pipeline of one relay
+ */
+struct CommandSlot {
+  RelayCmdState state            = RelayCmdIdle;
+  CmdPhase      phase            = PhaseSend;
+  bool          targetOn         = false;
+  bool          rawToggle        = false;  ///< Toggle with unknown relay state, sent once unverified
+  bool          restart          = false;  ///< Target changed while a request was in flight
+  uint8_t       attempts         = 0;
+  uint32_t      startMs          = 0;
+  uint32_t      nextAttemptMs    = 0;
+  uint32_t      verifyAtMs       = 0;
+  uint32_t      phaseStartMs     = 0;      ///< Start of PhaseInFlight/PhaseVerify for timeouts
+  uint32_t      lastOffConfirmMs = 0;
+  uint32_t      offConfirmCount  = 0;
+};
+
+static CommandSlot slots[MAX_RELAYS];
+
+/**
+ * @brief Schedule the next attempt, or fail when out of attempts
+ */
+static void scheduleRetry(uint8_t relayId, CommandSlot& c, uint32_t now) {
+  if (c.attempts >= RELAY_CMD_MAX_ATTEMPTS) {
+    c.state = RelayCmdFailed;
+    Serial.printf("Relay %u %s FAILED after %u attempts\n", relayId, c.targetOn ? "ON" : "OFF", c.attempts);
+    return;
+  }
+  uint32_t backoff = RELAY_CMD_RETRY_BASE_MS << (c.attempts > 0 ? c.attempts - 1 : 0);
+  if (backoff > RELAY_CMD_RETRY_MAX_MS) backoff = RELAY_CMD_RETRY_MAX_MS;
+  c.nextAttemptMs = now + backoff;
+  c.phase = PhaseSend;
+}
+
+void relayCommandRequest(uint8_t relayId, RelayCmdTarget target, bool reportValid, bool relayOn) {
+  if (relayId >= MAX_RELAYS) return;
+  CommandSlot& c = slots[relayId];
+  bool pending = (c.state == RelayCmdPending) && !c.rawToggle;
+  bool targetOn;
+
+  if (target == RelayTargetToggle) {
+    if (pending) {
+      targetOn = !c.targetOn;       // Toggle storm: flip the pending target
+    } else if (reportValid) {
+      targetOn = !relayOn;          // Resolve against last known state
+    } else {
+      // Relay state unknown, send a plain toggle once without verification
+      if (c.state == RelayCmdPending && c.rawToggle && c.phase == PhaseSend) {
+        c.state     = RelayCmdIdle;   // Two unsent toggles cancel out
+        c.rawToggle = false;
+        return;
+      }
+      if (c.state == RelayCmdPending && c.phase == PhaseInFlight) {
+        c.restart = true;             // Send another toggle after the current one
+      } else {
+        c.phase = PhaseSend;
+      }
+      c.rawToggle     = true;
+      c.state         = RelayCmdPending;
+      c.attempts      = 0;
+      c.nextAttemptMs = millis();
+      return;
+    }
+  } else {
+    targetOn = (target == RelayTargetOn);
+  }
+
+  if (pending && targetOn == c.targetOn) return;  // Redundant, already in progress
+
+  if (pending && c.phase == PhaseInFlight) {
+    c.restart = true;  // Resend with the new target once the current request returns
+  } else {
+    c.phase = PhaseSend;
+  }
+  c.state         = RelayCmdPending;
+  c.rawToggle     = false;
+  c.targetOn      = targetOn;
+  c.attempts      = 0;
+  c.startMs       = millis();
+  c.nextAttemptMs = c.startMs;
+}
+
+void relayCommandUpdate(uint8_t relayId, uint32_t now, const String& host, RelayDriverType driver) {
+  if (relayId >= MAX_RELAYS) return;
+  CommandSlot& c = slots[relayId];
+  if (c.state != RelayCmdPending) return;
+
+  // Lost result or no report possible (e.g. WiFi down): count as failed attempt
+  if (c.phase != PhaseSend && now - c.phaseStartMs >= RELAY_CMD_STEP_TIMEOUT_MS) {
+    c.restart = false;
+    if (c.rawToggle) {
+      c.rawToggle = false;
+      c.state = RelayCmdIdle;
+    } else {
+      scheduleRetry(relayId, c, now);
+    }
+    return;
+  }
+
+  if (c.phase != PhaseSend) return;
+  if ((int32_t)(now - c.nextAttemptMs) < 0) return;
+
+  RelayRequestType type = c.rawToggle ? RelayReqToggle : (c.targetOn ? RelayReqOn : RelayReqOff);
+  if (!relayClientSubmit(relayId, driver, type, host)) {
+    c.nextAttemptMs = now + RELAY_CMD_RETRY_BASE_MS;  // Queue full, try again shortly
+    return;
+  }
+  c.attempts++;
+  c.phase        = PhaseInFlight;
+  c.phaseStartMs = now;
+}
+
+void relayCommandOnResult(const RelayResult& result) {
+  Serial.printf("Relay %u command %d -> HTTP %d (%u ms)\n",
+                result.relayId, result.type, result.httpCode, result.latencyMs);
+  uint8_t relayId = result.relayId;
+  if (relayId >= MAX_RELAYS) return;
+  CommandSlot& c = slots[relayId];
+  if (c.state != RelayCmdPending || c.phase != PhaseInFlight) return;
+
+  uint32_t now = millis();
+  if (c.restart) {
+    c.restart = false;
+    c.phase = PhaseSend;
+    c.nextAttemptMs = now;
+    return;
+  }
+
+  if (c.rawToggle) {
+    c.rawToggle = false;
+    c.state = RelayCmdIdle;
+    return;
+  }
+
+  if (result.ok) {
+    c.phase        = PhaseVerify;
+    c.verifyAtMs   = now + RELAY_CMD_VERIFY_DELAY_MS;
+    c.phaseStartMs = now;
+  } else {
+    scheduleRetry(relayId, c, now);
+  }
+}
+
+void relayCommandOnReport(uint8_t relayId, uint32_t requestedMs, bool ok, bool relayOn) {
+  if (relayId >= MAX_RELAYS) return;
+  CommandSlot& c = slots[relayId];
+  if (c.state != RelayCmdPending || c.phase != PhaseVerify) return;
+  if ((int32_t)(requestedMs - c.verifyAtMs) < 0) return;  // Report predates the command
+
+  uint32_t now = millis();
+  if (ok && relayOn == c.targetOn) {
+    c.state = RelayCmdConfirmed;
+    uint32_t elapsed = now - c.startMs;
+    if (!c.targetOn) {
+      c.lastOffConfirmMs = elapsed;
+      c.offConfirmCount++;
+    }
+    Serial.printf("Relay %u %s confirmed after %u ms (%u attempts)\n",
+                  relayId, c.targetOn ? "ON" : "OFF", elapsed, c.attempts);
+    return;
+  }
+  scheduleRetry(relayId, c, now);
+}
+
+bool relayCommandWantsReport(uint8_t relayId, uint32_t now) {
+  if (relayId >= MAX_RELAYS) return false;
+  const CommandSlot& c = slots[relayId];
+  return c.state == RelayCmdPending && c.phase == PhaseVerify &&
+         (int32_t)(now - c.verifyAtMs) >= 0;
+}
+
+bool relayCommandOffPending(uint8_t relayId) {
+  if (relayId >= MAX_RELAYS) return false;
+  const CommandSlot& c = slots[relayId];
+  return c.state == RelayCmdPending && !c.rawToggle && !c.targetOn;
+}
+
+void relayCommandGetStatus(uint8_t relayId, RelayCommandStatus& out) {
+  if (relayId >= MAX_RELAYS) return;
+  const CommandSlot& c = slots[relayId];
+  out.state            = c.state;
+  out.targetOn         = c.targetOn;
+  out.attempts         = c.attempts;
+  out.lastOffConfirmMs = c.lastOffConfirmMs;
+  out.offConfirmCount  = c.offConfirmCount;
+}
+
+const char* relayCommandOffStateName(uint8_t relayId) {
+  if (relayId >= MAX_RELAYS) return "none";
+  const CommandSlot& c = slots[relayId];
+  if (c.targetOn || c.rawToggle) return "none";
+  switch (c.state) {
+    case RelayCmdPending:   return "pending";
+    case RelayCmdConfirmed: return "confirmed";
+    case RelayCmdFailed:    return "failed";
+    default:                return "none";
+  }
+}
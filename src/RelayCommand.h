@@ -0,0 +1,107 @@
+/**
+ * @file RelayCommand.h
+ * @brief Verified and retried relay switching commands
+ *
+ * Each relay has its own pipeline. Commands from the timer, web UI and button
+ * are coalesced into one desired relay state per relay. The pipeline sends it through the relay worker, retries with
+ * bounded backoff and only reports success once a follow-up /report shows the
+ * relay in the requested state.
+ *
+ * Toggles are resolved to an explicit ON/OFF target from the last report (or
+ * the pending target), so retries can never flip the relay twice.
+ */
+
+#pragma once
+#include <Arduino.h>
+#include "RelayClient.h"
+
+constexpr uint8_t  RELAY_CMD_MAX_ATTEMPTS   = 5;     ///< Attempts before a command fails
+constexpr uint32_t RELAY_CMD_RETRY_BASE_MS  = 250;   ///< First retry delay, doubles per attempt
+constexpr uint32_t RELAY_CMD_RETRY_MAX_MS   = 4000;  ///< Retry delay cap
+constexpr uint32_t RELAY_CMD_VERIFY_DELAY_MS = 200;  ///< Settle time before the verification report
+constexpr uint32_t RELAY_CMD_STEP_TIMEOUT_MS = 3000; ///< Max wait for a command result or verification
+
+/**
+ * @brief Requested relay action
+ */
+enum RelayCmdTarget {
+  RelayTargetOff,     ///< Switch relay off
+  RelayTargetOn,      ///< Switch relay on
+  RelayTargetToggle   ///< Invert relay state
+};
+
+/**
+ * @brief Pipeline state of the most recent command
+ */
+enum RelayCmdState {
+  RelayCmdIdle,       ///< No command issued yet (or unverifiable toggle sent)
+  RelayCmdPending,    ///< Sending, retrying or waiting for verification
+  RelayCmdConfirmed,  ///< Relay state confirmed by /report
+  RelayCmdFailed      ///< Gave up after RELAY_CMD_MAX_ATTEMPTS
+};
+
+/**
+ * @brief Snapshot of the command pipeline for status reporting
+ */
+struct RelayCommandStatus {
+  RelayCmdState state;         ///< Pipeline state
+  bool          targetOn;      ///< Requested relay state of the current/last command
+  uint8_t       attempts;      ///< Attempts used by the current/last command
+  uint32_t      lastOffConfirmMs;  ///< Request-to-confirmed time of the last verified OFF
+  uint32_t      offConfirmCount;   ///< Number of verified OFF commands
+};
+
+/**
+ * @brief Request a relay action, coalescing with any pending command
+ * @param relayId Relay slot
+ * @param target Requested action
+ * @param reportValid Last report is valid
+ * @param relayOn Relay state from the last report
+ */
+void relayCommandRequest(uint8_t relayId, RelayCmdTarget target, bool reportValid, bool relayOn);
+
+/**
+ * @brief Send and retry pending commands of one relay
+ * @param relayId Relay slot
+ * @param now Current millis()
+ * @param host Relay IP address
+ * @param driver Relay protocol
+ * @note Call every loop() iteration, never blocks
+ */
+void relayCommandUpdate(uint8_t relayId, uint32_t now, const String& host, RelayDriverType driver);
+
+/**
+ * @brief Feed a completed command request (non-report result) into its relay's pipeline
+ */
+void relayCommandOnResult(const RelayResult& result);
+
+/**
+ * @brief Feed a completed report into the pipeline for verification
+ * @param relayId Relay slot
+ * @param requestedMs millis() when the report request was submitted
+ * @param ok Report succeeded
+ * @param relayOn Relay state from the report
+ */
+void relayCommandOnReport(uint8_t relayId, uint32_t requestedMs, bool ok, bool relayOn);
+
+/**
+ * @brief Whether a relay's pipeline needs a report to verify a command
+ * @param relayId Relay slot
+ * @param now Current millis()
+ */
+bool relayCommandWantsReport(uint8_t relayId, uint32_t now);
+
+/**
+ * @brief True while an OFF command is being sent or verified
+ */
+bool relayCommandOffPending(uint8_t relayId);
+
+/**
+ * @brief Copy the pipeline status of one relay
+ */
+void relayCommandGetStatus(uint8_t relayId, RelayCommandStatus& out);
+
+/**
+ * @brief Printable OFF state for the status API ("none", "pending", "confirmed", "failed")
+ */
+const char* relayCommandOffStateName(uint8_t relayId);
@@ -0,0 +1,247 @@
+/**
+ * @file RelayDrivers.h
+ * @brief Protocol drivers for the supported relay devices
+ *
+ * Each driver is a stateless struct with static members, so the relay worker
+ * instantiates its request and parse code per protocol at compile time and
+ * only switches on the configured RelayDriverType once per request.
+ *
+ * A driver provides:
+ * - path(type): URL path of a request, the report path being the cheapest
+ *   endpoint that still contains relay state and power
+ * - initFilter(filter): ArduinoJson field filter for the report body
+ * - parse(doc, report): fill a RelayReport, energy normalized to Ws
+ *
+ * parseReport() runs a driver's filter and parse over the response body
+ * in a StaticPoolAllocator.
+ *
+ * @note Internal to RelayClient.cpp (and the native tests)
+ */
+
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "RelayClient.h"
+
+/**
+ * @brief myStrom Switch (original protocol of this project)
+ */
+struct MyStromDriver {
+  static constexpr RelayDriverType type = RelayDriverMyStrom;
+
+  static const char* path(RelayRequestType req) {
+    switch (req) {
+      case RelayReqOff:    return "/relay?state=0";
+      case RelayReqOn:     return "/relay?state=1";
+      case RelayReqToggle: return "/toggle";
+      default:             return "/report";
+    }
+  }
+
+  static void initFilter(JsonDocument& filter) {
+    filter["power"]             = true;
+    filter["Ws"]                = true;
+    filter["relay"]             = true;
+    filter["temperature"]       = true;
+    filter["boot_id"]           = true;
+    filter["energy_since_boot"] = true;
+    filter["time_since_boot"]   = true;
+  }
+
+  static bool parse(JsonDocument& doc, RelayReport& r) {
+    if (!doc["relay"].is<bool>()) return false;
+    r.power       = doc["power"] | 0.0f;
+    r.ws          = doc["Ws"] | 0.0f;
+    r.relay       = doc["relay"] | false;
+    r.temperature = doc["temperature"] | 0.0f;
+    strlcpy(r.bootId, doc["boot_id"] | "", sizeof(r.bootId));
+    r.energyBoot  = doc["energy_since_boot"] | 0.0;  // Already Ws
+    r.timeBoot    = doc["time_since_boot"] | 0;
+    return true;
+  }
+};
+
+/**
+ * @brief Shelly Gen1 (Plug S, 1PM, ...), channel 0
+ * @note Gen1 has no single small status call with relay state and power,
+ *       /status is filtered down to the few used fields while streaming
+ */
+struct ShellyGen1Driver {
+  static constexpr RelayDriverType type = RelayDriverShellyGen1;
+
+  static const char* path(RelayRequestType req) {
+    switch (req) {
+      case RelayReqOff:    return "/relay/0?turn=off";
+      case RelayReqOn:     return "/relay/0?turn=on";
+      case RelayReqToggle: return "/relay/0?turn=toggle";
+      default:             return "/status";
+    }
+  }
+
+  static void initFilter(JsonDocument& filter) {
+    filter["relays"][0]["ison"]  = true;
+    filter["meters"][0]["power"] = true;
+    filter["meters"][0]["total"] = true;
+    filter["temperature"]        = true;
+    filter["uptime"]             = true;
+  }
+
+  static bool parse(JsonDocument& doc, RelayReport& r) {
+    if (!doc["relays"][0]["ison"].is<bool>()) return false;
+    r.relay       = doc["relays"][0]["ison"] | false;
+    r.power       = doc["meters"][0]["power"] | 0.0f;
+    r.ws          = r.power;
+    r.energyBoot  = (doc["meters"][0]["total"] | 0.0) * 60.0;  // Watt-minutes -> Ws
+    r.temperature = doc["temperature"] | 0.0f;
+    r.timeBoot    = doc["uptime"] | 0;
+    r.bootId[0]   = '\0';
+    return true;
+  }
+};
+
+/**
+ * @brief Shelly Gen2+ (Plus/Pro) RPC over HTTP GET, switch 0
+ */
+struct ShellyGen2Driver {
+  static constexpr RelayDriverType type = RelayDriverShellyGen2;
+
+  static const char* path(RelayRequestType req) {
+    switch (req) {
+      case RelayReqOff:    return "/rpc/Switch.Set?id=0&on=false";
+      case RelayReqOn:     return "/rpc/Switch.Set?id=0&on=true";
+      case RelayReqToggle: return "/rpc/Switch.Toggle?id=0";
+      default:             return "/rpc/Switch.GetStatus?id=0";
+    }
+  }
+
+  static void initFilter(JsonDocument& filter) {
+    filter["output"]            = true;
+    filter["apower"]            = true;
+    filter["aenergy"]["total"]  = true;
+    filter["temperature"]["tC"] = true;
+  }
+
+  static bool parse(JsonDocument& doc, RelayReport& r) {
+    if (!doc["output"].is<bool>()) return false;
+    r.relay       = doc["output"] | false;
+    r.power       = doc["apower"] | 0.0f;
+    r.ws          = r.power;
+    r.energyBoot  = (doc["aenergy"]["total"] | 0.0) * 3600.0;  // Wh -> Ws
+    r.temperature = doc["temperature"]["tC"] | 0.0f;
+    r.timeBoot    = 0;  // Only in Sys.GetStatus, not worth a second request
+    r.bootId[0]   = '\0';
+    return true;
+  }
+};
+
+/**
+ * @brief Tasmota HTTP command interface, single power channel
+ * @note Status 0 is the only status that contains both POWER and ENERGY
+ */
+struct TasmotaDriver {
+  static constexpr RelayDriverType type = RelayDriverTasmota;
+
+  static const char* path(RelayRequestType req) {
+    switch (req) {
+      case RelayReqOff:    return "/cm?cmnd=Power%20Off";
+      case RelayReqOn:     return "/cm?cmnd=Power%20On";
+      case RelayReqToggle: return "/cm?cmnd=Power%20Toggle";
+      default:             return "/cm?cmnd=Status%200";
+    }
+  }
+
+  static void initFilter(JsonDocument& filter) {
+    filter["StatusSTS"]["POWER"]                = true;
+    filter["StatusSTS"]["UptimeSec"]            = true;
+    filter["StatusSNS"]["ENERGY"]["Power"]      = true;
+    filter["StatusSNS"]["ENERGY"]["Total"]      = true;
+    filter["StatusSNS"]["ESP32"]["Temperature"] = true;
+    filter["StatusPRM"]["StartupUTC"]           = true;
+  }
+
+  static bool parse(JsonDocument& doc, RelayReport& r) {
+    const char* power = doc["StatusSTS"]["POWER"].as<const char*>();
+    if (!power) return false;
+    r.relay       = strcmp(power, "ON") == 0;
+    r.power       = doc["StatusSNS"]["ENERGY"]["Power"] | 0.0f;
+    r.ws          = r.power;
+    // Total is the lifetime counter in kWh, only differences are used
+    r.energyBoot  = (doc["StatusSNS"]["ENERGY"]["Total"] | 0.0) * 3600000.0;  // kWh -> Ws
+    r.temperature = doc["StatusSNS"]["ESP32"]["Temperature"] | 0.0f;
+    r.timeBoot    = doc["StatusSTS"]["UptimeSec"] | 0;
+    // Startup time changes on every restart, so it serves as boot ID
+    strlcpy(r.bootId, doc["StatusPRM"]["StartupUTC"] | "", sizeof(r.bootId));
+    return true;
+  }
+};
+
+/**
+ * @brief Bump allocator over a static buffer used for report documents
+ * @note No heap is touched while parsing. reset() must be called before each
+ *       parse and only after the previous document has been destroyed.
+ */
+class StaticPoolAllocator : public ArduinoJson::Allocator {
+ public:
+  void* allocate(size_t size) override {
+    size = (size + 7) & ~size_t(7);
+    if (used_ + size > sizeof(buffer_)) return nullptr;
+    last_  = buffer_ + used_;
+    used_ += size;
+    return last_;
+  }
+
+  void deallocate(void*) override {}
+
+  void* reallocate(void* ptr, size_t newSize) override {
+    newSize = (newSize + 7) & ~size_t(7);
+    if (ptr == last_) {
+      // Most recent block (e.g. a growing string) can be resized in place
+      size_t offset = last_ - buffer_;
+      if (offset + newSize > sizeof(buffer_)) return nullptr;
+      used_ = offset + newSize;
+      return ptr;
+    }
+    uint8_t* old = static_cast<uint8_t*>(ptr);
+    size_t available = (buffer_ + used_) - old;
+    void* fresh = allocate(newSize);
+    if (fresh) memcpy(fresh, old, newSize < available ? newSize : available);
+    return fresh;
+  }
+
+  void reset() {
+    used_ = 0;
+    last_ = nullptr;
+  }
+
+  /**
+   * @brief Bytes taken since reset(), the high-water mark of the document (nothing is freed)
+   */
+  size_t used() const { return used_; }
+
+ private:
+  alignas(8) uint8_t buffer_[RELAY_REPORT_POOL_SIZE];
+  size_t   used_ = 0;
+  uint8_t* last_ = nullptr;
+};
+
+/**
+ * @brief Parse a status payload into a RelayReport with the driver's filter
+ * @param filter Driver's field filter, see initFilter()
+ * @param input Stream positioned at the response body, or a String payload
+ * @return true on success, result.error is set on failure
+ */
+template <typename Driver, typename TInput>
+bool parseReport(StaticPoolAllocator& allocator, JsonDocument& filter, TInput& input, RelayResult& result) {
+  allocator.reset();
+  JsonDocument doc(&allocator);
+  DeserializationError err = deserializeJson(doc, input, DeserializationOption::Filter(filter));
+  if (err) {
+    result.error = err.c_str();
+    return false;
+  }
+  if (!Driver::parse(doc, result.report)) {
+    result.error = "unexpected status format";  // Usually the wrong driver selected
+    return false;
+  }
+  return true;
+}
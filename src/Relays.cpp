@@ -0,0 +1,93 @@
+/**
+ * @file Relays.cpp
+ * @brief Relay table storage and NVS persistence
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "Relays.h"
+
+RelayState relays[MAX_RELAYS];
+uint32_t   relayConfigVersion = 0;
+
+/**
+ * @brief Build a per-relay NVS key, e.g. "r1_ip"
+ */
+static String relayKey(uint8_t id, const char* suffix) {
+  return "r" + String(id) + "_" + suffix;
+}
+
+const char* relayDriverName(RelayDriverType driver) {
+  switch (driver) {
+    case RelayDriverMyStrom:    return "mystrom";
+    case RelayDriverShellyGen1: return "shelly_gen1";
+    case RelayDriverShellyGen2: return "shelly_gen2";
+    case RelayDriverTasmota:    return "tasmota";
+    default:                    return "?";
+  }
+}
+
+bool relayDriverFromName(const String& name, RelayDriverType& out) {
+  for (uint8_t d = 0; d < RELAY_DRIVER_COUNT; d++) {
+    if (name == relayDriverName((RelayDriverType)d)) {
+      out = (RelayDriverType)d;
+      return true;
+    }
+  }
+  return false;
+}
+
+void loadRelayConfig() {
+  static const char* const defaultNames[MAX_RELAYS] = { "Printer", "Relay 2", "Relay 3" };
+
+  Preferences prefs;
+  prefs.begin("coreone", true); // Read-only
+  for (uint8_t id = 0; id < MAX_RELAYS; id++) {
+    RelayState& r = relays[id];
+    r.name = prefs.getString(relayKey(id, "name").c_str(), defaultNames[id]);
+    uint8_t driver = prefs.getUChar(relayKey(id, "drv").c_str(), RelayDriverMyStrom);
+    r.driver = driver < RELAY_DRIVER_COUNT ? (RelayDriverType)driver : RelayDriverMyStrom;
+    if (id == PRIMARY_RELAY) {
+      // Printer relay follows the global auto mode and off_delay_ms
+      r.ip         = prefs.getString("relay_ip", "192.168.188.44");
+      r.autoOff    = true;
+      r.offDelayMs = 0;
+    } else {
+      r.ip         = prefs.getString(relayKey(id, "ip").c_str(), "");
+      r.autoOff    = prefs.getBool(relayKey(id, "auto").c_str(), false);
+      r.offDelayMs = prefs.getUInt(relayKey(id, "delay").c_str(), 10UL * 60UL * 1000UL);
+    }
+  }
+  prefs.end();
+
+  for (uint8_t id = 0; id < MAX_RELAYS; id++) {
+    if (!relayConfigured(id)) continue;
+    Serial.printf("Relay %u: %s @ %s (%s)", id, relays[id].name.c_str(), relays[id].ip.c_str(),
+                  relayDriverName(relays[id].driver));
+    if (id != PRIMARY_RELAY) {
+      Serial.printf(", auto-off %s (%u ms)", relays[id].autoOff ? "ON" : "OFF", relays[id].offDelayMs);
+    }
+    Serial.println();
+  }
+}
+
+void saveRelayConfig(uint8_t id) {
+  if (id >= MAX_RELAYS) return;
+  const RelayState& r = relays[id];
+  relayConfigVersion++;
+
+  Preferences prefs;
+  prefs.begin("coreone", false);
+  prefs.putString(relayKey(id, "name").c_str(), r.name);
+  prefs.putUChar(relayKey(id, "drv").c_str(), r.driver);
+  if (id == PRIMARY_RELAY) {
+    prefs.putString("relay_ip", r.ip);
+  } else {
+    prefs.putString(relayKey(id, "ip").c_str(), r.ip);
+    prefs.putBool(relayKey(id, "auto").c_str(), r.autoOff);
+    prefs.putUInt(relayKey(id, "delay").c_str(), r.offDelayMs);
+  }
+  prefs.end();
+
+  Serial.printf("Stored relay %u config: %s @ %s\n", id, r.name.c_str(), r.ip.c_str());
+}
@@ -0,0 +1,95 @@
+/**
+ * @file Relays.h
+ * @brief Table of supervised relay devices
+ *
+ * Relay 0 is the printer relay: it drives the LED, power logging and the
+ * auto-off timer display. Further relays (e.g. enclosure heater, fume
+ * extractor) are optional and each have their own report state and
+ * auto-off policy. Every relay is polled by its own relay worker, so polls
+ * run concurrently.
+ */
+
+#pragma once
+#include <Arduino.h>
+
+constexpr uint8_t MAX_RELAYS    = 3;  ///< Printer + two auxiliary relays
+constexpr uint8_t PRIMARY_RELAY = 0;  ///< Printer relay index
+
+/**
+ * @brief Relay HTTP protocol, selects the driver in RelayDrivers.h
+ */
+enum RelayDriverType : uint8_t {
+  RelayDriverMyStrom,     ///< myStrom Switch: /report, /relay?state=N, /toggle
+  RelayDriverShellyGen1,  ///< Shelly Gen1 (Plug S, 1PM): /status, /relay/0?turn=
+  RelayDriverShellyGen2,  ///< Shelly Gen2+ RPC: /rpc/Switch.GetStatus, /rpc/Switch.Set
+  RelayDriverTasmota,     ///< Tasmota: /cm?cmnd=Status 0, /cm?cmnd=Power
+  RELAY_DRIVER_COUNT
+};
+
+/**
+ * @brief Configuration and live state of one relay
+ */
+struct RelayState {
+  // Configuration (stored in NVS)
+  String   name;               ///< Display name
+  String   ip;                 ///< Relay IP address, empty if the slot is unused
+  RelayDriverType driver;      ///< Relay protocol
+  bool     autoOff;            ///< Switch off when the auto-off timer fires (auxiliary relays)
+  uint32_t offDelayMs;         ///< Delay after the printer signal goes low (auxiliary relays)
+
+  // Auto-off run state
+  bool     offArmed;           ///< Auto-off pending in the current timer run
+
+  // Last /report
+  bool     reportValid;        ///< Report data is valid and up-to-date
+  bool     relay;              ///< Relay state (ON/OFF) from report
+  float    power;              ///< Current power consumption in watts
+  float    ws;                 ///< Watt-seconds energy measurement
+  float    temperature;        ///< Device temperature in Celsius
+  String   bootId;             ///< Unique boot ID from relay device
+  double   energyBoot;         ///< Energy consumed since boot [Ws], see RelayReport
+  uint32_t timeBoot;           ///< Time since boot in seconds
+
+  // Polling
+  uint32_t consecutiveErrors;  ///< Count of consecutive failed reports
+  bool     reportPending;      ///< Report request queued, waiting for result
+  uint32_t lastPollMs;         ///< Timestamp of last report request
+  uint32_t pollIntervalMs;     ///< Delay until next poll, chosen by PollScheduler
+};
+
+extern RelayState relays[MAX_RELAYS];  ///< Relay table, index 0 is the printer
+extern uint32_t   relayConfigVersion;  ///< Incremented by every saveRelayConfig()
+
+/**
+ * @brief Check whether a relay slot has an IP address configured
+ */
+inline bool relayConfigured(uint8_t id) {
+  return id < MAX_RELAYS && relays[id].ip.length() > 0;
+}
+
+/**
+ * @brief Settings/API name of a driver ("mystrom", "shelly_gen1", "shelly_gen2", "tasmota")
+ */
+const char* relayDriverName(RelayDriverType driver);
+
+/**
+ * @brief Parse a driver name
+ * @param name Driver name as returned by relayDriverName()
+ * @param out Receives the driver type
+ * @return false if the name is unknown
+ */
+bool relayDriverFromName(const String& name, RelayDriverType& out);
+
+/**
+ * @brief Load relay names, IPs and auto-off policy from NVS
+ * @note Relay 0 keeps the legacy "relay_ip" key and follows the global
+ *       auto mode and "off_delay_ms"; relays 1.. use "r<N>_ip", "r<N>_auto"
+ *       and "r<N>_delay"; all use "r<N>_name" and "r<N>_drv"
+ */
+void loadRelayConfig();
+
+/**
+ * @brief Save configuration of one relay to NVS
+ * @param id Relay index
+ */
+void saveRelayConfig(uint8_t id);
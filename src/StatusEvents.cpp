@@ -0,0 +1,80 @@
+/**
+ * @file StatusEvents.cpp
+ * @brief Implementation of the /api/events push channel
+ */
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "StatusEvents.h"
+#include "StatusSnapshot.h"
+#include "Relays.h"
+#include "WebUi.h"
+#include "PowerLog.h"
+
+// External state from main.cpp
+extern bool loggingEnabled;
+
+static AsyncEventSource events("/api/events");
+
+static volatile bool clientJoined = false;  ///< Set on the AsyncTCP task
+static uint32_t lastCheckMs       = 0;
+static uint32_t lastTickMs        = 0;
+static uint32_t sentVersion       = 0;      ///< Snapshot version last pushed
+static bool     lastLogging       = false;
+static size_t   lastLogCount      = 0;
+static uint32_t lastLogSeq        = 0;
+
+static void broadcastStatus(uint32_t now) {
+  static char response[STATUS_RESPONSE_MAX];
+  statusSnapshotRender(response, sizeof(response), now);
+  events.send(response, "status");
+  sentVersion = statusSnapshotVersion();
+  lastTickMs  = now;
+}
+
+static void broadcastLog() {
+  String json = buildLogStatusJson();
+  events.send(json.c_str(), "log");
+  lastLogging  = loggingEnabled;
+  lastLogCount = powerLogCount;
+  lastLogSeq   = powerLogSeq;
+}
+
+void statusEventsBegin(AsyncWebServer& server) {
+  events.setFilter([](AsyncWebServerRequest* request) {
+    StateLock lock;  // Credentials can change at runtime
+    return events.count() < STATUS_EVENTS_MAX_CLIENTS && isAuthenticated(request);
+  });
+  events.onConnect([](AsyncEventSourceClient* client) {
+    clientJoined = true;
+    Serial.println("Event subscriber attached");
+  });
+  server.addHandler(&events);
+}
+
+void statusEventsLoop(uint32_t now) {
+  if (events.count() == 0) return;
+  if (!clientJoined && now - lastCheckMs < STATUS_EVENTS_CHECK_MS) return;
+  lastCheckMs = now;
+
+  // Countdown running: tick once per second so clients see the time move
+  bool countdown = offTimerRunning;
+  for (const RelayState& r : relays) countdown |= r.offArmed;
+
+  bool joined = clientJoined;
+  clientJoined = false;
+
+  if (statusSnapshotUpdate() || joined || statusSnapshotVersion() != sentVersion ||
+      (countdown && now - lastTickMs >= STATUS_EVENTS_TICK_MS)) {
+    broadcastStatus(now);
+  }
+
+  if (joined || loggingEnabled != lastLogging || powerLogCount != lastLogCount ||
+      powerLogSeq != lastLogSeq) {
+    broadcastLog();
+  }
+}
+
+size_t statusEventsClients() {
+  return events.count();
+}
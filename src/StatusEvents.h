@@ -0,0 +1,42 @@
+/**
+ * @file StatusEvents.h
+ * @brief Server-Sent Events push channel for live status (/api/events)
+ *
+ * Browsers subscribe once with EventSource instead of polling /api/status
+ * and /api/log_status. Events are only written when something changed:
+ * - "status": the cached status document (see StatusSnapshot.h) when it was
+ *   rebuilt, and once per second while an auto-off countdown runs
+ * - "log": log status when logging starts/stops or a new point is recorded
+ *
+ * Subscribers are kept by AsyncEventSource. A new subscriber only raises a
+ * flag on the AsyncTCP task, the next statusEventsLoop() sends the current
+ * state to everyone.
+ */
+
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+constexpr uint8_t  STATUS_EVENTS_MAX_CLIENTS = 4;     ///< Concurrent subscribers
+constexpr uint32_t STATUS_EVENTS_CHECK_MS    = 100;   ///< Change detection interval
+constexpr uint32_t STATUS_EVENTS_TICK_MS     = 1000;  ///< Status push interval while counting down
+
+/**
+ * @brief Register /api/events with the web server
+ * @param server Web server, before server.begin()
+ * @note Requests without valid credentials or beyond STATUS_EVENTS_MAX_CLIENTS
+ *       fall through to the not-found handler (401 / 404)
+ */
+void statusEventsBegin(AsyncWebServer& server);
+
+/**
+ * @brief Push pending events to all subscribers
+ * @param now Current millis()
+ * @note Call from loop() with StateLock held, does nothing without subscribers
+ */
+void statusEventsLoop(uint32_t now);
+
+/**
+ * @brief Number of connected subscribers
+ */
+size_t statusEventsClients();
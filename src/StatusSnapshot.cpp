@@ -0,0 +1,212 @@
+/**
+ * @file StatusSnapshot.cpp
+ * @brief Implementation of the cached status document
+ */
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <stdarg.h>
+#include "StatusSnapshot.h"
+#include "Relays.h"
+#include "RelayCommand.h"
+
+// External state from main.cpp
+extern bool autoPowerOffEnabled;
+extern bool offTimerRunning;
+extern uint32_t offDelayMs;
+extern uint32_t offTimerStart;
+
+/**
+ * @brief Plain copy of every value in the document, compared with memcmp
+ * @note Always memset before filling so padding bytes compare equal
+ */
+struct StatusFields {
+  bool     autoMode;
+  bool     timer;
+  uint32_t offDelayMs;
+  uint32_t localIp;             ///< Stands in for device_ip and wifi_ssid
+  uint32_t relayConfigVersion;  ///< Stands in for relay names, IPs and drivers
+  uint8_t  cmdAttempts;
+  uint32_t offConfirmMs;
+  char     bootId[RELAY_BOOT_ID_MAX_LEN];
+
+  struct {
+    bool        configured;
+    bool        reportValid;
+    bool        relay;
+    bool        autoOff;
+    bool        offArmed;
+    float       power;
+    float       ws;
+    float       temperature;
+    double      energyBoot;
+    uint32_t    timeBoot;
+    const char* offState;       ///< Static string from relayCommandOffStateName()
+  } relay[MAX_RELAYS];
+};
+
+static StatusFields lastFields;
+static bool         haveSnapshot = false;
+static char         snapshot[STATUS_JSON_MAX];
+static size_t       snapshotLen = 0;
+static uint32_t     snapshotVersion = 0;
+
+static void collectFields(StatusFields& f) {
+  memset(&f, 0, sizeof(f));
+  f.autoMode           = autoPowerOffEnabled;
+  f.timer              = offTimerRunning;
+  f.offDelayMs         = offDelayMs;
+  f.localIp            = (uint32_t)WiFi.localIP();
+  f.relayConfigVersion = relayConfigVersion;
+
+  RelayCommandStatus cmd;
+  relayCommandGetStatus(PRIMARY_RELAY, cmd);
+  f.cmdAttempts  = cmd.attempts;
+  f.offConfirmMs = cmd.lastOffConfirmMs;
+  strlcpy(f.bootId, relays[PRIMARY_RELAY].bootId.c_str(), sizeof(f.bootId));
+
+  for (uint8_t id = 0; id < MAX_RELAYS; id++) {
+    const RelayState& r = relays[id];
+    auto& out = f.relay[id];
+    out.configured  = relayConfigured(id);
+    out.reportValid = r.reportValid;
+    out.relay       = r.relay;
+    out.autoOff     = r.autoOff;
+    out.offArmed    = r.offArmed;
+    out.power       = r.power;
+    out.ws          = r.ws;
+    out.temperature = r.temperature;
+    out.energyBoot  = r.energyBoot;
+    out.timeBoot    = r.timeBoot;
+    out.offState    = relayCommandOffStateName(id);
+  }
+}
+
+/**
+ * @brief Bounded append into the snapshot buffer
+ */
+class JsonWriter {
+ public:
+  JsonWriter(char* buf, size_t cap) : buf_(buf), cap_(cap) { buf_[0] = '\0'; }
+
+  void raw(const char* s) {
+    while (*s && len_ + 1 < cap_) buf_[len_++] = *s++;
+    buf_[len_] = '\0';
+  }
+
+  void printf(const char* fmt, ...) {
+    if (len_ + 1 >= cap_) return;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf_ + len_, cap_ - len_, fmt, args);
+    va_end(args);
+    if (n <= 0) return;
+    len_ += (size_t)n;
+    if (len_ >= cap_) len_ = cap_ - 1;  // Truncated
+  }
+
+  /// Quoted JSON string, escaping quotes and backslashes (e.g. in SSIDs)
+  void str(const char* s) {
+    raw("\"");
+    for (; *s && len_ + 2 < cap_; s++) {
+      if (*s == '"' || *s == '\\') buf_[len_++] = '\\';
+      buf_[len_++] = *s;
+    }
+    buf_[len_] = '\0';
+    raw("\"");
+  }
+
+  void boolean(bool b) { raw(b ? "true" : "false"); }
+
+  size_t length() const { return len_; }
+
+ private:
+  char*  buf_;
+  size_t cap_;
+  size_t len_ = 0;
+};
+
+/**
+ * @brief Serialize the document without the per-request tail and closing brace
+ */
+static void buildSnapshot(const StatusFields& f) {
+  const RelayState& printer = relays[PRIMARY_RELAY];
+  JsonWriter w(snapshot, sizeof(snapshot));
+
+  w.raw("{\"auto_mode\":");    w.boolean(f.autoMode);
+  w.raw(",\"timer\":");        w.boolean(f.timer);
+  w.printf(",\"total_ms\":%u,\"timer_minutes\":%u", f.offDelayMs, f.offDelayMs / 60000UL);
+  w.raw(",\"report_valid\":"); w.boolean(f.relay[PRIMARY_RELAY].reportValid);
+  w.raw(",\"relay\":");        w.boolean(f.relay[PRIMARY_RELAY].relay);
+  const auto& p = f.relay[PRIMARY_RELAY];
+  w.printf(",\"power\":%.2f,\"ws\":%.2f,\"temperature\":%.2f,\"energy_boot\":%.2f,\"time_boot\":%u",
+           p.power, p.ws, p.temperature, p.energyBoot, p.timeBoot);
+  w.raw(",\"boot_id\":");      w.str(f.bootId);
+  w.raw(",\"relay_ip\":");     w.str(printer.ip.c_str());
+  w.raw(",\"device_ip\":");    w.str(WiFi.localIP().toString().c_str());
+  w.raw(",\"wifi_ssid\":");    w.str(WiFi.SSID().c_str());
+  w.raw(",\"off_state\":");    w.str(f.relay[PRIMARY_RELAY].offState);
+  w.printf(",\"cmd_attempts\":%u,\"off_confirm_ms\":%u", f.cmdAttempts, f.offConfirmMs);
+
+  // Per-relay table, unused slots are skipped
+  w.raw(",\"relays\":[");
+  bool first = true;
+  for (uint8_t id = 0; id < MAX_RELAYS; id++) {
+    if (!f.relay[id].configured) continue;
+    const RelayState& r = relays[id];
+    const auto& v = f.relay[id];
+    if (!first) w.raw(",");
+    first = false;
+    w.printf("{\"id\":%u,\"name\":", id);   w.str(r.name.c_str());
+    w.raw(",\"ip\":");                       w.str(r.ip.c_str());
+    w.raw(",\"driver\":");                   w.str(relayDriverName(r.driver));
+    w.raw(",\"report_valid\":");             w.boolean(v.reportValid);
+    w.raw(",\"relay\":");                    w.boolean(v.relay);
+    w.printf(",\"power\":%.2f,\"temperature\":%.2f", v.power, v.temperature);
+    w.raw(",\"auto_off\":");                 w.boolean(v.autoOff);
+    w.printf(",\"off_delay_ms\":%u", id == PRIMARY_RELAY ? f.offDelayMs : r.offDelayMs);
+    w.raw(",\"off_armed\":");                w.boolean(v.offArmed);
+    w.raw(",\"off_state\":");                w.str(v.offState);
+    w.raw("}");
+  }
+  w.raw("]");
+
+  snapshotLen = w.length();
+  snapshotVersion++;
+}
+
+bool statusSnapshotUpdate() {
+  StatusFields f;
+  collectFields(f);
+  if (haveSnapshot && memcmp(&f, &lastFields, sizeof(f)) == 0) return false;
+
+  lastFields   = f;
+  haveSnapshot = true;
+  buildSnapshot(f);
+  return true;
+}
+
+size_t statusSnapshotRender(char* out, size_t cap, uint32_t now) {
+  if (cap < snapshotLen + STATUS_JSON_TAIL_MAX) return 0;
+
+  uint32_t remaining = 0;
+  if (offTimerRunning) {
+    uint32_t elapsed = now - offTimerStart;
+    remaining = (elapsed >= offDelayMs) ? 0 : (offDelayMs - elapsed);
+  }
+
+  // Auxiliary relay countdowns are off_delay_ms - off_elapsed_ms
+  uint32_t offElapsed = 0;
+  bool anyArmed = offTimerRunning;
+  for (const RelayState& r : relays) anyArmed |= r.offArmed;
+  if (anyArmed) offElapsed = now - offTimerStart;
+
+  memcpy(out, snapshot, snapshotLen);
+  int n = snprintf(out + snapshotLen, cap - snapshotLen,
+                   ",\"remaining_ms\":%u,\"off_elapsed_ms\":%u}", remaining, offElapsed);
+  return snapshotLen + (n > 0 ? (size_t)n : 0);
+}
+
+uint32_t statusSnapshotVersion() {
+  return snapshotVersion;
+}
@@ -0,0 +1,38 @@
+/**
+ * @file StatusSnapshot.h
+ * @brief Serialize-once /api/status document
+ *
+ * The status JSON is only rebuilt when one of its fields changed since the
+ * last request (detected by comparing a plain copy of the fields), and every
+ * request is served from the cached buffer. Values that change with time
+ * alone (remaining_ms, off_elapsed_ms) are appended per request, so a running
+ * timer does not invalidate the snapshot.
+ */
+
+#pragma once
+#include <Arduino.h>
+
+constexpr size_t STATUS_JSON_MAX      = 2048;  ///< Cached document buffer
+constexpr size_t STATUS_JSON_TAIL_MAX = 64;    ///< Per-request time fields
+constexpr size_t STATUS_RESPONSE_MAX  = STATUS_JSON_MAX + STATUS_JSON_TAIL_MAX;
+
+/**
+ * @brief Rebuild the cached document if any status field changed
+ * @return true if the document was rebuilt
+ * @note Call from the web server task before statusSnapshotRender()
+ */
+bool statusSnapshotUpdate();
+
+/**
+ * @brief Copy the cached document plus the time-dependent fields into a buffer
+ * @param out Destination, at least STATUS_RESPONSE_MAX bytes
+ * @param cap Size of out
+ * @param now Current millis()
+ * @return Length of the JSON in out (not NUL-counted)
+ */
+size_t statusSnapshotRender(char* out, size_t cap, uint32_t now);
+
+/**
+ * @brief Number of rebuilds so far, changes whenever the document changed
+ */
+uint32_t statusSnapshotVersion();
@@ -0,0 +1,251 @@
+/**
+ * @file Tariff.cpp
+ * @brief Implementation of the tariff schedule, band cache and cost meter
+ */
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <time.h>
+#include "Tariff.h"
+
+TariffSchedule tariffSchedule;
+
+static uint8_t    slotBand[TARIFF_SLOTS];  ///< Band of each 15-minute slot, Sunday 00:00 first
+static TariffBand cachedBand  = { false, TARIFF_BAND_HIGH, 0, 0 };
+static time_t     cachedSince = 0;  ///< Time the cached band was computed for
+static bool       cacheValid  = false;
+
+void tariffSetWindow(TariffSchedule& schedule, int startHour, int endHour) {
+  uint8_t start = constrain(startHour, 0, 23) * (TARIFF_SLOTS_PER_DAY / 24);
+  uint8_t end   = constrain(endHour, 0, 23) * (TARIFF_SLOTS_PER_DAY / 24);
+  for (TariffDay& day : schedule.days) {
+    if (start == end) {
+      // Window start == end: low tariff all day (as the hourly check of older firmware)
+      day.count = 1;
+      day.periods[0] = { 0, TARIFF_BAND_LOW };
+    } else if (start < end) {
+      // Normal case: e.g., 1:00 to 6:00
+      day.count = 2;
+      day.periods[0] = { start, TARIFF_BAND_LOW };
+      day.periods[1] = { end, TARIFF_BAND_HIGH };
+    } else {
+      // Overnight case: e.g., 22:00 to 6:00, the low band carries over midnight
+      day.count = 2;
+      day.periods[0] = { end, TARIFF_BAND_HIGH };
+      day.periods[1] = { start, TARIFF_BAND_LOW };
+    }
+  }
+}
+
+/**
+ * @brief Parse one day of "HH:MM=band" changes up to ';' or the end of the text
+ */
+static bool parseDay(const char*& p, TariffDay& day, uint8_t bandCount) {
+  day.count = 0;
+  while (*p == ' ') p++;
+  if (*p == ';' || *p == '\0') return true;  // No change on this day
+
+  while (true) {
+    char* end;
+    long hour = strtol(p, &end, 10);
+    if (end == p || *end != ':') return false;
+    p = end + 1;
+    long minute = strtol(p, &end, 10);
+    if (end == p || *end != '=') return false;
+    p = end + 1;
+    long band = strtol(p, &end, 10);
+    if (end == p) return false;
+    p = end;
+
+    if (hour < 0 || hour > 23 || minute < 0 || minute > 59 || minute % TARIFF_SLOT_MIN != 0 ||
+        band < 0 || band >= bandCount || day.count == TARIFF_MAX_PERIODS) {
+      return false;
+    }
+    uint8_t slot = (hour * 60 + minute) / TARIFF_SLOT_MIN;
+    if (day.count > 0 && slot <= day.periods[day.count - 1].slot) return false;  // Not ascending
+    day.periods[day.count++] = { slot, (uint8_t)band };
+
+    while (*p == ' ') p++;
+    if (*p != ',') break;
+    p++;
+    while (*p == ' ') p++;
+  }
+  return *p == ';' || *p == '\0';
+}
+
+bool tariffParseDays(const String& text, TariffSchedule& schedule) {
+  TariffDay parsed[7];
+  size_t count = 0;
+  const char* p = text.c_str();
+  while (true) {
+    if (count == 7 || !parseDay(p, parsed[count], schedule.bandCount)) return false;
+    count++;
+    if (*p == '\0') break;
+    p++;  // ';'
+  }
+  if (count != 1 && count != 2 && count != 7) return false;
+
+  // Text is Monday first, days[] follows tm_wday (Sunday = 0)
+  for (uint8_t i = 0; i < 7; i++) {
+    uint8_t source = count == 7 ? i : count == 2 ? (i >= 5 ? 1 : 0) : 0;
+    schedule.days[(i + 1) % 7] = parsed[source];
+  }
+  return true;
+}
+
+String tariffFormatDays(const TariffSchedule& schedule) {
+  String text;
+  for (uint8_t i = 0; i < 7; i++) {
+    const TariffDay& day = schedule.days[(i + 1) % 7];
+    if (i > 0) text += ';';
+    for (uint8_t n = 0; n < day.count; n++) {
+      char period[12];
+      uint16_t minutes = day.periods[n].slot * TARIFF_SLOT_MIN;
+      snprintf(period, sizeof(period), "%s%02u:%02u=%u", n > 0 ? "," : "",
+               minutes / 60, minutes % 60, day.periods[n].band);
+      text += period;
+    }
+  }
+  return text;
+}
+
+/**
+ * @brief Check a schedule read from NVS before it is compiled
+ */
+static bool scheduleValid(const TariffSchedule& schedule) {
+  if (schedule.version != TARIFF_SCHEDULE_VERSION || schedule.bandCount < 2 ||
+      schedule.bandCount > TARIFF_MAX_BANDS) {
+    return false;
+  }
+  for (const TariffDay& day : schedule.days) {
+    if (day.count > TARIFF_MAX_PERIODS) return false;
+    for (uint8_t n = 0; n < day.count; n++) {
+      if (day.periods[n].slot >= TARIFF_SLOTS_PER_DAY || day.periods[n].band >= schedule.bandCount) return false;
+    }
+  }
+  return true;
+}
+
+void tariffLoad(float high, float low, int startHour, int endHour) {
+  Preferences prefs;
+  prefs.begin("coreone", true); // Read-only
+  size_t len = prefs.getBytes("tariff_sched", &tariffSchedule, sizeof(tariffSchedule));
+  prefs.end();
+
+  if (len != sizeof(tariffSchedule) || !scheduleValid(tariffSchedule)) {
+    // No schedule saved yet: the two-band daily window of older firmware
+    memset(&tariffSchedule, 0, sizeof(tariffSchedule));
+    tariffSchedule.version   = TARIFF_SCHEDULE_VERSION;
+    tariffSchedule.bandCount = 2;
+    tariffSchedule.prices[TARIFF_BAND_HIGH] = high;
+    tariffSchedule.prices[TARIFF_BAND_LOW]  = low;
+    tariffSetWindow(tariffSchedule, startHour, endHour);
+  }
+  tariffCompile();
+
+  Serial.printf("Tariff schedule: %u bands, %s\n", tariffSchedule.bandCount,
+                tariffFormatDays(tariffSchedule).c_str());
+}
+
+void tariffSave() {
+  tariffSchedule.version = TARIFF_SCHEDULE_VERSION;
+  Preferences prefs;
+  prefs.begin("coreone", false);
+  prefs.putBytes("tariff_sched", &tariffSchedule, sizeof(tariffSchedule));
+  prefs.end();
+  tariffCompile();
+}
+
+void tariffCompile() {
+  // A band runs until the next change, possibly days later: walk the week
+  // twice so the first days start with the band carried over from the end
+  uint8_t band = TARIFF_BAND_HIGH;
+  for (uint8_t pass = 0; pass < 2; pass++) {
+    for (uint8_t d = 0; d < 7; d++) {
+      const TariffDay& day = tariffSchedule.days[d];
+      uint8_t next = 0;
+      for (uint8_t s = 0; s < TARIFF_SLOTS_PER_DAY; s++) {
+        while (next < day.count && day.periods[next].slot <= s) band = day.periods[next++].band;
+        slotBand[d * TARIFF_SLOTS_PER_DAY + s] = band < tariffSchedule.bandCount ? band : TARIFF_BAND_HIGH;
+      }
+    }
+  }
+  cacheValid = false;  // Band boundaries follow the new schedule from now on
+}
+
+static TariffBand computeBand(time_t now) {
+  TariffBand band = { false, TARIFF_BAND_HIGH, tariffSchedule.prices[TARIFF_BAND_HIGH],
+                      now + (time_t)TARIFF_UNSYNCED_RETRY_S };
+  if (now < TARIFF_CLOCK_VALID) return band;  // Default to high tariff if time unavailable
+
+  struct tm local;
+  localtime_r(&now, &local);
+  uint16_t slot = local.tm_wday * TARIFF_SLOTS_PER_DAY +
+                  (local.tm_hour * 60 + local.tm_min) / TARIFF_SLOT_MIN;
+  band.index = slotBand[slot];
+  band.low   = band.index != TARIFF_BAND_HIGH;
+  band.price = tariffSchedule.prices[band.index];
+
+  // Start of the first slot with another band, mktime() carries into the next days
+  band.until = now + 7 * 24 * 3600;  // One band all week
+  for (uint16_t k = 1; k < TARIFF_SLOTS; k++) {
+    if (slotBand[(slot + k) % TARIFF_SLOTS] == band.index) continue;
+    uint16_t daySlot = slot % TARIFF_SLOTS_PER_DAY + k;
+    struct tm next = local;
+    next.tm_mday += daySlot / TARIFF_SLOTS_PER_DAY;
+    next.tm_hour  = (daySlot % TARIFF_SLOTS_PER_DAY) * TARIFF_SLOT_MIN / 60;
+    next.tm_min   = (daySlot % TARIFF_SLOTS_PER_DAY) * TARIFF_SLOT_MIN % 60;
+    next.tm_sec   = 0;
+    next.tm_isdst = -1;
+    band.until = mktime(&next);
+    if (band.until <= now) band.until += 3600;  // Repeated hour at the end of DST resolved to its first pass
+    break;
+  }
+  return band;
+}
+
+TariffBand tariffBandAt(time_t now) {
+  if (!cacheValid || now < cachedSince || now >= cachedBand.until) {
+    cachedBand  = computeBand(now);
+    cachedSince = now;
+    cacheValid  = true;
+  }
+  return cachedBand;
+}
+
+void TariffCostMeter::reset(float energyWh, time_t now) {
+  energyWh_ = energyWh;
+  cost_     = 0;
+  time_     = now;
+  low_      = tariffBandAt(now).low;
+}
+
+float TariffCostMeter::add(float energyWh, time_t now) {
+  double delta = energyWh - energyWh_;
+  time_t from = time_;
+  energyWh_ = energyWh;
+  time_     = now;
+
+  TariffBand band = tariffBandAt(from);
+  if (delta > 0) {
+    if (from < TARIFF_CLOCK_VALID || now <= from) {
+      // No usable interval (clock just set or stepped back), charge at the current band
+      band = tariffBandAt(now);
+    } else {
+      // Split the delta at each band change within the interval
+      double span = (double)(now - from);
+      while (band.until < now) {
+        double part = delta * (double)(band.until - from) / span;
+        cost_ += part / 1000.0 * band.price;
+        delta -= part;
+        span  -= (double)(band.until - from);
+        from   = band.until;
+        band   = tariffBandAt(from);
+      }
+    }
+    cost_ += delta / 1000.0 * band.price;
+  }
+
+  low_ = tariffBandAt(now).low;
+  return (float)cost_;
+}
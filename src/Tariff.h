@@ -0,0 +1,167 @@
+/**
+ * @file Tariff.h
+ * @brief Weekly tariff schedule, band lookup and cost integration of the power log
+ *
+ * The tariff is a weekly schedule of up to TARIFF_MAX_BANDS priced bands.
+ * Each weekday lists up to TARIFF_MAX_PERIODS band changes at 15-minute
+ * resolution; a band runs until the next change, across midnight into the
+ * following days if they have no change before it. tariffCompile() expands
+ * the schedule into a lookup table of one band per 15-minute slot of the
+ * week (672 bytes), so the band of a local time is a single table index.
+ *
+ * The band is still not looked up per sample. tariffBandAt() computes the
+ * band in force and the Unix time it ends once, later calls before that
+ * boundary return the cached band without any time conversion.
+ *
+ * Band 0 is the high tariff and band 1 the low tariff. The daily low tariff
+ * window of older firmware (tariffSwitchHour to tariffSwitchEndHour) is
+ * kept as a shorthand: setting it replaces the schedule with that window on
+ * every day. Samples in any band other than 0 are logged as low tariff.
+ *
+ * TariffCostMeter integrates the cost of a logging session: each energy
+ * delta between two samples is charged at the price of the band it was used
+ * in, split in proportion to time where the samples straddle a boundary.
+ * The logged cost therefore stays exact across a tariff switch instead of
+ * pricing the cumulative energy at the band of the latest sample.
+ *
+ * Until the clock is set by NTP the high tariff applies and the band is
+ * checked again after TARIFF_UNSYNCED_RETRY_S.
+ */
+
+#pragma once
+#include <Arduino.h>
+#include <time.h>
+
+constexpr time_t   TARIFF_CLOCK_VALID      = 1600000000;  ///< Earlier Unix times mean the clock is not set
+constexpr uint32_t TARIFF_UNSYNCED_RETRY_S = 60;
+constexpr uint8_t  TARIFF_MAX_BANDS        = 4;           ///< Priced bands of a schedule
+constexpr uint8_t  TARIFF_MAX_PERIODS      = 8;           ///< Band changes per weekday
+constexpr uint8_t  TARIFF_SLOT_MIN         = 15;          ///< Schedule resolution in minutes
+constexpr uint8_t  TARIFF_SLOTS_PER_DAY    = 24 * 60 / TARIFF_SLOT_MIN;
+constexpr uint16_t TARIFF_SLOTS            = 7 * TARIFF_SLOTS_PER_DAY;  ///< Lookup table size (672)
+constexpr uint8_t  TARIFF_BAND_HIGH        = 0;
+constexpr uint8_t  TARIFF_BAND_LOW         = 1;
+constexpr uint8_t  TARIFF_SCHEDULE_VERSION = 1;           ///< TariffSchedule layout stored in NVS
+
+/**
+ * @brief Start of a band on one weekday
+ */
+struct TariffPeriod {
+  uint8_t slot;  ///< 15-minute slot of the day (0-95)
+  uint8_t band;  ///< Band index, < TariffSchedule::bandCount
+};
+
+/**
+ * @brief Band changes of one weekday, ascending slots
+ */
+struct TariffDay {
+  uint8_t      count;
+  TariffPeriod periods[TARIFF_MAX_PERIODS];
+};
+
+/**
+ * @brief Weekly tariff schedule (stored in NVS as one blob of ~140 bytes)
+ */
+struct TariffSchedule {
+  uint8_t   version;    ///< TARIFF_SCHEDULE_VERSION
+  uint8_t   bandCount;  ///< Bands in use (2 to TARIFF_MAX_BANDS)
+  float     prices[TARIFF_MAX_BANDS];  ///< Price per kWh of each band
+  TariffDay days[7];    ///< Indexed by tm_wday, 0 = Sunday
+};
+
+extern TariffSchedule tariffSchedule;  ///< Active schedule, see tariffCompile()
+
+/**
+ * @brief Tariff band in force at a point in time
+ */
+struct TariffBand {
+  bool    low;    ///< Any band other than TARIFF_BAND_HIGH
+  uint8_t index;  ///< Band index
+  float   price;  ///< Price per kWh
+  time_t  until;  ///< Unix time of the next band change
+};
+
+/**
+ * @brief Replace the periods of every day with a daily low tariff window
+ * @param startHour Hour the low tariff starts (0-23)
+ * @param endHour Hour it ends, may be before startHour (over midnight); equal means all day
+ * @note Prices are not changed
+ */
+void tariffSetWindow(TariffSchedule& schedule, int startHour, int endHour);
+
+/**
+ * @brief Parse the periods of a schedule from text
+ *
+ * Days are separated by ';', Monday first: 7 days, or 2 (Monday to Friday;
+ * Saturday and Sunday), or 1 for every day. A day is a comma separated list
+ * of "HH:MM=band" changes in ascending order, minutes a multiple of 15,
+ * e.g. "07:00=0,20:00=2;08:00=2,22:00=1". A day may be empty.
+ *
+ * @param text Periods text
+ * @param schedule Receives the periods, prices and band count are kept
+ * @return false if the text is malformed or names a band >= bandCount
+ */
+bool tariffParseDays(const String& text, TariffSchedule& schedule);
+
+/**
+ * @brief Periods of a schedule as text, 7 days in tariffParseDays() format
+ */
+String tariffFormatDays(const TariffSchedule& schedule);
+
+/**
+ * @brief Load tariffSchedule from NVS and compile it
+ * @param high Price of band 0 if no schedule is stored yet
+ * @param low Price of band 1 if no schedule is stored yet
+ * @param startHour Low tariff window used if no schedule is stored yet
+ * @param endHour Low tariff window used if no schedule is stored yet
+ */
+void tariffLoad(float high, float low, int startHour, int endHour);
+
+/**
+ * @brief Save tariffSchedule to NVS and compile it
+ */
+void tariffSave();
+
+/**
+ * @brief Expand tariffSchedule into the slot lookup table and drop the cached band
+ * @note Call after changing tariffSchedule
+ */
+void tariffCompile();
+
+/**
+ * @brief Band in force at the given time
+ * @note O(1) until the cached band ends or the schedule changes
+ */
+TariffBand tariffBandAt(time_t now);
+
+/**
+ * @brief Cost accumulator of one logging session
+ */
+class TariffCostMeter {
+ public:
+  /**
+   * @brief Start a session
+   * @param energyWh Energy counter at the start
+   * @param now Unix time
+   */
+  void reset(float energyWh, time_t now);
+
+  /**
+   * @brief Charge the energy used since the previous sample
+   * @param energyWh Energy counter now
+   * @param now Unix time
+   * @return Cost since reset()
+   */
+  float add(float energyWh, time_t now);
+
+  /**
+   * @brief Band of the latest sample
+   */
+  bool lowTariff() const { return low_; }
+
+ private:
+  float  energyWh_ = 0;
+  double cost_ = 0;      ///< Double, small deltas are added to a growing sum
+  time_t time_ = 0;      ///< Time of the previous sample
+  bool   low_ = false;
+};
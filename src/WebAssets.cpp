@@ -0,0 +1,133 @@
+/**
+ * @file WebAssets.cpp
+ * @brief Implementation of gzip/ETag serving for the web UI files
+ */
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SPIFFS.h>
+#include "WebAssets.h"
+
+#ifdef EMBED_WEB_ASSETS
+#include "WebAssetsEmbedded.h"  // Generated into the build directory
+#endif
+
+/**
+ * @brief Manifest entry
+ */
+struct WebAsset {
+  char path[WEB_ASSET_PATH_MAX];  ///< Served path without .gz
+  char etag[WEB_ASSET_HASH_MAX];  ///< Quoted content hash
+  bool immutable;                 ///< Fingerprinted name, content never changes
+};
+
+static WebAsset assets[WEB_ASSETS_MAX];
+static uint8_t  assetCount = 0;
+
+uint32_t webAssetPathHash(const char* path) {
+  uint32_t hash = 0x811C9DC5;
+  while (*path) {
+    hash = (hash ^ (uint8_t)*path++) * 0x01000193;
+  }
+  return hash;
+}
+
+/**
+ * @brief Answer with 304 if the client already has this ETag
+ * @return true if the response was sent
+ */
+static bool sendNotModified(AsyncWebServerRequest* request, const char* etag, const char* cacheControl) {
+  if (!request->hasHeader("If-None-Match") || request->header("If-None-Match") != etag) {
+    return false;
+  }
+  AsyncWebServerResponse* response = request->beginResponse(304);
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", cacheControl);
+  request->send(response);
+  return true;
+}
+
+static const char* cacheControlFor(bool immutable) {
+  return immutable ? "public, max-age=31536000, immutable" : "no-cache";
+}
+
+uint8_t webAssetsBegin() {
+  assetCount = 0;
+#ifdef EMBED_WEB_ASSETS
+  size_t embeddedBytes = 0;
+  for (const EmbeddedWebAsset& a : EMBEDDED_WEB_ASSETS) embeddedBytes += a.length;
+  Serial.printf("Web assets: %u embedded files (%u bytes), SPIFFS not used\n",
+                (unsigned)(sizeof(EMBEDDED_WEB_ASSETS) / sizeof(EMBEDDED_WEB_ASSETS[0])),
+                (unsigned)embeddedBytes);
+  return sizeof(EMBEDDED_WEB_ASSETS) / sizeof(EMBEDDED_WEB_ASSETS[0]);
+#else
+  File manifest = SPIFFS.open("/assets.txt", FILE_READ);
+  if (!manifest) {
+    Serial.println("No asset manifest, serving data/ files uncompressed");
+    return 0;
+  }
+
+  while (manifest.available() && assetCount < WEB_ASSETS_MAX) {
+    String line = manifest.readStringUntil('\n');
+    line.trim();
+    int sep = line.indexOf(' ');
+    if (sep <= 0) continue;
+    String path = line.substring(0, sep);
+    String hash = line.substring(sep + 1);
+    if (path.length() + 3 >= WEB_ASSET_PATH_MAX || hash.length() + 2 >= WEB_ASSET_HASH_MAX) continue;
+
+    WebAsset& a = assets[assetCount++];
+    strlcpy(a.path, path.c_str(), sizeof(a.path));
+    snprintf(a.etag, sizeof(a.etag), "\"%s\"", hash.c_str());
+    a.immutable = path.indexOf(hash) >= 0;
+  }
+  manifest.close();
+
+  Serial.printf("Web assets: %u gzipped files\n", assetCount);
+  return assetCount;
+#endif
+}
+
+bool webAssetsServe(AsyncWebServerRequest* request, const String& path, const String& contentType) {
+  const WebAsset* asset = nullptr;
+  for (uint8_t i = 0; i < assetCount; i++) {
+    if (path == assets[i].path) {
+      asset = &assets[i];
+      break;
+    }
+  }
+  if (!asset) return false;
+
+  const char* cacheControl = cacheControlFor(asset->immutable);
+  if (sendNotModified(request, asset->etag, cacheControl)) return true;
+
+  AsyncWebServerResponse* response =
+      request->beginResponse(SPIFFS, path + ".gz", contentType);
+  response->addHeader("Content-Encoding", "gzip");
+  response->addHeader("ETag", asset->etag);
+  response->addHeader("Cache-Control", cacheControl);
+  request->send(response);
+  return true;
+}
+
+#ifdef EMBED_WEB_ASSETS
+bool webAssetsServeEmbedded(AsyncWebServerRequest* request, const String& path) {
+  uint32_t hash = webAssetPathHash(path.c_str());
+  for (const EmbeddedWebAsset& asset : EMBEDDED_WEB_ASSETS) {
+    if (asset.pathHash != hash || path != asset.path) continue;
+
+    const char* cacheControl = cacheControlFor(asset.immutable);
+    if (sendNotModified(request, asset.etag, cacheControl)) return true;
+
+    // Read from flash while sending, the array is not copied into RAM
+    AsyncWebServerResponse* response =
+        request->beginResponse(200, asset.contentType, asset.data, asset.length);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("ETag", asset.etag);
+    response->addHeader("Cache-Control", cacheControl);
+    request->send(response);
+    return true;
+  }
+  return false;
+}
+#endif
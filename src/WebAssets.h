@@ -0,0 +1,69 @@
+/**
+ * @file WebAssets.h
+ * @brief Serving of the pre-built (minified, gzipped, fingerprinted) web UI files
+ *
+ * tools/build_assets.py writes every file of data/ as <name>.gz plus an
+ * assets.txt manifest ("<path> <hash>" per line) into the SPIFFS image.
+ * Assets listed there are sent gzip-encoded with an ETag and answered with
+ * 304 when the browser already has them. Fingerprinted files (app.<hash>.js,
+ * style.<hash>.css) change name with their content and are cached for a
+ * year, index.html is revalidated on every load.
+ *
+ * Built with -DEMBED_WEB_ASSETS the same gzipped files are compiled into the
+ * firmware (WebAssetsEmbedded.h, generated by build_assets.py) and served
+ * straight from flash: no SPIFFS lookup, no MIME type guessing, and the UI
+ * keeps working with an empty or corrupted filesystem.
+ */
+
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+constexpr uint8_t WEB_ASSETS_MAX      = 16;  ///< Manifest entries kept in RAM
+constexpr uint8_t WEB_ASSET_PATH_MAX  = 32;  ///< SPIFFS object name length
+constexpr uint8_t WEB_ASSET_HASH_MAX  = 12;  ///< Content hash (8 hex chars)
+
+/**
+ * @brief Asset compiled into the firmware (-DEMBED_WEB_ASSETS)
+ */
+struct EmbeddedWebAsset {
+  uint32_t       pathHash;     ///< webAssetPathHash() of path
+  const char*    path;         ///< Served path, e.g. "/index.html"
+  const char*    etag;         ///< Quoted content hash
+  const char*    contentType;  ///< MIME type of the uncompressed file
+  bool           immutable;    ///< Fingerprinted name, content never changes
+  const uint8_t* data;         ///< Gzipped content in flash
+  size_t         length;       ///< Bytes of data
+};
+
+/**
+ * @brief 32-bit FNV-1a hash of a served path (same as build_assets.py)
+ */
+uint32_t webAssetPathHash(const char* path);
+
+/**
+ * @brief Load the asset manifest from SPIFFS
+ * @return Number of assets, 0 if the image was not built by build_assets.py
+ * @note With EMBED_WEB_ASSETS only reports the compiled-in table
+ */
+uint8_t webAssetsBegin();
+
+/**
+ * @brief Serve a manifest asset, or 304 if the client's copy is current
+ * @param request Current (authenticated) request
+ * @param path Requested path, e.g. "/index.html"
+ * @param contentType MIME type of the uncompressed file
+ * @return false if path is not in the manifest
+ */
+bool webAssetsServe(AsyncWebServerRequest* request, const String& path, const String& contentType);
+
+#ifdef EMBED_WEB_ASSETS
+/**
+ * @brief Serve a compiled-in asset, or 304 if the client's copy is current
+ * @param request Current (authenticated) request
+ * @param path Requested path, e.g. "/index.html"
+ * @return false if path is not embedded
+ * @note Sent from flash without a copy, does not access SPIFFS
+ */
+bool webAssetsServeEmbedded(AsyncWebServerRequest* request, const String& path);
+#endif
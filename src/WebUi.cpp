@@ -3,55 +3,44 @@
  * @brief Web interface implementation serving files from LittleFS filesystem
  * 
  * Provides a responsive web UI with "glass morphism" dark theme styled
- * in Prusa orange (#F96831). Features live AJAX updates every 500ms for
- * status monitoring without page reloads.
+ * in Prusa orange (#F96831). Features live status updates pushed over
+ * /api/events without page reloads.
+ *
+ * Handlers run on the AsyncTCP task: each API handler holds StateLock while
+ * it reads or changes the shared state, responses (including file streams)
+ * are sent after the handler returned and the lock was released.
  */
 
 #include <Arduino.h>
+#include <cmath>
+#include <memory>
 #include <WiFi.h>
 #include <M5Atom.h>
 #include <FS.h>
 #include <SPIFFS.h>
-#include <WiFiManager.h>
 #include "WebUi.h"
 #include "LedDisplay.h"
-
-// External WiFiManager from main.cpp
-extern WiFiManager wifiManager;
+#include "RelayClient.h"
+#include "PollScheduler.h"
+#include "RelayCommand.h"
+#include "StatusSnapshot.h"
+#include "StatusEvents.h"
+#include "WebAssets.h"
+#include "PowerLog.h"
+#include "LogIndex.h"
+#include "LogFile.h"
+#include "LogWal.h"
+#include "Tariff.h"
 
 // External state from main.cpp
 extern bool autoPowerOffEnabled;
 extern bool offTimerRunning;
-extern bool reportValid;
-extern bool reportRelay;
-extern float reportPower;
-extern float reportWs;
-extern float reportTemperature;
-extern String reportBootId;
-extern float reportEnergyBoot;
-extern uint32_t reportTimeBoot;
-extern String relayIpAddress;
-extern uint32_t consecutiveErrors;
-extern uint32_t lastReportPollMs;
-
-// Power logging constants and externals
-#define MAX_LOG_ENTRIES 500  // Must match main.cpp definition
-
-struct PowerLogEntry {
-  uint32_t timestamp;
-  float power;
-  float energy;
-  float cost;
-};
-extern PowerLogEntry powerLog[];
-extern size_t powerLogCount;
-extern size_t powerLogIndex;
+
+// Power logging externals
 extern bool loggingEnabled;
 extern uint32_t loggingStartMs;
 
-// Tariff settings externals
-extern float tariffHigh;
-extern float tariffLow;
+// Tariff settings externals (prices and bands in tariffSchedule)
 extern String currency;
 extern int tariffSwitchHour;
 extern int tariffSwitchEndHour;
@@ -71,10 +60,11 @@ String authUsername = "admin";
 String authPassword = "prusa";
 
 // External control functions from main.cpp
-void sendOff();
-void sendOn();
-void sendToggle();
-void updateReportStatus();
+void sendOff(uint8_t relayId = PRIMARY_RELAY);
+void sendOn(uint8_t relayId = PRIMARY_RELAY);
+void sendToggle(uint8_t relayId = PRIMARY_RELAY);
+void cancelOffTimer();
+void updateReportStatus(uint8_t relayId);
 void startLogging();
 void stopLogging();
 void clearLog();
@@ -82,18 +72,225 @@ void saveTariffSettings();
 String saveLogToFile();
 bool deleteLogFile(const String& filename);
 
+String buildLogStatusJson() {
+    String json = "{";
+    json += "\"enabled\":" + String(loggingEnabled ? "true" : "false") + ",";
+    PowerLogRange range = powerLogRange();
+    json += "\"count\":" + String(range.total()) + ",";
+    json += "\"samples\":" + String(range.count) + ",";
+    json += "\"max\":" + String(POWER_LOG_MAX_ENTRIES) + ",";
+    json += "\"span_ms\":" + String(powerLogSpanMs()) + ",";
+    json += "\"duration_ms\":" + String(loggingEnabled ? (millis() - loggingStartMs) : 0) + ",";
+    json += "\"wal_dropped\":" + String(logWalDropped());
+    json += "}";
+    return json;
+}
+
+/**
+ * @brief Tariff settings JSON (/api/tariff_get, batch part "tariff")
+ */
+static String buildTariffJson() {
+    String json = "{";
+    json += "\"high\":" + String(tariffSchedule.prices[TARIFF_BAND_HIGH], 4) + ",";
+    json += "\"low\":" + String(tariffSchedule.prices[TARIFF_BAND_LOW], 4) + ",";
+    json += "\"prices\":[";
+    for (uint8_t i = 0; i < tariffSchedule.bandCount; i++) {
+        if (i > 0) json += ",";
+        json += String(tariffSchedule.prices[i], 4);
+    }
+    json += "],";
+    json += "\"currency\":\"" + currency + "\",";
+    json += "\"start_hour\":" + String(tariffSwitchHour) + ",";
+    json += "\"end_hour\":" + String(tariffSwitchEndHour) + ",";
+    json += "\"schedule\":\"" + tariffFormatDays(tariffSchedule) + "\"";
+    json += "}";
+    return json;
+}
+
+/**
+ * @brief Auto-logging settings JSON (/api/autolog_get, batch part "autolog")
+ */
+static String buildAutologJson() {
+    String json = "{";
+    json += "\"enabled\":" + String(autoLogEnabled ? "true" : "false") + ",";
+    json += "\"threshold\":" + String(autoLogThreshold, 1) + ",";
+    json += "\"debounce\":" + String(autoLogDebounce);
+    json += "}";
+    return json;
+}
+
+/**
+ * @brief Log interval JSON (/api/loginterval_get, batch part "loginterval")
+ */
+static String buildLogIntervalJson() {
+    String json = "{";
+    json += "\"interval\":" + String(logIntervalSeconds) + ",";
+    json += "\"maxEntries\":" + String(MAX_LOG_ENTRIES) + ",";
+    json += "\"maxMinutes\":" + String(powerLogSampleMinutes(logIntervalSeconds)) + ",";
+    json += "\"rollupMinutes\":" + String(POWER_LOG_ROLLUP_MINUTES);
+    json += "}";
+    return json;
+}
+
+/**
+ * @brief Parse one band price, a positive decimal number
+ * @return false for empty, trailing text, non-finite, zero or negative values
+ */
+static bool parsePrice(const String& text, float& out) {
+    const char* start = text.c_str();
+    char* end;
+    out = strtof(start, &end);
+    while (*end == ' ') end++;
+    return end != start && *end == '\0' && std::isfinite(out) && out > 0;
+}
+
+/**
+ * @brief SPIFFS usage JSON (/api/files/status)
+ */
+static String buildFilesStatusJson() {
+    size_t totalBytes = SPIFFS.totalBytes();
+    size_t usedBytes = SPIFFS.usedBytes();
+    size_t freeBytes = totalBytes - usedBytes;
+    float usedPercent = (float)usedBytes / totalBytes * 100.0f;
+
+    String json = "{";
+    json += "\"total\":" + String(totalBytes) + ",";
+    json += "\"used\":" + String(usedBytes) + ",";
+    json += "\"free\":" + String(freeBytes) + ",";
+    json += "\"usedPercent\":" + String(usedPercent, 1);
+    json += "}";
+    return json;
+}
+
+/**
+ * @brief Send a settings document with configGeneration as ETag
+ * @param build Only called when the client's copy is outdated
+ * @note Answers If-None-Match with 304 and no body
+ */
+static void sendConfigJson(AsyncWebServerRequest* request, String (*build)()) {
+    char etag[16];
+    snprintf(etag, sizeof(etag), "\"c%08x\"", (unsigned)configGeneration);
+
+    AsyncWebServerResponse* response;
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == etag) {
+        response = request->beginResponse(304);
+    } else {
+        response = request->beginResponse(200, "application/json", build());
+    }
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", "no-cache");  // Revalidate every time
+    request->send(response);
+}
+
+/**
+ * @brief Current /api/status document (batch part "status")
+ */
+static String buildStatusJson() {
+    // Rebuilt only when a field changed, otherwise served from the cached copy
+    static char response[STATUS_RESPONSE_MAX];
+    statusSnapshotUpdate();
+    size_t len = statusSnapshotRender(response, sizeof(response), millis());
+    return String(response, len);
+}
+
+static char statusBody[STATUS_RESPONSE_MAX];  ///< Rendered /api/status, sent by StatusResponse
+static uint8_t statusReaders = 0;             ///< StatusResponses still sending statusBody
+
+/**
+ * @brief /api/status response sent straight from statusBody
+ *
+ * The body is copied into the TCP send buffer as it goes out, without a
+ * String copy on the heap. statusBody is not rendered again while a
+ * response still sends it, see sendStatus().
+ * @note Constructed and destroyed on the AsyncTCP task only
+ */
+class StatusResponse : public AsyncAbstractResponse {
+public:
+    explicit StatusResponse(size_t len) : len_(len), pos_(0) {
+        setCode(200);
+        setContentType("application/json");
+        setContentLength(len);
+        statusReaders++;
+    }
+    ~StatusResponse() override { statusReaders--; }
+
+    bool _sourceValid() const override { return true; }
+
+    size_t _fillBuffer(uint8_t* buf, size_t maxLen) override {
+        size_t n = len_ - pos_;
+        if (n > maxLen) n = maxLen;
+        memcpy(buf, statusBody + pos_, n);
+        pos_ += n;
+        return n;
+    }
+
+private:
+    size_t len_;
+    size_t pos_;
+};
+
+/**
+ * @brief Answer /api/status from the snapshot
+ */
+static void sendStatus(AsyncWebServerRequest* request) {
+    if (statusReaders > 0) {
+        // A slow client still reads statusBody, this one gets a copy
+        request->send(200, "application/json", buildStatusJson());
+        return;
+    }
+    statusSnapshotUpdate();
+    size_t len = statusSnapshotRender(statusBody, sizeof(statusBody), millis());
+    request->send(new StatusResponse(len));
+}
+
+/**
+ * @brief Request counter of one registered route
+ */
+struct RouteStat {
+    const char* uri;    ///< Route path (string literal)
+    uint32_t    count;  ///< Requests since boot, including rejected ones
+};
+
+static RouteStat routeStats[HTTP_ROUTE_STATS_MAX];
+static uint8_t   routeStatCount = 0;
+static uint32_t  staticRequests = 0;  ///< Files and unknown paths
+
+bool isAuthenticated(AsyncWebServerRequest* request) {
+    return request->authenticate(authUsername.c_str(), authPassword.c_str());
+}
+
 /**
  * @brief Check HTTP Basic Authentication
+ * @param request Current request, answered with an auth challenge on failure
  * @return true if authenticated, false otherwise
  */
-bool checkAuth() {
-    if (!server.authenticate(authUsername.c_str(), authPassword.c_str())) {
-        server.requestAuthentication();
+bool checkAuth(AsyncWebServerRequest* request) {
+    if (!isAuthenticated(request)) {
+        request->requestAuthentication();
         return false;
     }
     return true;
 }
 
+/**
+ * @brief Register a GET handler that runs with the control state locked
+ * @param uri Request path
+ * @param handler Handler, responsible for checkAuth(request)
+ */
+static void apiGet(const char* uri, ArRequestHandlerFunction handler) {
+    RouteStat* stat = nullptr;
+    if (routeStatCount < HTTP_ROUTE_STATS_MAX) {
+        stat = &routeStats[routeStatCount++];
+        stat->uri = uri;
+        stat->count = 0;
+    }
+    server.on(uri, HTTP_GET, [handler, stat](AsyncWebServerRequest* request) {
+        StateLock lock;
+        if (stat) stat->count++;
+        handler(request);
+    });
+}
+
 /**
  * @brief Get MIME type from file extension
  * @param filename Name of file
@@ -112,22 +309,34 @@ String getContentType(String filename) {
 
 /**
  * @brief Serve file from LittleFS filesystem
+ * @param request Current request
  * @param path File path to serve
  * @return true if file was served successfully
+ * @note The file is streamed in chunks from the AsyncTCP task
  */
-bool handleFileRead(String path) {
-    Serial.println("handleFileRead: " + path);
-    
+bool handleFileRead(AsyncWebServerRequest* request, String path) {
     if (path.endsWith("/")) {
         path += "index.html";
     }
+
+#ifdef EMBED_WEB_ASSETS
+    // Compiled-in assets with precomputed type and ETag, no filesystem access
+    if (webAssetsServeEmbedded(request, path)) {
+        return true;
+    }
+#endif
+
+    Serial.println("handleFileRead: " + path);
     
     String contentType = getContentType(path);
+
+    // Pre-built gzip assets with ETag/304, see tools/build_assets.py
+    if (webAssetsServe(request, path, contentType)) {
+        return true;
+    }
     
     if (SPIFFS.exists(path)) {
-        File file = SPIFFS.open(path, "r");
-        server.streamFile(file, contentType);
-        file.close();
+        request->send(SPIFFS, path, contentType);
         return true;
     }
     
@@ -146,96 +355,149 @@ void startWebServer()
     prefs.end();
     Serial.println("Auth enabled - User: " + authUsername);
 
+    webAssetsBegin();
+
     // Serve static files from LittleFS
-    server.onNotFound([]() {
-        if (!checkAuth()) return;
-        if (!handleFileRead(server.uri())) {
-            server.send(404, "text/plain", "404: Not Found");
+    server.onNotFound([](AsyncWebServerRequest* request) {
+        {
+            StateLock lock;
+            staticRequests++;
+            if (!checkAuth(request)) return;
+        }
+        if (!handleFileRead(request, request->url())) {
+            request->send(404, "text/plain", "404: Not Found");
         }
     });
 
-    server.on("/", HTTP_GET, []()
+    server.on("/", HTTP_GET, [](AsyncWebServerRequest* request)
               { 
-        if (!checkAuth()) return;
-        handleFileRead("/index.html"); });
+        {
+            StateLock lock;
+            staticRequests++;
+            if (!checkAuth(request)) return;
+        }
+        handleFileRead(request, "/index.html"); });
+
+    apiGet("/api/status", [](AsyncWebServerRequest* request)
+              {
+        if (!checkAuth(request)) return;
+        sendStatus(request); });
+
+    apiGet("/api/batch", [](AsyncWebServerRequest* request)
+              {
+        if (!checkAuth(request)) return;
+        // One round trip for what a UI refresh needs, e.g. ?parts=status,log_status
+        String parts = request->hasArg("parts") ? request->arg("parts")
+                                                 : String("status,log_status,tariff,autolog,loginterval");
+        String json = "{";
+        int pos = 0;
+        while (pos <= (int)parts.length()) {
+          int end = parts.indexOf(',', pos);
+          if (end < 0) end = parts.length();
+          String part = parts.substring(pos, end);
+          part.trim();
+          pos = end + 1;
+          if (part.length() == 0) continue;
+
+          String body;
+          if (part == "status") body = buildStatusJson();
+          else if (part == "log_status") body = buildLogStatusJson();
+          else if (part == "tariff") body = buildTariffJson();
+          else if (part == "autolog") body = buildAutologJson();
+          else if (part == "loginterval") body = buildLogIntervalJson();
+          else {
+            request->send(400, "text/plain", "unknown part: " + part);
+            return;
+          }
+          if (json.length() > 1) json += ",";
+          json += "\"" + part + "\":" + body;
+        }
+        json += "}";
+        request->send(200, "application/json", json); });
 
-    server.on("/api/status", HTTP_GET, []()
+    apiGet("/api/http_stats", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
-        uint32_t now = millis();
-        bool timer = offTimerRunning;
-        uint32_t remaining = 0;
-        if (timer) {
-          uint32_t elapsed = now - offTimerStart;
-          remaining = (elapsed >= offDelayMs) ? 0 : (offDelayMs - elapsed);
+        if (!checkAuth(request)) return;
+        uint32_t total = staticRequests;
+        String routes = "{";
+        for (uint8_t i = 0; i < routeStatCount; i++) {
+          total += routeStats[i].count;
+          if (i > 0) routes += ",";
+          routes += "\"" + String(routeStats[i].uri) + "\":" + String(routeStats[i].count);
         }
+        routes += "}";
+
+        String json = "{";
+        json += "\"uptime_ms\":" + String(millis()) + ",";
+        json += "\"total\":" + String(total) + ",";
+        json += "\"static\":" + String(staticRequests) + ",";
+        json += "\"event_clients\":" + String(statusEventsClients()) + ",";
+        json += "\"routes\":" + routes;
+        json += "}";
+        request->send(200, "application/json", json); });
 
-        uint32_t timerMinutes = offDelayMs / 60000UL;
-        String deviceIp = WiFi.localIP().toString();
-        String wifiSSID = WiFi.SSID();
+    apiGet("/api/relay_stats", [](AsyncWebServerRequest* request)
+              {
+        if (!checkAuth(request)) return;
+        RelayClientStats st;
+        relayClientGetStats(st);
+        uint32_t avgNew    = st.newLatencyCount    ? st.newLatencyTotalMs / st.newLatencyCount : 0;
+        uint32_t avgReused = st.reusedLatencyCount ? st.reusedLatencyTotalMs / st.reusedLatencyCount : 0;
+        uint32_t savedMs   = (avgNew > avgReused) ? (avgNew - avgReused) * st.reusedLatencyCount : 0;
 
         String json = "{";
-        json += "\"auto_mode\":"     + String(autoPowerOffEnabled ? "true" : "false") + ",";
-        json += "\"timer\":"         + String(timer ? "true" : "false") + ",";
-        json += "\"remaining_ms\":"  + String(remaining) + ",";
-        json += "\"total_ms\":"      + String(offDelayMs) + ",";
-        json += "\"timer_minutes\":" + String(timerMinutes) + ",";
-        json += "\"report_valid\":"  + String(reportValid ? "true" : "false") + ",";
-        json += "\"relay\":"         + String(reportRelay ? "true" : "false") + ",";
-        json += "\"power\":"         + String(reportPower, 2) + ",";
-        json += "\"ws\":"            + String(reportWs, 2) + ",";
-        json += "\"temperature\":"   + String(reportTemperature, 2) + ",";
-        json += "\"energy_boot\":"   + String(reportEnergyBoot, 2) + ",";
-        json += "\"time_boot\":"     + String(reportTimeBoot) + ",";
-        json += "\"boot_id\":\""     + reportBootId + "\",";
-        json += "\"relay_ip\":\""    + relayIpAddress + "\",";
-        json += "\"device_ip\":\""   + deviceIp + "\",";
-        json += "\"wifi_ssid\":\""   + wifiSSID + "\"";
+        json += "\"requests\":"      + String(st.requests) + ",";
+        json += "\"failures\":"      + String(st.failures) + ",";
+        json += "\"handshakes\":"    + String(st.handshakes) + ",";
+        json += "\"reused\":"        + String(st.reused) + ",";
+        json += "\"reconnects\":"    + String(st.reconnects) + ",";
+        json += "\"avg_new_ms\":"    + String(avgNew) + ",";
+        json += "\"avg_reused_ms\":" + String(avgReused) + ",";
+        json += "\"saved_ms\":"      + String(savedMs) + ",";
+        json += "\"last_ms\":"       + String(st.lastLatencyMs);
         json += "}";
-        server.send(200, "application/json", json); });
+        request->send(200, "application/json", json); });
 
-    server.on("/api/mode", HTTP_GET, []()
+    apiGet("/api/mode", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         autoPowerOffEnabled = !autoPowerOffEnabled;
-        offTimerRunning = false;
+        cancelOffTimer();
         if (autoPowerOffEnabled) {
           showAutoOffEnabledBase();
         } else {
           showAutoOffDisabled();
         }
-        server.send(200, "text/plain", autoPowerOffEnabled ? "auto_mode=ON" : "auto_mode=OFF"); });
+        request->send(200, "text/plain", autoPowerOffEnabled ? "auto_mode=ON" : "auto_mode=OFF"); });
 
-    server.on("/api/off_now", HTTP_GET, []()
+    apiGet("/api/off_now", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         offTimerRunning = false;
         sendOff();
-        clearMatrix();
-        M5.dis.fillpix(0x000000);
-        drawI(0xFF0000);
-        server.send(200, "text/plain", "off_now=OK"); });
+        showOffPending();
+        request->send(200, "text/plain", "off_now=OK"); });
 
-    server.on("/api/on_now", HTTP_GET, []()
+    apiGet("/api/on_now", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         sendOn();
-        server.send(200, "text/plain", "on_now=OK"); });
+        request->send(200, "text/plain", "on_now=OK"); });
 
-    server.on("/api/toggle", HTTP_GET, []()
+    apiGet("/api/toggle", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         sendToggle();
-        server.send(200, "text/plain", "toggle=OK"); });
+        request->send(200, "text/plain", "toggle=OK"); });
 
-    server.on("/api/set_timer", HTTP_GET, []()
+    apiGet("/api/set_timer", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
-        if (!server.hasArg("minutes")) {
-          server.send(400, "text/plain", "missing minutes");
+        if (!checkAuth(request)) return;
+        if (!request->hasArg("minutes")) {
+          request->send(400, "text/plain", "missing minutes");
           return;
         }
-        int minutes = server.arg("minutes").toInt();
+        int minutes = request->arg("minutes").toInt();
         if (minutes < 1) minutes = 1;
         if (minutes > 240) minutes = 240;
 
@@ -245,54 +507,144 @@ void startWebServer()
         prefs.begin("coreone", false);
         prefs.putUInt("off_delay_ms", offDelayMs); 
         prefs.end();
+        configGeneration++;
         Serial.println("store"+ String(offDelayMs)  );
 
-        server.send(200, "text/plain", "ok"); });
+        request->send(200, "text/plain", "ok"); });
 
-    server.on("/api/set_relay_ip", HTTP_GET, []()
+    apiGet("/api/set_relay_ip", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
-        if (!server.hasArg("ip")) {
-          server.send(400, "text/plain", "missing ip");
+        if (!checkAuth(request)) return;
+        if (!request->hasArg("ip")) {
+          request->send(400, "text/plain", "missing ip");
           return;
         }
-        String newIp = server.arg("ip");
+        String newIp = request->arg("ip");
         newIp.trim();
         
         if (newIp.length() < 7 || newIp.length() > 15) {
-          server.send(400, "text/plain", "invalid ip format");
+          request->send(400, "text/plain", "invalid ip format");
           return;
         }
 
-        relayIpAddress = newIp;
-
-        Preferences prefs;
-        prefs.begin("coreone", false);
-        prefs.putString("relay_ip", relayIpAddress);
-        prefs.end();
-        Serial.println("Stored relay IP: " + relayIpAddress);
+        RelayState& printer = relays[PRIMARY_RELAY];
+        printer.ip = newIp;
+        saveRelayConfig(PRIMARY_RELAY);
+        configGeneration++;
 
         // Reset error counter and force immediate status poll
-        consecutiveErrors = 0;
-        lastReportPollMs = 0;
-        updateReportStatus();
+        printer.consecutiveErrors = 0;
+        updateReportStatus(PRIMARY_RELAY);
 
-        server.send(200, "text/plain", "ok"); });
+        request->send(200, "text/plain", "ok"); });
 
-    server.on("/api/set_auth", HTTP_GET, []()
+    apiGet("/api/relay_set", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
-        if (!server.hasArg("user") || !server.hasArg("pass")) {
-          server.send(400, "text/plain", "missing user or pass");
+        if (!checkAuth(request)) return;
+        if (!request->hasArg("id")) {
+          request->send(400, "text/plain", "missing id");
+          return;
+        }
+        int id = request->arg("id").toInt();
+        if (id < 0 || id >= MAX_RELAYS) {
+          request->send(400, "text/plain", "invalid id");
           return;
         }
-        String newUser = server.arg("user");
-        String newPass = server.arg("pass");
+        RelayState& r = relays[id];
+
+        if (request->hasArg("ip")) {
+          String newIp = request->arg("ip");
+          newIp.trim();
+          // Empty IP disables an auxiliary relay slot
+          bool clear = newIp.length() == 0 && id != PRIMARY_RELAY;
+          if (!clear && (newIp.length() < 7 || newIp.length() > 15)) {
+            request->send(400, "text/plain", "invalid ip format");
+            return;
+          }
+          r.ip = newIp;
+          r.reportValid = false;
+          r.consecutiveErrors = 0;
+          r.pollIntervalMs = 0;  // Poll the new address right away
+        }
+        if (request->hasArg("driver")) {
+          RelayDriverType driver;
+          if (!relayDriverFromName(request->arg("driver"), driver)) {
+            request->send(400, "text/plain", "unknown driver");
+            return;
+          }
+          if (driver != r.driver) {
+            r.driver = driver;
+            r.reportValid = false;
+            r.consecutiveErrors = 0;
+            r.pollIntervalMs = 0;
+          }
+        }
+        if (request->hasArg("name")) {
+          String name = request->arg("name");
+          name.trim();
+          // Name is embedded in JSON without escaping
+          if (name.length() > 0 && name.length() <= 24 &&
+              name.indexOf('"') < 0 && name.indexOf('\\') < 0) {
+            r.name = name;
+          }
+        }
+        if (id != PRIMARY_RELAY) {
+          if (request->hasArg("auto_off")) {
+            r.autoOff = request->arg("auto_off") == "1" || request->arg("auto_off") == "true";
+            if (!r.autoOff) r.offArmed = false;
+          }
+          if (request->hasArg("delay_min")) {
+            int minutes = request->arg("delay_min").toInt();
+            if (minutes < 1) minutes = 1;
+            if (minutes > 240) minutes = 240;
+            r.offDelayMs = (uint32_t)minutes * 60UL * 1000UL;
+          }
+        }
+
+        saveRelayConfig(id);
+        configGeneration++;
+        request->send(200, "text/plain", "ok"); });
+
+    apiGet("/api/relay_cmd", [](AsyncWebServerRequest* request)
+              {
+        if (!checkAuth(request)) return;
+        if (!request->hasArg("id") || !request->hasArg("cmd")) {
+          request->send(400, "text/plain", "missing id or cmd");
+          return;
+        }
+        int id = request->arg("id").toInt();
+        if (id < 0 || id >= MAX_RELAYS || !relayConfigured(id)) {
+          request->send(400, "text/plain", "invalid id");
+          return;
+        }
+        String cmd = request->arg("cmd");
+        if (cmd == "on") {
+          sendOn(id);
+        } else if (cmd == "off") {
+          relays[id].offArmed = false;
+          sendOff(id);
+        } else if (cmd == "toggle") {
+          sendToggle(id);
+        } else {
+          request->send(400, "text/plain", "invalid cmd");
+          return;
+        }
+        request->send(200, "text/plain", "ok"); });
+
+    apiGet("/api/set_auth", [](AsyncWebServerRequest* request)
+              {
+        if (!checkAuth(request)) return;
+        if (!request->hasArg("user") || !request->hasArg("pass")) {
+          request->send(400, "text/plain", "missing user or pass");
+          return;
+        }
+        String newUser = request->arg("user");
+        String newPass = request->arg("pass");
         newUser.trim();
         newPass.trim();
         
         if (newUser.length() < 3 || newPass.length() < 4) {
-          server.send(400, "text/plain", "username min 3 chars, password min 4 chars");
+          request->send(400, "text/plain", "username min 3 chars, password min 4 chars");
           return;
         }
 
@@ -304,178 +656,195 @@ void startWebServer()
         prefs.putString("auth_user", authUsername);
         prefs.putString("auth_pass", authPassword);
         prefs.end();
+        configGeneration++;
         Serial.println("Updated auth - User: " + authUsername);
 
-        server.send(200, "text/plain", "ok"); });
+        request->send(200, "text/plain", "ok"); });
 
-    server.on("/api/reset_wifi", HTTP_GET, []()
+    apiGet("/api/reset_wifi", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         Serial.println("WiFi reset requested via web UI");
-        server.send(200, "text/plain", "Resetting WiFi settings and restarting...");
-        delay(500);
-        wifiManager.resetSettings();
-        delay(1000);
-        ESP.restart(); });
+        // Blocking here would stall the AsyncTCP task, loop() resets and restarts
+        wifiResetRequested = true;
+        request->send(200, "text/plain", "Resetting WiFi settings and restarting..."); });
 
     // Power logging API endpoints
-    server.on("/api/log_start", HTTP_GET, []()
+    apiGet("/api/log_start", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         startLogging();
-        server.send(200, "text/plain", "logging started"); });
+        request->send(200, "text/plain", "logging started"); });
 
-    server.on("/api/log_stop", HTTP_GET, []()
+    apiGet("/api/log_stop", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         stopLogging();
-        server.send(200, "text/plain", "logging stopped"); });
+        request->send(200, "text/plain", "logging stopped"); });
 
-    server.on("/api/log_clear", HTTP_GET, []()
+    apiGet("/api/log_clear", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         clearLog();
-        server.send(200, "text/plain", "log cleared"); });
+        request->send(200, "text/plain", "log cleared"); });
 
-    server.on("/api/log_status", HTTP_GET, []()
+    apiGet("/api/log_status", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
-        String json = "{";
-        json += "\"enabled\":" + String(loggingEnabled ? "true" : "false") + ",";
-        json += "\"count\":" + String(powerLogCount) + ",";
-        json += "\"max\":" + String(MAX_LOG_ENTRIES) + ",";
-        json += "\"duration_ms\":" + String(loggingEnabled ? (millis() - loggingStartMs) : 0);
-        json += "}";
-        server.send(200, "application/json", json); });
+        if (!checkAuth(request)) return;
+        request->send(200, "application/json", buildLogStatusJson()); });
 
-    server.on("/api/log_data", HTTP_GET, []()
+    apiGet("/api/log_data", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         
-        if (powerLogCount == 0) {
-          server.send(200, "application/json", "{\"timestamps\":[],\"power\":[],\"energy\":[],\"cost\":[]}");
+        // Streamed from a fixed buffer, heap use does not grow with the log.
+        // With ?since=<seq> only the entries logged after that cursor.
+        bool cursor = request->hasArg("since");
+        PowerLogRange range = cursor
+            ? powerLogRange((uint32_t)strtoul(request->arg("since").c_str(), nullptr, 10))
+            : powerLogRange();
+
+        // Filler callbacks run on the AsyncTCP task after the handler returned.
+        // Both formats are chunked: if the log moves past the range meanwhile
+        // the writer stops early and the client gets a short body to reject.
+        if (request->arg("format") == "bin") {
+          auto writer = std::make_shared<PowerLogBinaryWriter>(range);
+          request->send(request->beginChunkedResponse("application/octet-stream",
+              [writer](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+                StateLock lock;
+                return writer->read(buffer, maxLen);
+              }));
           return;
         }
 
-        String json = "{\"timestamps\":[";
-        
-        // Build timestamps array
-        size_t startIdx = (powerLogCount < MAX_LOG_ENTRIES) ? 0 : powerLogIndex;
-        for (size_t i = 0; i < powerLogCount; i++) {
-          size_t idx = (startIdx + i) % MAX_LOG_ENTRIES;
-          if (i > 0) json += ",";
-          json += String(powerLog[idx].timestamp);
-        }
-        json += "],\"power\":[";
-        
-        // Build power array
-        for (size_t i = 0; i < powerLogCount; i++) {
-          size_t idx = (startIdx + i) % MAX_LOG_ENTRIES;
-          if (i > 0) json += ",";
-          json += String(powerLog[idx].power, 2);
-        }
-        json += "],\"energy\":[";
-        
-        // Build energy array
-        for (size_t i = 0; i < powerLogCount; i++) {
-          size_t idx = (startIdx + i) % MAX_LOG_ENTRIES;
-          if (i > 0) json += ",";
-          json += String(powerLog[idx].energy, 3);
-        }
-        json += "],\"cost\":[";
-        
-        // Build cost array
-        for (size_t i = 0; i < powerLogCount; i++) {
-          size_t idx = (startIdx + i) % MAX_LOG_ENTRIES;
-          if (i > 0) json += ",";
-          json += String(powerLog[idx].cost, 4);
-        }
-        json += "]}";
-        
-        server.send(200, "application/json", json); });
+        auto writer = std::make_shared<PowerLogJsonWriter>(range, cursor);
+        request->send(request->beginChunkedResponse("application/json",
+            [writer](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+              StateLock lock;
+              return writer->read(buffer, maxLen);
+            })); });
 
     // Tariff settings API endpoints
-    server.on("/api/tariff_get", HTTP_GET, []()
+    apiGet("/api/tariff_get", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
-        String json = "{";
-        json += "\"high\":" + String(tariffHigh, 4) + ",";
-        json += "\"low\":" + String(tariffLow, 4) + ",";
-        json += "\"currency\":\"" + currency + "\",";
-        json += "\"start_hour\":" + String(tariffSwitchHour) + ",";
-        json += "\"end_hour\":" + String(tariffSwitchEndHour);
-        json += "}";
-        server.send(200, "application/json", json); });
+        if (!checkAuth(request)) return;
+        sendConfigJson(request, buildTariffJson); });
 
-    server.on("/api/tariff_set", HTTP_GET, []()
+    apiGet("/api/tariff_set", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         
         bool changed = false;
+        TariffSchedule next = tariffSchedule;  // Applied only if every parameter is valid
         
-        if (server.hasArg("high")) {
-          tariffHigh = server.arg("high").toFloat();
+        if (request->hasArg("prices")) {
+          // Price per band, e.g. prices=0.30,0.20,0.25; sets the number of bands
+          String prices = request->arg("prices");
+          uint8_t count = 0;
+          int pos = 0;
+          while (pos <= (int)prices.length()) {
+            int end = prices.indexOf(',', pos);
+            if (end < 0) end = prices.length();
+            if (count == TARIFF_MAX_BANDS) {
+              request->send(400, "text/plain", "too many bands");
+              return;
+            }
+            if (!parsePrice(prices.substring(pos, end), next.prices[count++])) {
+              request->send(400, "text/plain", "invalid price: " + prices.substring(pos, end));
+              return;
+            }
+            pos = end + 1;
+          }
+          if (count < 2) {
+            request->send(400, "text/plain", "at least 2 prices required");
+            return;
+          }
+          next.bandCount = count;
           changed = true;
         }
-        if (server.hasArg("low")) {
-          tariffLow = server.arg("low").toFloat();
+        if (request->hasArg("high")) {
+          if (!parsePrice(request->arg("high"), next.prices[TARIFF_BAND_HIGH])) {
+            request->send(400, "text/plain", "invalid price: " + request->arg("high"));
+            return;
+          }
           changed = true;
         }
-        if (server.hasArg("currency")) {
-          currency = server.arg("currency");
-          currency.trim();
-          if (currency.length() > 10) currency = currency.substring(0, 10);
+        if (request->hasArg("low")) {
+          if (!parsePrice(request->arg("low"), next.prices[TARIFF_BAND_LOW])) {
+            request->send(400, "text/plain", "invalid price: " + request->arg("low"));
+            return;
+          }
           changed = true;
         }
-        if (server.hasArg("start")) {
-          tariffSwitchHour = server.arg("start").toInt();
-          if (tariffSwitchHour < 0) tariffSwitchHour = 0;
-          if (tariffSwitchHour > 23) tariffSwitchHour = 23;
+        String nextCurrency = currency;
+        if (request->hasArg("currency")) {
+          nextCurrency = request->arg("currency");
+          nextCurrency.trim();
+          if (nextCurrency.length() > 10) nextCurrency = nextCurrency.substring(0, 10);
           changed = true;
         }
-        if (server.hasArg("end")) {
-          tariffSwitchEndHour = server.arg("end").toInt();
-          if (tariffSwitchEndHour < 0) tariffSwitchEndHour = 0;
-          if (tariffSwitchEndHour > 23) tariffSwitchEndHour = 23;
+        int startHour = tariffSwitchHour;
+        int endHour = tariffSwitchEndHour;
+        if (request->hasArg("start")) {
+          startHour = request->arg("start").toInt();
+          if (startHour < 0) startHour = 0;
+          if (startHour > 23) startHour = 23;
           changed = true;
         }
+        if (request->hasArg("end")) {
+          endHour = request->arg("end").toInt();
+          if (endHour < 0) endHour = 0;
+          if (endHour > 23) endHour = 23;
+          changed = true;
+        }
+        if (request->hasArg("start") || request->hasArg("end")) {
+          tariffSetWindow(next, startHour, endHour);  // Same window every day
+        }
+        
+        // Weekly schedule, overrides the daily window; also rechecks the current
+        // periods when fewer prices were given
+        String days = request->hasArg("schedule") ? request->arg("schedule") : tariffFormatDays(next);
+        if (!tariffParseDays(days, next)) {
+          request->send(400, "text/plain", "invalid schedule");
+          return;
+        }
+        if (request->hasArg("schedule")) changed = true;
         
         if (changed) {
-          saveTariffSettings();
-          server.send(200, "text/plain", "tariff settings saved");
+          tariffSchedule = next;
+          currency = nextCurrency;
+          tariffSwitchHour = startHour;
+          tariffSwitchEndHour = endHour;
+          saveTariffSettings();  // Bumps configGeneration
+          request->send(200, "text/plain", "tariff settings saved");
         } else {
-          server.send(400, "text/plain", "no parameters provided");
+          request->send(400, "text/plain", "no parameters provided");
         } });
 
     // Auto-logging settings endpoints
-    server.on("/api/autolog_get", HTTP_GET, []()
+    apiGet("/api/autolog_get", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
-        String json = "{";
-        json += "\"enabled\":" + String(autoLogEnabled ? "true" : "false") + ",";
-        json += "\"threshold\":" + String(autoLogThreshold, 1) + ",";
-        json += "\"debounce\":" + String(autoLogDebounce);
-        json += "}";
-        server.send(200, "application/json", json); });
+        if (!checkAuth(request)) return;
+        sendConfigJson(request, buildAutologJson); });
 
-    server.on("/api/autolog_set", HTTP_GET, []()
+    apiGet("/api/autolog_set", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         
         bool changed = false;
         
-        if (server.hasArg("enabled")) {
-          autoLogEnabled = (server.arg("enabled") == "true" || server.arg("enabled") == "1");
+        if (request->hasArg("enabled")) {
+          autoLogEnabled = (request->arg("enabled") == "true" || request->arg("enabled") == "1");
           changed = true;
         }
-        if (server.hasArg("threshold")) {
-          autoLogThreshold = server.arg("threshold").toFloat();
+        if (request->hasArg("threshold")) {
+          autoLogThreshold = request->arg("threshold").toFloat();
           if (autoLogThreshold < 0.1f) autoLogThreshold = 0.1f;
           if (autoLogThreshold > 500.0f) autoLogThreshold = 500.0f;
           changed = true;
         }
-        if (server.hasArg("debounce")) {
-          autoLogDebounce = server.arg("debounce").toInt();
+        if (request->hasArg("debounce")) {
+          autoLogDebounce = request->arg("debounce").toInt();
           if (autoLogDebounce < 5) autoLogDebounce = 5;
           if (autoLogDebounce > 300) autoLogDebounce = 300;
           changed = true;
@@ -488,6 +857,7 @@ void startWebServer()
           prefs.putFloat("autolog_th", autoLogThreshold);
           prefs.putUInt("autolog_db", autoLogDebounce);
           prefs.end();
+          configGeneration++;
           
           Serial.printf("Auto-logging settings saved: %s, %.1fW, %us\n",
                        autoLogEnabled ? "ON" : "OFF", autoLogThreshold, autoLogDebounce);
@@ -496,32 +866,27 @@ void startWebServer()
           autoLogAboveMs = 0;
           autoLogBelowMs = 0;
           
-          server.send(200, "text/plain", "autolog settings saved");
+          request->send(200, "text/plain", "autolog settings saved");
         } else {
-          server.send(400, "text/plain", "no parameters provided");
+          request->send(400, "text/plain", "no parameters provided");
         } });
 
     // Log interval settings endpoints
-    server.on("/api/loginterval_get", HTTP_GET, []()
+    apiGet("/api/loginterval_get", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
-        String json = "{";
-        json += "\"interval\":" + String(logIntervalSeconds) + ",";
-        json += "\"maxEntries\":" + String(MAX_LOG_ENTRIES) + ",";
-        json += "\"maxMinutes\":" + String((MAX_LOG_ENTRIES * logIntervalSeconds) / 60);
-        json += "}";
-        server.send(200, "application/json", json); });
+        if (!checkAuth(request)) return;
+        sendConfigJson(request, buildLogIntervalJson); });
 
-    server.on("/api/loginterval_set", HTTP_GET, []()
+    apiGet("/api/loginterval_set", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         
-        if (!server.hasArg("interval")) {
-          server.send(400, "text/plain", "missing interval parameter");
+        if (!request->hasArg("interval")) {
+          request->send(400, "text/plain", "missing interval parameter");
           return;
         }
         
-        uint32_t newInterval = server.arg("interval").toInt();
+        uint32_t newInterval = request->arg("interval").toInt();
         if (newInterval < 5) newInterval = 5;
         if (newInterval > 300) newInterval = 300;
         
@@ -531,118 +896,178 @@ void startWebServer()
         prefs.begin("coreone", false);
         prefs.putUInt("log_interval", logIntervalSeconds);
         prefs.end();
+        configGeneration++;
         
-        Serial.printf("Log interval saved: %us (max duration: ~%u minutes)\n",
-                     logIntervalSeconds, (MAX_LOG_ENTRIES * logIntervalSeconds) / 60);
+        Serial.printf("Log interval saved: %us (full resolution: ~%u minutes, history: ~%u minutes)\n",
+                     logIntervalSeconds, powerLogSampleMinutes(logIntervalSeconds),
+                     powerLogHistoryMinutes(logIntervalSeconds));
         
-        server.send(200, "text/plain", "log interval saved"); });
+        request->send(200, "text/plain", "log interval saved"); });
 
-    // File management endpoints
-    server.on("/api/files/status", HTTP_GET, []()
+    // Relay poll policy endpoints
+    apiGet("/api/poll_get", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
-        
-        size_t totalBytes = SPIFFS.totalBytes();
-        size_t usedBytes = SPIFFS.usedBytes();
-        size_t freeBytes = totalBytes - usedBytes;
-        float usedPercent = (float)usedBytes / totalBytes * 100.0f;
-        
+        if (!checkAuth(request)) return;
         String json = "{";
-        json += "\"total\":" + String(totalBytes) + ",";
-        json += "\"used\":" + String(usedBytes) + ",";
-        json += "\"free\":" + String(freeBytes) + ",";
-        json += "\"usedPercent\":" + String(usedPercent, 1);
+        json += "\"fast_ms\":" + String(pollPolicy.fastMs) + ",";
+        json += "\"normal_ms\":" + String(pollPolicy.normalMs) + ",";
+        json += "\"idle_ms\":" + String(pollPolicy.idleMs) + ",";
+        json += "\"max_backoff_ms\":" + String(pollPolicy.maxBackoffMs) + ",";
+        json += "\"power_delta\":" + String(pollPolicy.powerDeltaW, 1) + ",";
+        json += "\"mode\":\"" + String(pollModeName(pollSchedulerMode(PRIMARY_RELAY))) + "\",";
+        json += "\"interval_ms\":" + String(relays[PRIMARY_RELAY].pollIntervalMs);
         json += "}";
+        request->send(200, "application/json", json); });
+
+    apiGet("/api/poll_set", [](AsyncWebServerRequest* request)
+              {
+        if (!checkAuth(request)) return;
+        
+        bool changed = false;
+        
+        if (request->hasArg("fast")) {
+          pollPolicy.fastMs = request->arg("fast").toInt();
+          changed = true;
+        }
+        if (request->hasArg("normal")) {
+          pollPolicy.normalMs = request->arg("normal").toInt();
+          changed = true;
+        }
+        if (request->hasArg("idle")) {
+          pollPolicy.idleMs = request->arg("idle").toInt();
+          changed = true;
+        }
+        if (request->hasArg("max_backoff")) {
+          pollPolicy.maxBackoffMs = request->arg("max_backoff").toInt();
+          changed = true;
+        }
+        if (request->hasArg("power_delta")) {
+          pollPolicy.powerDeltaW = request->arg("power_delta").toFloat();
+          changed = true;
+        }
         
-        server.send(200, "application/json", json); });
+        if (changed) {
+          savePollPolicy();  // Clamps values before storing
+          configGeneration++;
+          request->send(200, "text/plain", "poll policy saved");
+        } else {
+          request->send(400, "text/plain", "no parameters provided");
+        } });
+
+    // File management endpoints
+    apiGet("/api/files/status", [](AsyncWebServerRequest* request)
+              {
+        if (!checkAuth(request)) return;
+        // No generation ETag: WAL appends and log eviction change usage too
+        request->send(200, "application/json", buildFilesStatusJson()); });
 
-    server.on("/api/files/list", HTTP_GET, []()
+    apiGet("/api/files/list", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         
+        // From the log index, no directory walk
         String json = "[";
-        File root = SPIFFS.open("/");
-        File file = root.openNextFile();
-        bool first = true;
-        
-        while (file) {
-          if (!file.isDirectory()) {
-            String filename = String(file.name());
-            if (filename.startsWith("/log_") && filename.endsWith(".csv")) {
-              if (!first) json += ",";
-              json += "{";
-              json += "\"name\":\"" + filename + "\",";
-              json += "\"size\":" + String(file.size());
-              json += "}";
-              first = false;
-            }
-          }
-          file = root.openNextFile();
+        for (uint8_t i = 0; i < logIndexCount(); i++) {
+          const LogFileInfo& file = logIndexAt(i);
+          if (i > 0) json += ",";
+          json += "{";
+          json += "\"name\":\"" + String(file.name) + "\",";
+          json += "\"size\":" + String(file.size) + ",";
+          json += "\"start\":" + String(file.startTime) + ",";
+          json += "\"duration_s\":" + String(file.durationS) + ",";
+          json += "\"energy_wh\":" + String(file.energyWh, 2) + ",";
+          json += "\"cost\":" + String(file.cost, 4);
+          json += "}";
         }
         json += "]";
         
-        server.send(200, "application/json", json); });
+        request->send(200, "application/json", json); });
 
-    server.on("/api/files/download", HTTP_GET, []()
+    apiGet("/api/files/download", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         
-        if (!server.hasArg("file")) {
-          server.send(400, "text/plain", "missing file parameter");
+        if (!request->hasArg("file")) {
+          request->send(400, "text/plain", "missing file parameter");
           return;
         }
         
-        String filename = server.arg("file");
+        String filename = request->arg("file");
         if (!filename.startsWith("/")) {
           filename = "/" + filename;
         }
         
-        if (!SPIFFS.exists(filename)) {
-          server.send(404, "text/plain", "file not found");
+        // Only saved logs, not /logindex.bin, the session WAL or the web assets
+        if (!logIndexFind(filename.c_str()) || !SPIFFS.exists(filename)) {
+          request->send(404, "text/plain", "file not found");
           return;
         }
         
-        File file = SPIFFS.open(filename, FILE_READ);
-        if (!file) {
-          server.send(500, "text/plain", "failed to open file");
+        // Streamed in chunks after the handler returned, loop() keeps running.
+        // CSV files saved before the binary format are sent as they are.
+        if (!filename.endsWith(".bin")) {
+          request->send(SPIFFS, filename, "text/csv");
           return;
         }
-        
-        server.streamFile(file, "text/csv");
-        file.close(); });
+        if (request->arg("format") == "bin") {
+          request->send(SPIFFS, filename, "application/octet-stream", true);
+          return;
+        }
+
+        // Binary log, transcoded to CSV while it is sent
+        auto writer = std::make_shared<LogFileCsvWriter>(SPIFFS.open(filename, FILE_READ));
+        if (!writer->valid()) {
+          request->send(500, "text/plain", "invalid log file");
+          return;
+        }
+        String csvName = filename.substring(1, filename.length() - 4) + ".csv";
+        AsyncWebServerResponse* response = request->beginChunkedResponse("text/csv",
+            [writer](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+              return writer->read(buffer, maxLen);
+            });
+        response->addHeader("Content-Disposition", "attachment; filename=\"" + csvName + "\"");
+        request->send(response); });
 
-    server.on("/api/files/delete", HTTP_GET, []()
+    apiGet("/api/files/delete", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         
-        if (!server.hasArg("file")) {
-          server.send(400, "text/plain", "missing file parameter");
+        if (!request->hasArg("file")) {
+          request->send(400, "text/plain", "missing file parameter");
           return;
         }
         
-        String filename = server.arg("file");
+        String filename = request->arg("file");
         if (!filename.startsWith("/")) {
           filename = "/" + filename;
         }
         
+        // Only saved logs, deleting /logindex.bin or a session WAL would lose data
+        if (!logIndexFind(filename.c_str())) {
+          request->send(404, "text/plain", "file not found");
+          return;
+        }
+        
         if (deleteLogFile(filename)) {
-          server.send(200, "text/plain", "file deleted");
+          request->send(200, "text/plain", "file deleted");
         } else {
-          server.send(500, "text/plain", "failed to delete file");
+          request->send(500, "text/plain", "failed to delete file");
         } });
 
-    server.on("/api/files/save", HTTP_GET, []()
+    apiGet("/api/files/save", [](AsyncWebServerRequest* request)
               {
-        if (!checkAuth()) return;
+        if (!checkAuth(request)) return;
         
         String filename = saveLogToFile();
         if (filename.length() > 0) {
           String json = "{\"filename\":\"" + filename + "\"}";
-          server.send(200, "application/json", json);
+          request->send(200, "application/json", json);
         } else {
-          server.send(400, "text/plain", "no data to save");
+          request->send(400, "text/plain", "no data to save");
         } });
 
+    statusEventsBegin(server);
+
     server.begin();
     Serial.println("HTTP server started");
 }
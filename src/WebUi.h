@@ -4,40 +4,77 @@
  * 
  * Provides embedded web UI with Bootstrap styling, live AJAX status updates,
  * and REST API endpoints for control and configuration.
+ *
+ * Requests are served by ESPAsyncWebServer on the AsyncTCP task, so several
+ * browsers and file downloads are handled concurrently without blocking
+ * loop(). Handlers share the control state with loop() under StateLock.
  */
 
 #pragma once
-#include <WebServer.h>
+#include <ESPAsyncWebServer.h>
 #include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "Relays.h"
 
 // Global state variables from main.cpp
-extern WebServer server;          ///< HTTP server instance
+extern AsyncWebServer server;     ///< HTTP server instance
+extern SemaphoreHandle_t stateMutex; ///< Guards control state between loop() and web handlers
+extern bool wifiResetRequested;   ///< Set by /api/reset_wifi, performed by loop()
+extern uint32_t configGeneration; ///< Bumped by every settings change, ETag of settings GETs
 extern bool autoPowerOffEnabled;  ///< Auto power-off mode enabled
 extern bool offTimerRunning;      ///< Timer countdown active
-extern bool reportValid;          ///< Relay report data is valid
-extern bool reportRelay;          ///< Relay state from report
-extern float reportPower;         ///< Current power in watts
-extern float reportWs;            ///< Watt-seconds measurement
-extern float reportTemperature;   ///< Device temperature
-extern String reportBootId;       ///< Relay device boot ID
-extern float reportEnergyBoot;    ///< Energy since boot
-extern uint32_t reportTimeBoot;   ///< Time since boot (seconds)
 extern uint32_t offDelayMs;       ///< Auto-off delay in milliseconds
 extern uint32_t offTimerStart;    ///< Timer start timestamp
 extern Preferences prefs;         ///< NVS preferences storage
-extern String relayIpAddress;     ///< Configurable relay IP address
+
+constexpr uint8_t HTTP_ROUTE_STATS_MAX = 48;  ///< API routes with a request counter
+
+/**
+ * @brief Scoped lock of the control state shared by loop() and the web handlers
+ * @note loop() holds the mutex while it runs its control logic, handlers wait
+ *       for it instead of interleaving with a half-done update
+ */
+class StateLock {
+ public:
+  StateLock() { xSemaphoreTake(stateMutex, portMAX_DELAY); }
+  ~StateLock() { xSemaphoreGive(stateMutex); }
+  StateLock(const StateLock&) = delete;
+  StateLock& operator=(const StateLock&) = delete;
+};
 
 /**
  * @brief Initialize and start the HTTP web server
  * @note Registers all API endpoints and serves HTML UI
  * @note API endpoints:
  *   - GET / - Main HTML page
- *   - GET /api/status - JSON status (auto mode, timer, relay state, etc.)
+ *   - GET /api/status - JSON status (auto mode, timer, printer relay, relays[] table, etc.)
+ *   - GET /api/events - Server-Sent Events stream ("status", "log") for live updates
+ *   - GET /api/batch?parts=status,log_status,tariff,autolog,loginterval - Several documents in one response
+ *   - GET /api/http_stats - Request counters per route
+ *   - GET /api/relay_stats - Relay connection reuse and latency counters
  *   - GET /api/mode - Toggle auto power-off mode
  *   - GET /api/off_now - Power off relay immediately
  *   - GET /api/on_now - Power on relay immediately
  *   - GET /api/toggle - Toggle relay state
  *   - GET /api/set_timer?minutes=N - Set auto-off delay (1-240 minutes)
- *   - GET /api/set_relay_ip?ip=X.X.X.X - Set relay IP address
+ *   - GET /api/set_relay_ip?ip=X.X.X.X - Set printer relay IP address
+ *   - GET /api/relay_set?id=N&name=&ip=&driver=&auto_off=0|1&delay_min= - Configure relay N
+ *   - GET /api/relay_cmd?id=N&cmd=on|off|toggle - Switch relay N
+ *   - GET /api/poll_get - Relay poll policy and current poll mode
+ *   - GET /api/poll_set?fast=&normal=&idle=&max_backoff=&power_delta= - Update poll policy
  */
 void startWebServer();
+
+/**
+ * @brief Check HTTP Basic Authentication without answering the request
+ * @param request Current request
+ * @return true if the credentials match
+ */
+bool isAuthenticated(AsyncWebServerRequest* request);
+
+/**
+ * @brief Log status JSON shared by /api/log_status and the "log" event
+ * @return {"enabled","count","max","duration_ms","wal_dropped"}
+ */
+String buildLogStatusJson();
@@ -12,9 +12,8 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
-#include <HTTPClient.h>
 #include <M5Atom.h>
-#include <WebServer.h>
+#include <ESPAsyncWebServer.h>
 #include <ArduinoJson.h>
 #include <Preferences.h>
 #include <FS.h>
@@ -23,38 +22,25 @@
 #include "LedDisplay.h"
 #include "ButtonMode.h"
 #include "WebUi.h"
+#include "Relays.h"
+#include "RelayClient.h"
+#include "PollScheduler.h"
+#include "RelayCommand.h"
+#include "StatusEvents.h"
+#include "PowerLog.h"
+#include "LogIndex.h"
+#include "LogFile.h"
+#include "LogWal.h"
+#include "Tariff.h"
 
 WiFiManager wifiManager; ///< WiFiManager for captive portal configuration
 
 constexpr int INPUT_PIN = 33; ///< GPIO pin for external signal monitoring (printer status)
 
-String relayIpAddress = "192.168.188.44"; ///< Configurable relay device IP address (stored in NVS)
-
-/**
- * @brief Build URL for relay toggle endpoint
- * @return Complete URL string for toggling relay state
- */
-String getUrlToggle() { return "http://" + relayIpAddress + "/toggle"; }
-
-/**
- * @brief Build URL for relay OFF command
- * @return Complete URL string for turning relay off
- */
-String getUrlOff()    { return "http://" + relayIpAddress + "/relay?state=0"; }
-
-/**
- * @brief Build URL for relay ON command
- * @return Complete URL string for turning relay on
- */
-String getUrlOn()     { return "http://" + relayIpAddress + "/relay?state=1"; }
-
-/**
- * @brief Build URL for relay status report endpoint
- * @return Complete URL string for fetching relay JSON status
- */
-String getUrlReport() { return "http://" + relayIpAddress + "/report"; }
-
-WebServer server(80); ///< HTTP server on port 80 for web UI
+AsyncWebServer server(80); ///< HTTP server on port 80 for web UI
+SemaphoreHandle_t stateMutex = nullptr; ///< Held by loop() and web handlers, see StateLock
+bool wifiResetRequested = false;        ///< Reset WiFi settings and restart on next loop()
+uint32_t configGeneration = 0;           ///< See WebUi.h, randomized at boot
 
 // Input signal debouncing state
 bool     lastState        = HIGH;      ///< Last stable state of INPUT_PIN
@@ -65,49 +51,22 @@ bool     autoPowerOffEnabled = false;  ///< Auto power-off mode enabled flag
 bool     offTimerRunning     = false;  ///< Timer countdown active flag
 uint32_t offTimerStart       = 0;      ///< Timestamp when timer started
 
-// Relay status report from HTTP polling
-bool     reportValid       = false;    ///< Report data is valid and up-to-date
-bool     reportRelay       = false;    ///< Relay state (ON/OFF) from report
-float    reportPower       = 0.0f;     ///< Current power consumption in watts
-float    reportWs          = 0.0f;     ///< Watt-seconds energy measurement
-float    reportTemperature = 0.0f;     ///< Device temperature in Celsius
-String   reportBootId      = "";       ///< Unique boot ID from relay device
-float    reportEnergyBoot  = 0.0f;     ///< Energy consumed since boot [Ws]
-uint32_t reportTimeBoot    = 0;        ///< Time since boot in seconds
-
-uint32_t lastReportPollMs  = 0;        ///< Timestamp of last status poll
-constexpr uint32_t REPORT_POLL_INTERVAL_MS = 5000; ///< Poll relay every 5 seconds
-constexpr uint32_t REPORT_POLL_INTERVAL_ERROR_MS = 30000; ///< Poll every 30 seconds when errors occur
-uint32_t consecutiveErrors = 0;        ///< Count of consecutive connection failures
-
 Preferences prefs;                     ///< ESP32 NVS preferences storage
 uint32_t offDelayMs = 10UL * 60UL * 1000UL; ///< Auto-off delay (default 10 minutes)
 
-// Power/Energy data logging
-#define MAX_LOG_ENTRIES 500  ///< Maximum number of log entries (fits in ~12KB RAM)
-
-struct PowerLogEntry {
-  uint32_t timestamp;  // Milliseconds since boot
-  float power;         // Watts
-  float energy;        // Wh cumulative
-  float cost;          // Cost in currency
-};
-
-PowerLogEntry powerLog[MAX_LOG_ENTRIES];
-size_t powerLogCount = 0;
-size_t powerLogIndex = 0;  // Circular buffer index
+// Power/Energy data logging (ring buffer in PowerLog.cpp)
 bool loggingEnabled = false;
 uint32_t loggingStartMs = 0;
-float energyStartWs = 0.0f;  // Energy at start of logging [Ws]
+double energyStartWs = 0.0;  // Energy at start of logging [Ws]
 uint32_t lastLogMs = 0;
+PowerLogInterval logInterval;  ///< Polls since the last log entry
+TariffCostMeter costMeter;     ///< Cost of the running session, per tariff band
 uint32_t logIntervalSeconds = 10;  ///< Log interval in seconds (configurable, stored in NVS)
 
-// Tariff settings (stored in NVS)
-float tariffHigh = 0.30f;      ///< High tariff price per kWh (default 0.30 EUR)
-float tariffLow = 0.20f;       ///< Low tariff price per kWh (default 0.20 EUR)
+// Tariff settings (stored in NVS), prices and bands in tariffSchedule
 String currency = "EUR";       ///< Currency symbol (EUR, USD, GBP, etc.)
-int tariffSwitchHour = 22;     ///< Hour when low tariff starts (22:00 = 10 PM)
-int tariffSwitchEndHour = 6;   ///< Hour when low tariff ends (06:00 = 6 AM)
+int tariffSwitchHour = 22;     ///< Hour when the daily low tariff window starts (22:00 = 10 PM)
+int tariffSwitchEndHour = 6;   ///< Hour when the daily low tariff window ends (06:00 = 6 AM)
 
 // Auto-logging settings (stored in NVS)
 bool autoLogEnabled = false;   ///< Auto-start logging when power exceeds threshold
@@ -119,17 +78,18 @@ bool manualStopOverride = false; ///< User manually stopped logging, prevent aut
 
 // Forward declarations
 void ensureWifi();
-void sendGet(const String& url);
-void sendOff();
-void sendOn();
-void sendToggle();
-void updateReportStatus();
+void sendOff(uint8_t relayId = PRIMARY_RELAY);
+void sendOn(uint8_t relayId = PRIMARY_RELAY);
+void sendToggle(uint8_t relayId = PRIMARY_RELAY);
+void cancelOffTimer();
+void updateReportStatus(uint8_t relayId);
+void handleRelayResults();
+void applyReport(const RelayResult& result);
 void startLogging();
 void stopLogging();
 void checkAutoLogging();
 void clearLog();
 void logPowerData();
-float getCurrentTariff();
 void loadTariffSettings();
 void saveTariffSettings();
 String saveLogToFile();
@@ -137,42 +97,14 @@ bool deleteLogFile(const String& filename);
 void cleanupOldestLog();
 bool ensureSpaceForLog(size_t requiredBytes);
 
-/**
- * @brief Get current tariff rate based on time of day
- * @return Current tariff price per kWh
- */
-float getCurrentTariff() {
-  struct tm timeinfo;
-  if (!getLocalTime(&timeinfo)) {
-    return tariffHigh; // Default to high tariff if time unavailable
-  }
-  
-  int currentHour = timeinfo.tm_hour;
-  
-  // Check if we're in low tariff period
-  if (tariffSwitchHour < tariffSwitchEndHour) {
-    // Normal case: e.g., 1:00 to 6:00
-    if (currentHour >= tariffSwitchHour && currentHour < tariffSwitchEndHour) {
-      return tariffLow;
-    }
-  } else {
-    // Overnight case: e.g., 22:00 to 6:00
-    if (currentHour >= tariffSwitchHour || currentHour < tariffSwitchEndHour) {
-      return tariffLow;
-    }
-  }
-  
-  return tariffHigh;
-}
-
 /**
  * @brief Load tariff settings from NVS
  */
 void loadTariffSettings() {
   Preferences prefs;
   prefs.begin("coreone", true); // Read-only
-  tariffHigh = prefs.getFloat("tariff_high", 0.30f);
-  tariffLow = prefs.getFloat("tariff_low", 0.20f);
+  float tariffHigh = prefs.getFloat("tariff_high", 0.30f);
+  float tariffLow = prefs.getFloat("tariff_low", 0.20f);
   currency = prefs.getString("currency", "EUR");
   tariffSwitchHour = prefs.getInt("tariff_start", 22);
   tariffSwitchEndHour = prefs.getInt("tariff_end", 6);
@@ -181,61 +113,72 @@ void loadTariffSettings() {
   autoLogDebounce = prefs.getUInt("autolog_db", 30);
   logIntervalSeconds = prefs.getUInt("log_interval", 10);
   prefs.end();
+  tariffLoad(tariffHigh, tariffLow, tariffSwitchHour, tariffSwitchEndHour);  // Window only if no schedule was saved
   
   Serial.printf("Loaded tariffs: High=%.4f, Low=%.4f %s, Period=%02d:00-%02d:00\n", 
-                tariffHigh, tariffLow, currency.c_str(), tariffSwitchHour, tariffSwitchEndHour);
+                tariffSchedule.prices[TARIFF_BAND_HIGH], tariffSchedule.prices[TARIFF_BAND_LOW],
+                currency.c_str(), tariffSwitchHour, tariffSwitchEndHour);
   Serial.printf("Auto-logging: %s, Threshold=%.1fW, Debounce=%us\n",
                 autoLogEnabled ? "ON" : "OFF", autoLogThreshold, autoLogDebounce);
-  Serial.printf("Log interval: %us (max duration: ~%u minutes)\n",
-                logIntervalSeconds, (MAX_LOG_ENTRIES * logIntervalSeconds) / 60);
+  Serial.printf("Log interval: %us (full resolution: ~%u minutes, history: ~%u minutes)\n",
+                logIntervalSeconds, powerLogSampleMinutes(logIntervalSeconds),
+                powerLogHistoryMinutes(logIntervalSeconds));
 }
 
 /**
- * @brief Save tariff settings to NVS
+ * @brief Save tariff settings and the schedule to NVS
  */
 void saveTariffSettings() {
   Preferences prefs;
   prefs.begin("coreone", false);
-  prefs.putFloat("tariff_high", tariffHigh);
-  prefs.putFloat("tariff_low", tariffLow);
+  prefs.putFloat("tariff_high", tariffSchedule.prices[TARIFF_BAND_HIGH]);  // Kept for older firmware
+  prefs.putFloat("tariff_low", tariffSchedule.prices[TARIFF_BAND_LOW]);
   prefs.putString("currency", currency);
   prefs.putInt("tariff_start", tariffSwitchHour);
   prefs.putInt("tariff_end", tariffSwitchEndHour);
   prefs.end();
+  tariffSave();  // Recompiles the slot table, band boundaries follow from now on
+  configGeneration++;
   
   Serial.println("Tariff settings saved");
 }
 
 /**
- * @brief Send HTTP GET request to relay device
- * @param url Complete URL string to fetch
- * @note Only sends if WiFi is connected, logs HTTP response code to Serial
+ * @brief Send relay OFF command
+ * @param relayId Relay slot, defaults to the printer relay
+ * @note Coalesced, retried and verified by the RelayCommand pipeline
  */
-void sendGet(const String& url) {
-  if (WiFi.status() != WL_CONNECTED) return;
-  HTTPClient http;
-  http.begin(url);
-  http.setTimeout(300); // 300ms timeout - fail fast
-  http.setConnectTimeout(300); // Also set connection timeout
-  int code = http.GET();
-  Serial.printf("GET %s -> HTTP %d\n", url.c_str(), code);
-  http.end();
+void sendOff(uint8_t relayId) {
+  if (!relayConfigured(relayId)) return;
+  relayCommandRequest(relayId, RelayTargetOff, relays[relayId].reportValid, relays[relayId].relay);
 }
 
 /**
- * @brief Send relay OFF command
+ * @brief Send relay ON command
  */
-void sendOff()    { sendGet(getUrlOff());    }
+void sendOn(uint8_t relayId) {
+  if (!relayConfigured(relayId)) return;
+  relayCommandRequest(relayId, RelayTargetOn, relays[relayId].reportValid, relays[relayId].relay);
+}
 
 /**
- * @brief Send relay ON command
+ * @brief Send relay toggle command
  */
-void sendOn()     { sendGet(getUrlOn());     }
+void sendToggle(uint8_t relayId) {
+  if (!relayConfigured(relayId)) return;
+  relayCommandRequest(relayId, RelayTargetToggle, relays[relayId].reportValid, relays[relayId].relay);
+}
 
 /**
- * @brief Send relay toggle command
+ * @brief Stop the printer auto-off countdown and disarm all auxiliary relays
+ * @note Used when the print resumes or auto mode / relay state is changed by hand
  */
-void sendToggle() { sendGet(getUrlToggle()); }
+void cancelOffTimer() {
+  offTimerRunning = false;
+  for (RelayState& r : relays) {
+    r.offArmed = false;
+  }
+}
 
 /**
  * @brief Ensure WiFi connection is active, reconnect if needed
@@ -264,59 +207,92 @@ void ensureWifi() {
 }
 
 /**
- * @brief Poll relay device for status report via HTTP GET
- * @note Fetches JSON from /report endpoint, updates global report* variables
- * @note Sets reportValid to false on connection or parsing errors
+ * @brief Request a relay status report from the relay's worker task
+ * @param relayId Relay slot
+ * @note Non-blocking, the result is applied by handleRelayResults()
+ * @note Only one report request per relay is in flight at a time
  */
-void updateReportStatus() {
+void updateReportStatus(uint8_t relayId) {
+  if (!relayConfigured(relayId)) return;
+  RelayState& r = relays[relayId];
   if (WiFi.status() != WL_CONNECTED) {
-    reportValid = false;
+    r.reportValid = false;
     return;
   }
+  if (r.reportPending) return;
 
-  HTTPClient http;
-  http.begin(getUrlReport());
-  http.setTimeout(300); // 300ms timeout - fail fast if unreachable
-  http.setConnectTimeout(300); // Also set connection timeout
-  int code = http.GET();
-  if (code != 200) {
-    consecutiveErrors++;
+  r.lastPollMs    = millis();
+  r.reportPending = relayClientSubmit(relayId, r.driver, RelayReqReport, r.ip);
+}
+
+/**
+ * @brief Drain completed relay requests and apply them to global state
+ * @note Call every loop() iteration
+ */
+void handleRelayResults() {
+  RelayResult result;
+  while (relayClientPoll(result)) {
+    if (result.relayId >= MAX_RELAYS) continue;
+    RelayState& r = relays[result.relayId];
+
+    if (result.type == RelayReqReport) {
+      // A late result of an expired request does not end the one in flight
+      if ((int32_t)(result.submitMs - r.lastPollMs) >= 0) r.reportPending = false;
+      applyReport(result);
+      relayCommandOnReport(result.relayId, result.submitMs, r.reportValid, r.relay);
+
+      // The printer relay is busy while its timer runs or logging is active,
+      // auxiliary relays while their auto-off is armed
+      bool busy = (result.relayId == PRIMARY_RELAY) ? (offTimerRunning || loggingEnabled) : r.offArmed;
+      r.pollIntervalMs = pollSchedulerNext(result.relayId, r.reportValid, r.consecutiveErrors,
+                                           busy, r.relay, r.power);
+    } else {
+      relayCommandOnResult(result);
+    }
+  }
+}
+
+/**
+ * @brief Update a relay table entry from a report result
+ * @param result Completed report request
+ * @note Sets reportValid to false on connection or parsing errors
+ */
+void applyReport(const RelayResult& result) {
+  RelayState& relay = relays[result.relayId];
+
+  if (result.httpCode != 200) {
+    relay.consecutiveErrors++;
     // Only log first error and every 10th error to reduce spam
-    if (consecutiveErrors == 1 || consecutiveErrors % 10 == 0) {
-      Serial.printf("REPORT GET -> HTTP %d (errors: %d)\n", code, consecutiveErrors);
+    if (relay.consecutiveErrors == 1 || relay.consecutiveErrors % 10 == 0) {
+      Serial.printf("REPORT %u GET -> HTTP %d (errors: %d)\n",
+                    result.relayId, result.httpCode, relay.consecutiveErrors);
     }
-    http.end();
-    reportValid = false;
+    relay.reportValid = false;
     return;
   }
 
-  String payload = http.getString();
-  http.end();
-
-  JsonDocument doc;
-  DeserializationError err = deserializeJson(doc, payload);
-  if (err) {
-    consecutiveErrors++;
-    Serial.print("REPORT JSON parse failed: ");
-    Serial.println(err.c_str());
-    reportValid = false;
+  if (!result.ok) {
+    relay.consecutiveErrors++;
+    Serial.printf("REPORT %u JSON parse failed: %s\n", result.relayId, result.error);
+    relay.reportValid = false;
     return;
   }
 
-  reportPower       = doc["power"] | 0.0f;
-  reportWs          = doc["Ws"] | 0.0f;
-  reportRelay       = doc["relay"] | false;
-  reportTemperature = doc["temperature"] | 0.0f;
-  reportBootId      = doc["boot_id"] | "";
-  reportEnergyBoot  = doc["energy_since_boot"] | 0.0f;
-  reportTimeBoot    = doc["time_since_boot"] | 0;
-
-  reportValid       = true;
-  consecutiveErrors = 0; // Reset on success
-  Serial.println("REPORT updated");
+  const RelayReport& r = result.report;
+  relay.power       = r.power;
+  relay.ws          = r.ws;
+  relay.relay       = r.relay;
+  relay.temperature = r.temperature;
+  relay.bootId      = r.bootId;
+  relay.energyBoot  = r.energyBoot;
+  relay.timeBoot    = r.timeBoot;
+
+  relay.reportValid       = true;
+  relay.consecutiveErrors = 0; // Reset on success
+  Serial.printf("REPORT %u updated\n", result.relayId);
   
-  // Log power data if logging is active
-  if (loggingEnabled) {
+  // Log printer power data if logging is active
+  if (loggingEnabled && result.relayId == PRIMARY_RELAY) {
     logPowerData();
   }
 }
@@ -329,11 +305,14 @@ void startLogging() {
   
   loggingEnabled = true;
   loggingStartMs = millis();
-  energyStartWs = reportEnergyBoot;  // Use current energy as baseline [Ws]
-  powerLogCount = 0;
-  powerLogIndex = 0;
+  energyStartWs = relays[PRIMARY_RELAY].energyBoot;  // Use current energy as baseline [Ws]
+  powerLogClear();
   lastLogMs = 0;
+  logInterval.reset();
+  costMeter.reset(0, time(nullptr));
   manualStopOverride = false;  // Clear override when manually starting
+  logWalStart((uint32_t)time(nullptr), logIntervalSeconds,
+              tariffSchedule.prices[TARIFF_BAND_HIGH], tariffSchedule.prices[TARIFF_BAND_LOW]);
   
   Serial.println("Power logging STARTED");
 }
@@ -347,25 +326,22 @@ void stopLogging() {
   loggingEnabled = false;
   manualStopOverride = true;  // Set override to prevent auto-restart
   
-  // Auto-save log to SPIFFS
-  String filename = saveLogToFile();
-  if (filename.length() > 0) {
-    Serial.printf("Power logging STOPPED (manual) - Saved to %s\n", filename.c_str());
-  } else {
-    Serial.println("Power logging STOPPED (manual) - No data to save");
-  }
+  // The session WAL is converted to a CSV file in the background
+  logWalStop();
+  Serial.println("Power logging STOPPED (manual)");
 }
 
 /**
  * @brief Check auto-logging conditions and start/stop as needed
  */
 void checkAutoLogging() {
-  if (!autoLogEnabled || !reportValid) return;
+  const RelayState& printer = relays[PRIMARY_RELAY];
+  if (!autoLogEnabled || !printer.reportValid) return;
   
   const uint32_t now = millis();
   const uint32_t debounceMs = autoLogDebounce * 1000UL;
   
-  if (reportPower > autoLogThreshold) {
+  if (printer.power > autoLogThreshold) {
     // Power is above threshold
     autoLogBelowMs = 0;  // Reset below counter
     
@@ -375,7 +351,7 @@ void checkAutoLogging() {
       // Power has been above threshold for debounce time - start logging
       // But only if user hasn't manually stopped it
       Serial.printf("Auto-logging START: Power %.1fW > %.1fW for %us\n", 
-                    reportPower, autoLogThreshold, autoLogDebounce);
+                    printer.power, autoLogThreshold, autoLogDebounce);
       startLogging();
       autoLogAboveMs = 0;  // Reset for next cycle
     }
@@ -391,14 +367,11 @@ void checkAutoLogging() {
       } else if (now - autoLogBelowMs >= debounceMs) {
         // Power has been below threshold for debounce time - stop logging
         Serial.printf("Auto-logging STOP: Power %.1fW <= %.1fW for %us\n",
-                      reportPower, autoLogThreshold, autoLogDebounce);
+                      printer.power, autoLogThreshold, autoLogDebounce);
         loggingEnabled = false;  // Stop directly without setting override
         
-        // Auto-save log to SPIFFS
-        String filename = saveLogToFile();
-        if (filename.length() > 0) {
-          Serial.printf("Auto-save to %s\n", filename.c_str());
-        }
+        // Auto-save, the session WAL is converted to a CSV file in the background
+        logWalStop();
         
         autoLogBelowMs = 0;  // Reset for next cycle
       }
@@ -410,15 +383,17 @@ void checkAutoLogging() {
  * @brief Clear all logged data
  */
 void clearLog() {
-  powerLogCount = 0;
-  powerLogIndex = 0;
+  powerLogClear();
   loggingStartMs = 0;
   lastLogMs = 0;
+  logInterval.reset();
   Serial.println("Power log CLEARED");
 }
 
 /**
- * @brief Save current log to SPIFFS as CSV file
+ * @brief Save current log to SPIFFS as binary log file (see LogFile.h)
+ * @note Snapshot of the in-RAM log for /api/files/save, a finished session is
+ *       saved from its WAL (see LogWal.h)
  * @return Filename of saved log, or empty string on error
  */
 String saveLogToFile() {
@@ -427,25 +402,27 @@ String saveLogToFile() {
     return "";
   }
 
-  // Estimate file size: header + data rows
-  // Each row: ~40 bytes (timestamp,power,energy,cost\n)
-  size_t estimatedSize = 100 + (powerLogCount * 40);
+  PowerLogRange range = powerLogRange();
+  size_t requiredSize = LOG_FILE_HEADER_SIZE + range.total() * sizeof(LogFileRecord);
   
-  // Ensure sufficient space, auto-cleanup if needed
-  if (!ensureSpaceForLog(estimatedSize)) {
+  // Ensure sufficient space and an index slot, auto-cleanup if needed
+  if (logIndexCount() >= LOG_INDEX_MAX) {
+    cleanupOldestLog();
+  }
+  if (!ensureSpaceForLog(requiredSize)) {
     Serial.println("Insufficient space for log file!");
     return "";
   }
 
+  PowerLogEntry last;
+  powerLogLast(last);
+  uint32_t durationS = last.timestamp / 1000;
+
   // Generate filename with timestamp
   time_t now;
   time(&now);
-  struct tm timeinfo;
-  localtime_r(&now, &timeinfo);
-  char filename[64];
-  snprintf(filename, sizeof(filename), "/log_%04d%02d%02d_%02d%02d%02d.csv",
-           timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
-           timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+  char filename[LOG_INDEX_NAME_MAX];
+  logFileName(filename, sizeof(filename), now);
 
   File file = SPIFFS.open(filename, FILE_WRITE);
   if (!file) {
@@ -453,23 +430,38 @@ String saveLogToFile() {
     return "";
   }
 
-  // Write CSV header
-  file.println("Time(s),Power(W),Energy(Wh),Cost");
-
-  // Write data points
-  size_t startIdx = (powerLogCount < MAX_LOG_ENTRIES) ? 0 : powerLogIndex;
-  for (size_t i = 0; i < powerLogCount; i++) {
-    size_t idx = (startIdx + i) % MAX_LOG_ENTRIES;
-    PowerLogEntry& entry = powerLog[idx];
-    file.printf("%u,%.2f,%.4f,%.6f\n",
-                entry.timestamp / 1000,  // Convert ms to seconds
-                entry.power,
-                entry.energy,
-                entry.cost);
+  // Header with the current prices for reference, records carry their cost
+  LogFileHeader header;
+  logFileInitHeader(header, (uint32_t)now - durationS, logIntervalSeconds,
+                    tariffSchedule.prices[TARIFF_BAND_HIGH], tariffSchedule.prices[TARIFF_BAND_LOW]);
+  size_t written = file.write((const uint8_t*)&header, sizeof(header));
+
+  // Write data points in batches
+  PowerLogReader reader(range);
+  PowerLogEntry entry;
+  LogFileRecord batch[16];
+  size_t n = 0;
+  while (reader.next(entry)) {
+    logFileEncode(batch[n++], entry.timestamp, entry.power, entry.minPower, entry.maxPower,
+                  entry.energy, entry.cost, entry.lowTariff);
+    if (n == 16) {
+      written += file.write((const uint8_t*)batch, sizeof(batch));
+      n = 0;
+    }
   }
+  written += file.write((const uint8_t*)batch, n * sizeof(LogFileRecord));
 
   file.close();
-  Serial.printf("Log saved to %s (%u entries)\n", filename, powerLogCount);
+
+  LogFileInfo info = {};
+  strlcpy(info.name, filename, sizeof(info.name));
+  info.size = written;
+  info.durationS = durationS;
+  info.startTime = (uint32_t)now - info.durationS;
+  info.energyWh = last.energy;
+  info.cost = last.cost;
+  logIndexAdd(info);
+  Serial.printf("Log saved to %s (%u entries)\n", filename, range.total());
   return String(filename);
 }
 
@@ -485,6 +477,7 @@ bool deleteLogFile(const String& filename) {
   }
   
   if (SPIFFS.remove(filename)) {
+    logIndexRemove(filename.c_str());
     Serial.printf("Deleted: %s\n", filename.c_str());
     return true;
   }
@@ -497,27 +490,13 @@ bool deleteLogFile(const String& filename) {
  * @brief Delete oldest log file to free up space
  */
 void cleanupOldestLog() {
-  File root = SPIFFS.open("/");
-  File oldestFile;
-  time_t oldestTime = LONG_MAX;
-  String oldestFilename;
-  
-  File file = root.openNextFile();
-  while (file) {
-    String filename = String(file.name());
-    if (filename.startsWith("/log_") && filename.endsWith(".csv")) {
-      time_t fileTime = file.getLastWrite();
-      if (fileTime < oldestTime) {
-        oldestTime = fileTime;
-        oldestFilename = filename;
-      }
-    }
-    file = root.openNextFile();
-  }
-  
-  if (oldestFilename.length() > 0) {
-    Serial.printf("Auto-cleanup: Deleting oldest log %s\n", oldestFilename.c_str());
-    deleteLogFile(oldestFilename);
+  const LogFileInfo* oldest = logIndexOldest();
+  if (!oldest) return;
+
+  String oldestFilename = oldest->name;
+  Serial.printf("Auto-cleanup: Deleting oldest log %s\n", oldestFilename.c_str());
+  if (!deleteLogFile(oldestFilename)) {
+    logIndexRemove(oldestFilename.c_str());  // Stale entry, file is already gone
   }
 }
 
@@ -541,8 +520,8 @@ bool ensureSpaceForLog(size_t requiredBytes) {
     cleanupOldestLog();
     freeBytes = SPIFFS.totalBytes() - SPIFFS.usedBytes();
     
-    // If no space was freed, we've deleted all logs
-    if (freeBytes == beforeCleanup) {
+    // Stop once every indexed log is deleted and nothing was freed
+    if (freeBytes == beforeCleanup && logIndexCount() == 0) {
       Serial.println("No more logs to delete!");
       return freeBytes >= requiredBytes;
     }
@@ -552,36 +531,37 @@ bool ensureSpaceForLog(size_t requiredBytes) {
 }
 
 /**
- * @brief Log current power data to circular buffer
+ * @brief Aggregate the current power report, log one entry per log interval
+ * @note Called for every printer relay report while logging, the entry holds
+ *       the average, minimum and maximum power of all polls in the interval
  */
 void logPowerData() {
-  if (!loggingEnabled || !reportValid) return;
+  const RelayState& printer = relays[PRIMARY_RELAY];
+  if (!loggingEnabled || !printer.reportValid) return;
   
+  logInterval.add(printer.power);
+
   uint32_t now = millis();
   uint32_t intervalMs = logIntervalSeconds * 1000;
   if (now - lastLogMs < intervalMs) return;  // Throttle logging
   
   lastLogMs = now;
   
-  PowerLogEntry& entry = powerLog[powerLogIndex];
-  entry.timestamp = now - loggingStartMs;  // Relative to logging start
-  entry.power = reportPower;
-  float energyWs = reportEnergyBoot - energyStartWs;  // Energy in Ws since logging started
-  entry.energy = energyWs / 3600.0f;  // Convert Ws to Wh
-  
-  // Calculate cost: energy in Wh converted to kWh, multiplied by current tariff
-  float currentTariff = getCurrentTariff();
-  entry.cost = (entry.energy / 1000.0f) * currentTariff;  // Wh to kWh
+  float energyWh = (printer.energyBoot - energyStartWs) / 3600.0;  // Energy since logging started, Ws to Wh
+  uint32_t timestamp = now - loggingStartMs;  // Relative to logging start
+  float cost = costMeter.add(energyWh, time(nullptr));  // Energy delta at the band(s) it was used in
+  bool lowTariff = costMeter.lowTariff();
   
-  powerLogIndex = (powerLogIndex + 1) % MAX_LOG_ENTRIES;
-  if (powerLogCount < MAX_LOG_ENTRIES) {
-    powerLogCount++;
-  }
+  powerLogPush(timestamp, logInterval.avg(), logInterval.minPower, logInterval.maxPower,
+               energyWh, cost, lowTariff);
+  logWalAppend(timestamp, logInterval.avg(), logInterval.minPower, logInterval.maxPower,
+               energyWh, cost, lowTariff);
+  logInterval.reset();
 }
 
 /**
  * @brief Arduino setup - initialize hardware, load settings, connect WiFi
- * @note Loads offDelayMs and relayIpAddress from NVS preferences
+ * @note Loads offDelayMs and the relay table from NVS preferences
  * @note Configures GPIO pins with pullups, starts web server
  */
 void setup() {
@@ -594,20 +574,21 @@ void setup() {
     Serial.println("SPIFFS mount failed!");
   } else {
     Serial.println("SPIFFS mounted successfully");
+    logIndexBegin();
   }
 
   prefs.begin("coreone", false);  // Namespace
   offDelayMs = prefs.getUInt("off_delay_ms", offDelayMs); // Load from NVS, use default if not set
- relayIpAddress = prefs.getString("relay_ip", "relayIpAddress"); // Load relay IP
-//  relayIpAddress = "192.168.188.44";// prefs.getString("relay_ip", "relayIpAddress"); // Load relay IP
-
   prefs.end();
 
   Serial.println("Load offDelayMs: " + String(offDelayMs));
-  Serial.println("Load relayIpAddress: " + relayIpAddress);
+  powerLogBegin();
+  configGeneration = esp_random();  // ETags cached before a reboot never match
+  loadRelayConfig();
 
   // Load tariff settings
   loadTariffSettings();
+  loadPollPolicy();
   
   // Configure NTP for time-based tariff switching
   configTime(3600, 3600, "pool.ntp.org", "time.nist.gov");  // GMT+1 with DST
@@ -653,19 +634,23 @@ void setup() {
   autoPowerOffEnabled = false;
   showAutoOffDisabled();
 
+  if (!relayClientBegin()) {
+    Serial.println("Relay client failed to start!");
+  }
+
+  stateMutex = xSemaphoreCreateMutex();
+  logWalBegin();  // Saves a session cut off by a reset
   startWebServer();
 }
 
 /**
- * @brief Main loop - handle web requests, button input, timer logic, LED updates
- * @note Polls relay status every 5 seconds
+ * @brief Main loop - button input, timer logic, LED updates, live status push
+ * @note Web requests are served on the AsyncTCP task, the control logic runs with StateLock held
+ * @note Polls every configured relay at its PollScheduler interval, relay HTTP runs on the relay worker tasks
  * @note Updates LED matrix based on timer state and progress
  * @note Monitors INPUT_PIN for signal changes to trigger auto-off timer
  */
 void loop() {
-  // Handle web requests first - highest priority for responsiveness
-  server.handleClient();
-
   // Check for serial commands
   if (Serial.available() > 0) {
     String cmd = Serial.readStringUntil('\n');
@@ -684,21 +669,50 @@ void loop() {
     }
   }
 
-  uint32_t now = millis();
-
   // Only check WiFi periodically, not every loop iteration
+  // Runs without the state lock, a reconnect blocks for up to 10 s
   static uint32_t lastWifiCheck = 0;
-  if (now - lastWifiCheck >= 30000) {  // Check every 30 seconds
-    lastWifiCheck = now;
+  if (millis() - lastWifiCheck >= 30000) {  // Check every 30 seconds
+    lastWifiCheck = millis();
     ensureWifi();
   }
 
-  // Poll relay status - use longer interval if errors occurring
-  uint32_t pollInterval = (consecutiveErrors > 3) ? REPORT_POLL_INTERVAL_ERROR_MS : REPORT_POLL_INTERVAL_MS;
-  if (now - lastReportPollMs >= pollInterval) {
-    lastReportPollMs = now;
-    updateReportStatus();
+  if (wifiResetRequested) {
+    Serial.println("Resetting WiFi settings and restarting...");
+    delay(500);  // Let the web response go out
+    wifiManager.resetSettings();
+    logWalSync(2000);
+    delay(1000);
+    ESP.restart();
+  }
+
+  // Web handlers wait here until the control logic below is done
+  xSemaphoreTake(stateMutex, portMAX_DELAY);
+  uint32_t now = millis();
+  statusEventsLoop(now);
+  logWalLoop(now);
+
+  // Poll relay status - interval adapts to activity and backs off on errors,
+  // pending relay commands request an immediate verification report.
+  // Each relay has its own worker, so the polls run concurrently.
+  for (uint8_t id = 0; id < MAX_RELAYS; id++) {
+    if (!relayConfigured(id)) continue;
+    RelayState& r = relays[id];
+    if (r.reportPending && now - r.lastPollMs >= RELAY_REPORT_TIMEOUT_MS) {
+      // Result dropped by the worker (result queue full while loop() stalled)
+      Serial.printf("REPORT %u result lost, polling again\n", id);
+      r.reportPending = false;
+    }
+    if (!r.reportPending &&
+        (relayCommandWantsReport(id, now) || now - r.lastPollMs >= r.pollIntervalMs)) {
+      r.lastPollMs = now;
+      updateReportStatus(id);
+    }
+    relayCommandUpdate(id, now, r.ip, r.driver);
   }
+  handleRelayResults();
+
+  const RelayState& printer = relays[PRIMARY_RELAY];
   
   // Check auto-logging conditions
   checkAutoLogging();
@@ -706,19 +720,19 @@ void loop() {
   ModeClickEvent evt = chkModeButton();
   if (evt == ModeSingleClick) {
     Serial.println("Mode SINGLE-CLICK -> toggle auto mode");
-    offTimerRunning = false;
+    cancelOffTimer();
     lastState = digitalRead(INPUT_PIN);
     autoPowerOffEnabled = !autoPowerOffEnabled;
 
     // Update LED display immediately based on mode and relay state
     if (autoPowerOffEnabled) {
-      if (reportValid && !reportRelay) {
+      if (printer.reportValid && !printer.relay) {
         showAutoOffEnabledRed();  // Red X when auto-off enabled and relay is OFF
       } else {
         showAutoOffEnabledBase(); // Blue X when auto-off enabled and relay is ON
       }
     } else {
-      if (reportValid && !reportRelay) {
+      if (printer.reportValid && !printer.relay) {
         showAutoOffDisabledRed(); // Red I when auto-off disabled and relay is OFF
       } else {
         showAutoOffDisabled();    // Green I when auto-off disabled and relay is ON
@@ -726,7 +740,7 @@ void loop() {
     }
   } else if (evt == ModeDoubleClick) {
     Serial.println("Mode DOUBLE-CLICK -> toggle relay");
-    offTimerRunning = false;
+    cancelOffTimer();
     sendToggle();
 
     clearMatrix();
@@ -743,6 +757,9 @@ void loop() {
       M5.dis.drawpix(i, 0xFF00FF);
     }
     wifiManager.resetSettings();
+    // Unstored samples of a running session, the writer needs the state lock to make room
+    xSemaphoreGive(stateMutex);
+    logWalSync(2000);
     delay(2000);
     ESP.restart();
   }
@@ -757,10 +774,14 @@ void loop() {
       if (s == LOW) {
         offTimerRunning = true;
         offTimerStart   = now;
+        // Auxiliary relays count down from the same signal edge with their own delay
+        for (uint8_t id = 1; id < MAX_RELAYS; id++) {
+          relays[id].offArmed = relays[id].autoOff && relayConfigured(id);
+        }
       } else {
-        offTimerRunning = false;
+        cancelOffTimer();
         // Update LED based on relay state when signal goes HIGH
-        if (reportValid && !reportRelay) {
+        if (printer.reportValid && !printer.relay) {
           showAutoOffEnabledRed();  // Red X if relay is OFF
         } else {
           showAutoOffEnabledBase(); // Blue X if relay is ON
@@ -769,7 +790,17 @@ void loop() {
     }
   } else {
     if (offTimerRunning) {
-      offTimerRunning = false;
+      cancelOffTimer();
+    }
+  }
+
+  // Auxiliary relays keep counting after the printer relay has been switched off
+  for (uint8_t id = 1; id < MAX_RELAYS; id++) {
+    RelayState& r = relays[id];
+    if (r.offArmed && now - offTimerStart >= r.offDelayMs) {
+      r.offArmed = false;
+      Serial.printf("Auto-off relay %u (%s)\n", id, r.name.c_str());
+      sendOff(id);
     }
   }
 
@@ -778,9 +809,7 @@ void loop() {
     if (elapsed >= offDelayMs ) {
       offTimerRunning = false;
       sendOff();
-      clearMatrix();
-      M5.dis.fillpix(0x330000);
-      drawI(0xFF0000);
+      showOffPending();
     } else {
       float progress = (float)elapsed / (float)offDelayMs ;
       if (progress < 0.0f) progress = 0.0f;
@@ -795,20 +824,34 @@ void loop() {
     // When timer is not running, update LED based on current relay state
     static bool lastReportRelay = false;
     static bool lastReportValid = false;
+    static RelayCmdState lastCmdState = RelayCmdIdle;
+    RelayCommandStatus cmd;
+    relayCommandGetStatus(PRIMARY_RELAY, cmd);
     
-    // Only update LED if relay state or report validity changed
-    if (reportRelay != lastReportRelay || reportValid != lastReportValid) {
-      lastReportRelay = reportRelay;
-      lastReportValid = reportValid;
+    bool cmdChanged = (cmd.state != lastCmdState);
+    lastCmdState = cmd.state;
+
+    if (cmdChanged && relayCommandOffPending(PRIMARY_RELAY)) {
+      lastReportRelay = printer.relay;
+      lastReportValid = printer.reportValid;
+      showOffPending();           // Orange I while OFF is sent/retried/verified
+    } else if (cmdChanged && cmd.state == RelayCmdConfirmed && !cmd.targetOn) {
+      lastReportRelay = printer.relay;
+      lastReportValid = printer.reportValid;
+      showOffConfirmed();         // Red I once /report confirms OFF
+    } else if (cmdChanged || printer.relay != lastReportRelay || printer.reportValid != lastReportValid) {
+      // Update LED if command state, relay state or report validity changed
+      lastReportRelay = printer.relay;
+      lastReportValid = printer.reportValid;
       
       if (autoPowerOffEnabled) {
-        if (reportValid && !reportRelay) {
+        if (printer.reportValid && !printer.relay) {
           showAutoOffEnabledRed();  // Red X when relay is OFF
         } else {
           showAutoOffEnabledBase(); // Blue X when relay is ON or report invalid
         }
       } else {
-        if (reportValid && !reportRelay) {
+        if (printer.reportValid && !printer.relay) {
           showAutoOffDisabledRed(); // Red I when relay is OFF
         } else {
           showAutoOffDisabled();    // Green I when relay is ON or report invalid
@@ -817,5 +860,6 @@ void loop() {
     }
   }
 
+  xSemaphoreGive(stateMutex);
   delay(5);
 }
@@ -0,0 +1,147 @@
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the Arduino core used by the native unit tests
+ *
+ * Covers only what the modules under test (PowerLog, Tariff, the log files
+ * and WAL, the relay drivers and client) use. String is backed by
+ * std::string, Serial writes to stdout, millis() counts from the first
+ * call. As in the ESP32 core the FreeRTOS queue and task API comes with
+ * it, see freertos/.
+ */
+
+#pragma once
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#if (defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)) || defined(_WIN32)
+inline size_t strlcpy(char* dst, const char* src, size_t cap) {
+  size_t len = strlen(src);
+  if (cap > 0) {
+    size_t n = len < cap - 1 ? len : cap - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+#endif
+
+inline char* ultoa(unsigned long value, char* out, int base) {
+  (void)base;  // Only base 10 is used
+  sprintf(out, "%lu", value);
+  return out;
+}
+
+/**
+ * @brief dtostrf() of the ESP32 core, which String(float, decimals) uses
+ *
+ * Adds half a unit of the last digit and truncates, so exact halves can
+ * come out differently than with printf(): 0.90625 with 4 decimals is
+ * "0.9063" (printf() "0.9062"), 0.09375 is "0.0937" (printf() "0.0938").
+ */
+inline char* dtostrf(double value, signed char width, unsigned char prec, char* out) {
+  if (std::isnan(value)) return strcpy(out, "nan");
+  if (std::isinf(value)) return strcpy(out, "inf");
+
+  char* p = out;
+  int fill = width - (prec > 0 ? prec + 1 : 0);
+  bool negative = value < 0.0;
+  if (negative) {
+    fill--;
+    value = -value;
+  }
+  double rounding = 2.0;
+  for (unsigned i = 0; i < prec; i++) rounding *= 10.0;
+  value += 1.0 / rounding;
+
+  double tenpow = 1.0;
+  int digits = 1;
+  while (value >= 10.0 * tenpow) {
+    tenpow *= 10.0;
+    digits++;
+  }
+  value /= tenpow;
+  fill -= digits;
+  while (fill-- > 0) *p++ = ' ';
+  if (negative) *p++ = '-';
+
+  digits += prec;
+  while (digits-- > 0) {
+    int digit = (int)value;
+    if (digit > 9) digit = 9;
+    *p++ = (char)('0' + digit);
+    if (digits == prec && prec > 0) *p++ = '.';
+    value = (value - digit) * 10.0;
+  }
+  *p = '\0';
+  return out;
+}
+
+template <typename T>
+T constrain(T x, T low, T high) {
+  return x < low ? low : (x > high ? high : x);
+}
+
+inline uint32_t millis() {
+  static const auto start = std::chrono::steady_clock::now();
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+inline void delay(uint32_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline uint32_t esp_random() {
+  return 0x2545F491;  // Fixed, tests must not depend on the start of the sequence
+}
+
+class String {
+ public:
+  String() {}
+  String(const char* text) : s_(text ? text : "") {}
+  String(const char* text, size_t len) : s_(text, len) {}
+  String(float value, unsigned char decimals = 2) {
+    char buf[32];
+    dtostrf(value, decimals + 2, decimals, buf);
+    s_ = buf;
+  }
+
+  const char* c_str() const { return s_.c_str(); }
+  unsigned length() const { return s_.size(); }
+  float toFloat() const { return atof(s_.c_str()); }
+  String& operator+=(const char* text) { s_ += text; return *this; }
+  String& operator+=(const String& text) { s_ += text.s_; return *this; }
+  String& operator+=(char c) { s_ += c; return *this; }
+  bool operator==(const char* text) const { return s_ == text; }
+  bool operator==(const String& text) const { return s_ == text.s_; }
+  friend String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+  friend String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+  friend String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+
+ private:
+  std::string s_;
+};
+
+class HardwareSerial {
+ public:
+  int printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n;
+  }
+  void println(const char* text) { puts(text); }
+};
+
+inline HardwareSerial Serial;
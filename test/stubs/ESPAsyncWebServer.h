@@ -0,0 +1,12 @@
+/**
+ * @file ESPAsyncWebServer.h
+ * @brief Host stand-in for the web server declarations WebUi.h refers to
+ *
+ * Modules under test only take StateLock from WebUi.h, no handler is built.
+ */
+
+#pragma once
+#include <Arduino.h>
+
+class AsyncWebServer;
+class AsyncWebServerRequest;
@@ -0,0 +1,118 @@
+/**
+ * @file FS.h
+ * @brief Host stand-in for the Arduino file system API, files kept in memory
+ *
+ * Covers what the log modules use: open for read, write and append,
+ * sequential read and write, seek, exists, remove and rename. fs::flashFree
+ * limits the bytes writes may add, so a test can fill the flash.
+ */
+
+#pragma once
+#include <Arduino.h>
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet, SeekCur, SeekEnd };
+
+inline std::map<std::string, std::vector<uint8_t>> files;  ///< Path -> content
+inline std::recursive_mutex filesMutex;                   ///< Writer task and test share the files
+inline size_t flashFree = SIZE_MAX;                        ///< Bytes writes may still add
+
+class File {
+ public:
+  File() {}
+  File(const std::string& path, bool append) : path_(new std::string(path)) {
+    if (append) pos_ = files[path].size();
+  }
+
+  explicit operator bool() const { return path_ != nullptr; }
+  const char* name() const { return path_->c_str(); }
+
+  size_t size() const {
+    std::lock_guard<std::recursive_mutex> lock(filesMutex);
+    return files[*path_].size();
+  }
+
+  bool seek(uint32_t pos, SeekMode mode = SeekSet) {
+    if (mode == SeekCur) pos += pos_;
+    if (mode == SeekEnd) pos += size();
+    pos_ = pos;
+    return true;
+  }
+
+  size_t position() const { return pos_; }
+
+  size_t read(uint8_t* out, size_t len) {
+    std::lock_guard<std::recursive_mutex> lock(filesMutex);
+    const std::vector<uint8_t>& data = files[*path_];
+    size_t n = pos_ < data.size() ? std::min(len, data.size() - pos_) : 0;
+    memcpy(out, data.data() + pos_, n);
+    pos_ += n;
+    return n;
+  }
+
+  size_t write(const uint8_t* data, size_t len) {
+    std::lock_guard<std::recursive_mutex> lock(filesMutex);
+    size_t n = len < flashFree ? len : flashFree;
+    if (flashFree != SIZE_MAX) flashFree -= n;
+    std::vector<uint8_t>& content = files[*path_];
+    if (content.size() < pos_ + n) content.resize(pos_ + n);
+    memcpy(content.data() + pos_, data, n);
+    pos_ += n;
+    return n;
+  }
+
+  void close() { path_.reset(); }
+
+ private:
+  std::shared_ptr<std::string> path_;
+  size_t pos_ = 0;
+};
+
+class FS {
+ public:
+  File open(const char* path, const char* mode = FILE_READ) {
+    std::lock_guard<std::recursive_mutex> lock(filesMutex);
+    if (mode[0] == 'r' && !files.count(path)) return File();
+    if (mode[0] == 'w') files[path].clear();
+    else files[path];
+    return File(path, mode[0] == 'a');
+  }
+  File open(const String& path, const char* mode = FILE_READ) { return open(path.c_str(), mode); }
+
+  bool exists(const char* path) {
+    std::lock_guard<std::recursive_mutex> lock(filesMutex);
+    return files.count(path) > 0;
+  }
+
+  bool remove(const char* path) {
+    std::lock_guard<std::recursive_mutex> lock(filesMutex);
+    return files.erase(path) > 0;
+  }
+
+  bool rename(const char* from, const char* to) {
+    std::lock_guard<std::recursive_mutex> lock(filesMutex);
+    auto it = files.find(from);
+    if (it == files.end()) return false;
+    std::vector<uint8_t> content = std::move(it->second);
+    files.erase(it);
+    files[to] = std::move(content);
+    return true;
+  }
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
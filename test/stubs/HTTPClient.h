@@ -0,0 +1,108 @@
+/**
+ * @file HTTPClient.h
+ * @brief Host stand-in for the ESP32 HTTPClient, answered by stand-in relays
+ *
+ * A test registers a StandInRelay per host in standInRelays before the
+ * first request. GET() blocks the calling task like the real client: for
+ * the relay's response delay, for the connect timeout if the host is
+ * unreachable or unknown, and for the read timeout if the relay answers
+ * later than that.
+ */
+
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include <map>
+#include <string>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED       (-4)
+#define HTTPC_ERROR_CONNECTION_LOST     (-5)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+/**
+ * @brief Relay device simulated in-process
+ */
+struct StandInRelay {
+  std::atomic<uint32_t> delayMs{0};       ///< Response time
+  std::atomic<bool>     reachable{true};  ///< false: connect timeout
+  std::string           body;             ///< Body of every response, set before use
+  std::atomic<uint32_t> requests{0};      ///< Requests that reached the relay
+};
+
+inline std::map<std::string, StandInRelay*> standInRelays;  ///< By host
+
+/**
+ * @brief Response body as a stream, read like the socket
+ */
+class HTTPBodyStream {
+ public:
+  void assign(const std::string& body) { body_ = body; pos_ = 0; }
+  int read() { return pos_ < body_.size() ? (uint8_t)body_[pos_++] : -1; }
+  size_t readBytes(char* out, size_t len) {
+    size_t n = body_.size() - pos_ < len ? body_.size() - pos_ : len;
+    memcpy(out, body_.data() + pos_, n);
+    pos_ += n;
+    return n;
+  }
+
+ private:
+  std::string body_;
+  size_t      pos_ = 0;
+};
+
+class HTTPClient {
+ public:
+  void setReuse(bool) {}
+  void setTimeout(uint16_t ms) { timeoutMs_ = ms; }
+  void setConnectTimeout(int32_t ms) { connectTimeoutMs_ = ms; }
+
+  bool begin(WiFiClient& client, const String& url) {
+    client_ = &client;
+    url_    = url.c_str();
+    return true;
+  }
+
+  int GET() {
+    size_t start = url_.find("://") + 3;
+    auto it = standInRelays.find(url_.substr(start, url_.find('/', start) - start));
+    if (it == standInRelays.end() || !it->second->reachable) {
+      client_->stop();
+      delay(connectTimeoutMs_);
+      return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    StandInRelay& relay = *it->second;
+    relay.requests++;
+    if (relay.delayMs > timeoutMs_) {
+      delay(timeoutMs_);
+      return HTTPC_ERROR_READ_TIMEOUT;
+    }
+    delay(relay.delayMs);
+    client_->connected_ = true;  // Keep-alive
+    stream_.assign(relay.body);
+    size_ = relay.body.size();
+    return 200;
+  }
+
+  int getSize() const { return size_; }
+  HTTPBodyStream& getStream() { return stream_; }
+  String getString() {
+    String body;
+    char buf[64];
+    size_t n;
+    while ((n = stream_.readBytes(buf, sizeof(buf))) > 0) body += String(buf, n);
+    return body;
+  }
+  void end() {}
+
+ private:
+  WiFiClient*    client_ = nullptr;
+  std::string    url_;
+  uint32_t       timeoutMs_ = 5000;
+  int32_t        connectTimeoutMs_ = 5000;
+  HTTPBodyStream stream_;
+  int            size_ = -1;
+};
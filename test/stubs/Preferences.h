@@ -0,0 +1,15 @@
+/**
+ * @file Preferences.h
+ * @brief Host stand-in for the ESP32 NVS Preferences, nothing is stored
+ */
+
+#pragma once
+#include <Arduino.h>
+
+class Preferences {
+ public:
+  bool begin(const char*, bool = false) { return true; }
+  void end() {}
+  size_t getBytes(const char*, void*, size_t) { return 0; }
+  size_t putBytes(const char*, const void*, size_t len) { return len; }
+};
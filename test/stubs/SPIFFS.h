@@ -0,0 +1,9 @@
+/**
+ * @file SPIFFS.h
+ * @brief Host stand-in for the SPIFFS instance, see FS.h
+ */
+
+#pragma once
+#include <FS.h>
+
+inline fs::FS SPIFFS;
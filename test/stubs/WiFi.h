@@ -0,0 +1,33 @@
+/**
+ * @file WiFi.h
+ * @brief Host stand-in for the ESP32 WiFi station and client socket
+ */
+
+#pragma once
+#include <Arduino.h>
+
+typedef enum {
+  WL_IDLE_STATUS   = 0,
+  WL_CONNECTED     = 3,
+  WL_DISCONNECTED  = 6
+} wl_status_t;
+
+/**
+ * @brief Socket state only, data is exchanged by the HTTPClient stand-in
+ */
+class WiFiClient {
+ public:
+  bool connected() const { return connected_; }
+  void stop() { connected_ = false; }
+
+  bool connected_ = false;  ///< Set by HTTPClient when a response keeps the socket open
+};
+
+class WiFiClass {
+ public:
+  wl_status_t status() const { return state; }
+
+  wl_status_t state = WL_CONNECTED;
+};
+
+inline WiFiClass WiFi;
@@ -0,0 +1,20 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in for the FreeRTOS types used by the firmware
+ *
+ * One tick is one millisecond. Queues and tasks are in queue.h and task.h,
+ * implemented on the C++ standard library threads.
+ */
+
+#pragma once
+#include <cstdint>
+
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdPASS  pdTRUE
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
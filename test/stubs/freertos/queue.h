@@ -0,0 +1,64 @@
+/**
+ * @file queue.h
+ * @brief Host stand-in for FreeRTOS queues: fixed-size items copied in and out
+ */
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "FreeRTOS.h"
+
+struct QueueDefinition {
+  std::mutex                        mutex;
+  std::condition_variable           changed;
+  std::deque<std::vector<uint8_t>>  items;
+  size_t                            length;
+  size_t                            itemSize;
+};
+typedef QueueDefinition* QueueHandle_t;
+
+/**
+ * @brief Wait until pred() holds, at most ticks (portMAX_DELAY = forever)
+ */
+template <typename Pred>
+bool queueWait(std::unique_lock<std::mutex>& lock, QueueHandle_t q, TickType_t ticks, Pred pred) {
+  if (ticks == portMAX_DELAY) {
+    q->changed.wait(lock, pred);
+    return true;
+  }
+  return q->changed.wait_for(lock, std::chrono::milliseconds(ticks), pred);
+}
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  QueueHandle_t q = new QueueDefinition();  // Never deleted, like the firmware's queues
+  q->length   = length;
+  q->itemSize = itemSize;
+  return q;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(q->mutex);
+  if (!queueWait(lock, q, ticks, [q] { return q->items.size() < q->length; })) return pdFALSE;
+  const uint8_t* bytes = static_cast<const uint8_t*>(item);
+  q->items.emplace_back(bytes, bytes + q->itemSize);
+  q->changed.notify_all();
+  return pdTRUE;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t ticks) {
+  std::unique_lock<std::mutex> lock(q->mutex);
+  if (!queueWait(lock, q, ticks, [q] { return !q->items.empty(); })) return pdFALSE;
+  memcpy(item, q->items.front().data(), q->itemSize);
+  q->items.pop_front();
+  q->changed.notify_all();
+  return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  std::lock_guard<std::mutex> lock(q->mutex);
+  return q->items.size();
+}
@@ -0,0 +1,26 @@
+/**
+ * @file task.h
+ * @brief Host stand-in for FreeRTOS tasks: detached threads
+ *
+ * Core and priority are ignored. Tasks run until the test process exits,
+ * so a test must leave them idle (waiting on a queue) when it ends.
+ */
+
+#pragma once
+#include <chrono>
+#include <thread>
+#include "FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char*, uint32_t, void* arg,
+                                          UBaseType_t, TaskHandle_t* handle, BaseType_t) {
+  std::thread(task, arg).detach();
+  if (handle) *handle = reinterpret_cast<TaskHandle_t>(task);  // Only compared with nullptr
+  return pdPASS;
+}
+
+inline void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
@@ -0,0 +1,187 @@
+/**
+ * @file test_main.cpp
+ * @brief Binary log file layout, reading of older versions and the CSV download
+ *
+ * Files are written to the in-memory SPIFFS stand-in (see FS.h). The CSV is
+ * compared with fixed text: its first four columns are the rows
+ * saveLogToFile() wrote before logs were stored in binary,
+ * "%u,%.2f,%.4f,%.6f" of time, power, energy and cost.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <FS.h>
+#include <SPIFFS.h>
+#include <string>
+#include <vector>
+#include "LogFile.h"
+#include "PowerLog.h"
+
+constexpr uint32_t START_TIME = 1736942400;  ///< 2025-01-15 12:00 UTC
+static const char* const PATH = "/log_20250115_120020.bin";
+
+/**
+ * @brief Samples with rounding at every resolution, the last one in the low tariff
+ */
+static std::vector<LogFileRecord> sampleRecords() {
+  std::vector<LogFileRecord> records(3);
+  logFileEncode(records[0], 10000, 123.45f, 100.0f, 150.06f, 0.3429f, 0.000123f, false);
+  logFileEncode(records[1], 20499, 0.04f, 0.0f, 0.06f, 0.35f, 0.0001249f, false);
+  logFileEncode(records[2], 30000, 2200.0f, 2199.94f, 2300.0f, 12345.678f, 4.321234f, true);
+  return records;
+}
+
+static void writeFile(const void* header, size_t headerSize, const void* records, size_t bytes) {
+  File file = SPIFFS.open(PATH, FILE_WRITE);
+  file.write((const uint8_t*)header, headerSize);
+  file.write((const uint8_t*)records, bytes);
+  file.close();
+}
+
+static void writeLog(const std::vector<LogFileRecord>& records) {
+  LogFileHeader header;
+  logFileInitHeader(header, START_TIME, 10, 0.30f, 0.20f);
+  writeFile(&header, sizeof(header), records.data(), records.size() * sizeof(LogFileRecord));
+}
+
+static std::string csv(size_t chunk) {
+  LogFileCsvWriter writer(SPIFFS.open(PATH, FILE_READ));
+  std::string out;
+  std::vector<uint8_t> buf(chunk);
+  size_t n;
+  while ((n = writer.read(buf.data(), chunk)) > 0) out.append((const char*)buf.data(), n);
+  return out;
+}
+
+void setUp() {
+  fs::files.clear();
+}
+
+void tearDown() {}
+
+static void test_header_and_records_round_trip() {
+  std::vector<LogFileRecord> records = sampleRecords();
+  writeLog(records);
+
+  File file = SPIFFS.open(PATH, FILE_READ);
+  TEST_ASSERT_EQUAL_size_t(LOG_FILE_HEADER_SIZE + 3 * sizeof(LogFileRecord), file.size());
+  LogFileHeader header;
+  TEST_ASSERT_EQUAL_size_t(3, logFileOpen(file, header));
+  TEST_ASSERT_EQUAL_HEX32(LOG_FILE_MAGIC, header.magic);
+  TEST_ASSERT_EQUAL_UINT8(LOG_FILE_VERSION, header.version);
+  TEST_ASSERT_EQUAL_UINT16(LOG_FILE_HEADER_SIZE, header.headerSize);
+  TEST_ASSERT_EQUAL_UINT16(sizeof(LogFileRecord), header.recordSize);
+  TEST_ASSERT_EQUAL_UINT32(START_TIME, header.startTime);
+  TEST_ASSERT_EQUAL_UINT32(10, header.intervalS);
+  TEST_ASSERT_EQUAL_FLOAT(0.30f, header.tariffHigh);
+  TEST_ASSERT_EQUAL_FLOAT(0.20f, header.tariffLow);
+
+  LogFileRecord read[3];
+  TEST_ASSERT_EQUAL_size_t(3, logFileReadRecords(file, header, read, 3));
+  TEST_ASSERT_EQUAL_MEMORY(records.data(), read, sizeof(read));
+
+  // Quantized on encode
+  TEST_ASSERT_EQUAL_UINT16(1235, read[0].power);
+  TEST_ASSERT_EQUAL_UINT16(1501, read[0].maxPower);
+  TEST_ASSERT_EQUAL_UINT32(34, read[0].energy);
+  TEST_ASSERT_EQUAL_UINT32(12, read[0].cost);
+  TEST_ASSERT_EQUAL_UINT8(LOG_FILE_FLAG_LOW_TARIFF, read[2].flags);
+
+  // A start time before NTP sync is not stored
+  logFileInitHeader(header, 3600, 10, 0.30f, 0.20f);
+  TEST_ASSERT_EQUAL_UINT32(0, header.startTime);
+}
+
+static void test_invalid_files_are_rejected() {
+  std::vector<LogFileRecord> records = sampleRecords();
+  LogFileHeader header;
+  logFileInitHeader(header, START_TIME, 10, 0.30f, 0.20f);
+
+  LogFileHeader bad = header;
+  bad.magic = 0;
+  writeFile(&bad, sizeof(bad), records.data(), sizeof(LogFileRecord));
+  File file = SPIFFS.open(PATH, FILE_READ);
+  TEST_ASSERT_EQUAL_size_t(0, logFileOpen(file, header));
+
+  bad = header;
+  bad.recordSize = LOG_FILE_RECORD_SIZE_V2;  // Does not match version 3
+  writeFile(&bad, sizeof(bad), records.data(), sizeof(LogFileRecord));
+  TEST_ASSERT_EQUAL_size_t(0, logFileOpen(file, header));
+  TEST_ASSERT_FALSE(LogFileCsvWriter(SPIFFS.open(PATH, FILE_READ)).valid());
+
+  writeFile(&header, sizeof(header) / 2, nullptr, 0);  // Torn header
+  TEST_ASSERT_EQUAL_size_t(0, logFileOpen(file, header));
+}
+
+static void test_older_versions_are_widened() {
+  std::vector<LogFileRecord> records = sampleRecords();
+  for (uint8_t version : { 1, 2 }) {
+    size_t size = version == 1 ? LOG_FILE_RECORD_SIZE_V1 : LOG_FILE_RECORD_SIZE_V2;
+    LogFileHeader header;
+    logFileInitHeader(header, START_TIME, 10, 0.30f, 0.20f);
+    header.version    = version;
+    header.recordSize = size;
+    std::vector<uint8_t> bytes;
+    for (const LogFileRecord& r : records) bytes.insert(bytes.end(), (const uint8_t*)&r, (const uint8_t*)&r + size);
+    writeFile(&header, sizeof(header), bytes.data(), bytes.size());
+
+    File file = SPIFFS.open(PATH, FILE_READ);
+    TEST_ASSERT_EQUAL_size_t(3, logFileOpen(file, header));
+    LogFileRecord read[3];
+    TEST_ASSERT_EQUAL_size_t(3, logFileReadRecords(file, header, read, 3));
+    for (size_t i = 0; i < 3; i++) {
+      TEST_ASSERT_EQUAL_UINT32(records[i].timestamp, read[i].timestamp);
+      TEST_ASSERT_EQUAL_UINT32(records[i].energy, read[i].energy);
+      TEST_ASSERT_EQUAL_UINT16(records[i].power, read[i].power);
+      TEST_ASSERT_EQUAL_UINT8(records[i].flags, read[i].flags);
+      TEST_ASSERT_EQUAL_UINT16(version == 1 ? records[i].power : records[i].minPower, read[i].minPower);
+      TEST_ASSERT_EQUAL_UINT16(version == 1 ? records[i].power : records[i].maxPower, read[i].maxPower);
+    }
+    // No cost column: the energy at the tariff in the header
+    TEST_ASSERT_EQUAL_UINT32(10, read[0].cost);          // 0.34 Wh at 0.30
+    TEST_ASSERT_EQUAL_UINT32(246914, read[2].cost);      // 12345.68 Wh at 0.20
+  }
+}
+
+static void test_summary_ignores_torn_record() {
+  std::vector<LogFileRecord> records = sampleRecords();
+  LogFileHeader header;
+  logFileInitHeader(header, START_TIME, 10, 0.30f, 0.20f);
+  writeFile(&header, sizeof(header), records.data(), 2 * sizeof(LogFileRecord) + 7);
+
+  File file = SPIFFS.open(PATH, FILE_READ);
+  LogFileInfo info;
+  TEST_ASSERT_TRUE(logFileSummarize(file, PATH, info));
+  TEST_ASSERT_EQUAL_STRING(PATH, info.name);
+  TEST_ASSERT_EQUAL_UINT32(LOG_FILE_HEADER_SIZE + 2 * sizeof(LogFileRecord) + 7, info.size);
+  TEST_ASSERT_EQUAL_UINT32(START_TIME, info.startTime);
+  TEST_ASSERT_EQUAL_UINT32(20, info.durationS);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.35f, info.energyWh);
+  TEST_ASSERT_FLOAT_WITHIN(0.000001f, 0.00012f, info.cost);
+
+  writeFile(&header, sizeof(header), nullptr, 0);  // Header only
+  TEST_ASSERT_FALSE(logFileSummarize(file, PATH, info));
+}
+
+static void test_csv_matches_old_export() {
+  writeLog(sampleRecords());
+  // Line ends are "\n" throughout, the old header line came from println() ("\r\n")
+  const char* expected =
+      "Time(s),Power(W),Energy(Wh),Cost,MinPower(W),MaxPower(W)\n"
+      "10,123.50,0.3400,0.000120,100.00,150.10\n"
+      "20,0.00,0.3500,0.000120,0.00,0.10\n"
+      "30,2200.00,12345.6797,4.321230,2199.90,2300.00\n";
+  for (size_t chunk : { 1, 7, 64, 1460 }) {
+    TEST_ASSERT_EQUAL_STRING(expected, csv(chunk).c_str());
+  }
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_header_and_records_round_trip);
+  RUN_TEST(test_invalid_files_are_rejected);
+  RUN_TEST(test_older_versions_are_widened);
+  RUN_TEST(test_summary_ignores_torn_record);
+  RUN_TEST(test_csv_matches_old_export);
+  return UNITY_END();
+}
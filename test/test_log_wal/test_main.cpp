@@ -0,0 +1,211 @@
+/**
+ * @file test_main.cpp
+ * @brief Session WAL: block batching, boot recovery, parked sessions and dropped samples
+ *
+ * LogWal.cpp is compiled into this test with its writer task running as a
+ * thread on the in-memory SPIFFS stand-in (see FS.h). main.cpp's flash
+ * housekeeping and the log index are replaced by the fakes below, and
+ * time() by a clock the test sets, so a session can start before NTP sync.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <time.h>
+#include <FS.h>
+#include <SPIFFS.h>
+#include <atomic>
+#include <vector>
+#include "LogWal.h"
+#include "LogIndex.h"
+#include "PowerLog.h"
+#include "WebUi.h"
+
+static std::atomic<time_t> clockNow{0};  ///< time() seen by LogWal.cpp, 0 = NTP not synced
+
+static time_t testClock(time_t* out) {
+  time_t now = clockNow;
+  if (out) *out = now;
+  return now;
+}
+
+#define time(out) testClock(out)
+#include "../../src/LogWal.cpp"
+#undef time
+
+constexpr uint32_t START_TIME = 1736942400;  ///< 2025-01-15 12:00 UTC
+constexpr uint32_t WAIT_MS    = 2000;
+
+// main.cpp and LogIndex.cpp stand-ins
+SemaphoreHandle_t stateMutex = xSemaphoreCreateMutex();
+static std::vector<LogFileInfo> indexed;     ///< logIndexAdd() calls, under StateLock
+static std::atomic<bool> flashFull{false};   ///< ensureSpaceForLog() result
+
+void cleanupOldestLog() {}
+bool ensureSpaceForLog(size_t) { return !flashFull; }
+bool logIndexAdd(const LogFileInfo& info) { indexed.push_back(info); return true; }
+uint8_t logIndexCount() { return indexed.size(); }
+
+static size_t indexedCount() {
+  StateLock lock;
+  return indexed.size();
+}
+
+/**
+ * @brief Wait until the writer has added n files to the index
+ */
+static bool waitIndexed(size_t n) {
+  uint32_t start = millis();
+  while (indexedCount() < n) {
+    if (millis() - start >= WAIT_MS) return false;
+    delay(5);
+  }
+  return true;
+}
+
+static size_t fileSize(const char* path) {
+  File file = SPIFFS.open(path, FILE_READ);
+  return file ? file.size() : 0;
+}
+
+static void append(uint32_t first, uint32_t count) {
+  for (uint32_t i = first; i < first + count; i++) {
+    logWalAppend(i * 10000, 100.0f + i, 90.0f, 120.0f + i, i * 0.25f, i * 0.0001f, i % 2 == 1);
+  }
+}
+
+/**
+ * @brief Checks a saved file against the samples append(0, records) wrote
+ */
+static void checkSavedFile(const LogFileInfo& info, uint32_t records, uint32_t startTime) {
+  File file = SPIFFS.open(info.name, FILE_READ);
+  TEST_ASSERT_TRUE((bool)file);
+  LogFileHeader header;
+  TEST_ASSERT_EQUAL_size_t(records, logFileOpen(file, header));
+  TEST_ASSERT_EQUAL_UINT32(startTime, header.startTime);
+
+  LogFileRecord last;
+  file.seek(header.headerSize + (records - 1) * sizeof(LogFileRecord));
+  TEST_ASSERT_EQUAL_size_t(1, logFileReadRecords(file, header, &last, 1));
+  TEST_ASSERT_EQUAL_UINT32((records - 1) * 10000, last.timestamp);
+  TEST_ASSERT_EQUAL_UINT16(powerLogQuantizePower(100.0f + records - 1), last.power);
+  TEST_ASSERT_EQUAL_UINT8((records - 1) % 2 == 1 ? LOG_FILE_FLAG_LOW_TARIFF : 0, last.flags);
+
+  TEST_ASSERT_EQUAL_UINT32((records - 1) * 10, info.durationS);
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, (records - 1) * 0.25f, info.energyWh);
+  TEST_ASSERT_EQUAL_UINT32(info.size, file.size());
+}
+
+void setUp() {
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  clockNow = START_TIME + 3600;
+  flashFull = false;
+  fs::flashFree = SIZE_MAX;
+}
+
+void tearDown() {}
+
+static void test_boot_recovers_interrupted_session() {
+  // A session cut by a reset: 37 records and half of the next one
+  LogFileHeader header;
+  logFileInitHeader(header, START_TIME, 10, 0.30f, 0.20f);
+  std::vector<LogFileRecord> records(38);
+  for (uint32_t i = 0; i < records.size(); i++) {
+    logFileEncode(records[i], i * 10000, 100.0f + i, 90.0f, 120.0f + i, i * 0.25f, i * 0.0001f, i % 2 == 1);
+  }
+  File wal = SPIFFS.open(WAL_PATH, FILE_WRITE);
+  wal.write((const uint8_t*)&header, sizeof(header));
+  wal.write((const uint8_t*)records.data(), 37 * sizeof(LogFileRecord) + sizeof(LogFileRecord) / 2);
+  wal.close();
+
+  logWalBegin();  // Starts the writer for the following tests as well
+  TEST_ASSERT_TRUE(waitIndexed(1));
+  TEST_ASSERT_FALSE(SPIFFS.exists(WAL_PATH));
+
+  // Named after the last whole record
+  char name[LOG_INDEX_NAME_MAX];
+  logFileName(name, sizeof(name), START_TIME + 36 * 10);
+  TEST_ASSERT_EQUAL_STRING(name, indexed[0].name);
+  TEST_ASSERT_EQUAL_UINT32(START_TIME, indexed[0].startTime);
+  checkSavedFile(indexed[0], 37, START_TIME);
+}
+
+static void test_samples_are_written_in_blocks() {
+  logWalStart(START_TIME, 10, 0.30f, 0.20f);
+  append(0, LOG_WAL_BLOCK_RECORDS + 4);
+  delay(100);
+
+  // Only the full block is on flash, the rest waits in RAM
+  TEST_ASSERT_EQUAL_size_t(LOG_FILE_HEADER_SIZE + LOG_WAL_BLOCK_RECORDS * sizeof(LogFileRecord),
+                           fileSize(WAL_PATH));
+  logWalLoop(millis() + LOG_WAL_FLUSH_MS);  // Partial block ages out
+  TEST_ASSERT_TRUE(logWalSync(WAIT_MS));
+  TEST_ASSERT_EQUAL_size_t(LOG_FILE_HEADER_SIZE + (LOG_WAL_BLOCK_RECORDS + 4) * sizeof(LogFileRecord),
+                           fileSize(WAL_PATH));
+
+  append(LOG_WAL_BLOCK_RECORDS + 4, 3 * LOG_WAL_BLOCK_RECORDS);
+  logWalStop();
+  TEST_ASSERT_TRUE(waitIndexed(2));
+  TEST_ASSERT_FALSE(SPIFFS.exists(WAL_PATH));
+  checkSavedFile(indexed[1], 4 * LOG_WAL_BLOCK_RECORDS + 4, START_TIME);
+  TEST_ASSERT_EQUAL_UINT32(0, logWalDropped());
+}
+
+static void test_session_before_clock_sync_is_parked() {
+  clockNow = 0;
+  logWalStart(0, 10, 0.30f, 0.20f);
+  append(0, 20);
+  logWalStop();
+  TEST_ASSERT_TRUE(logWalSync(WAIT_MS));
+  delay(100);
+  TEST_ASSERT_TRUE(SPIFFS.exists("/session_0.wal"));
+  TEST_ASSERT_EQUAL_size_t(2, indexedCount());  // No 1970 name
+
+  // Named once the clock is set, here woken up by the next session
+  clockNow = START_TIME + 7200;
+  logWalStart(START_TIME + 7200, 10, 0.30f, 0.20f);
+  TEST_ASSERT_TRUE(waitIndexed(3));
+  TEST_ASSERT_FALSE(SPIFFS.exists("/session_0.wal"));
+  char name[LOG_INDEX_NAME_MAX];
+  logFileName(name, sizeof(name), START_TIME + 7200 - LOG_WAL_PARKED);
+  TEST_ASSERT_EQUAL_STRING(name, indexed[2].name);
+  TEST_ASSERT_EQUAL_UINT32(START_TIME + 7200 - LOG_WAL_PARKED - 19 * 10, indexed[2].startTime);
+  checkSavedFile(indexed[2], 20, 0);
+}
+
+static void test_writer_drops_are_counted() {
+  // The session started by the previous test is open
+  uint32_t dropped = logWalDropped();
+  flashFull = true;
+  append(0, LOG_WAL_BLOCK_RECORDS);
+  TEST_ASSERT_TRUE(logWalSync(WAIT_MS));
+  TEST_ASSERT_EQUAL_UINT32(dropped + LOG_WAL_BLOCK_RECORDS, logWalDropped());
+
+  // Flash fills up within a block: 5 whole records and a torn one are written
+  flashFull = false;
+  fs::flashFree = 5 * sizeof(LogFileRecord) + 4;
+  append(LOG_WAL_BLOCK_RECORDS, LOG_WAL_BLOCK_RECORDS);
+  TEST_ASSERT_TRUE(logWalSync(WAIT_MS));
+  TEST_ASSERT_EQUAL_UINT32(dropped + 2 * LOG_WAL_BLOCK_RECORDS - 5, logWalDropped());
+
+  // Blocks still queued after the session was closed
+  fs::flashFree = SIZE_MAX;
+  logWalStop();
+  append(0, LOG_WAL_BLOCK_RECORDS);
+  TEST_ASSERT_TRUE(logWalSync(WAIT_MS));
+  TEST_ASSERT_EQUAL_UINT32(dropped + 3 * LOG_WAL_BLOCK_RECORDS - 5, logWalDropped());
+  TEST_ASSERT_TRUE(waitIndexed(4));
+  File file = SPIFFS.open(indexed[3].name, FILE_READ);
+  LogFileHeader header;
+  TEST_ASSERT_EQUAL_size_t(5, logFileOpen(file, header));  // Torn record ignored
+  TEST_ASSERT_EQUAL_UINT32((LOG_WAL_BLOCK_RECORDS + 4) * 10, indexed[3].durationS);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_boot_recovers_interrupted_session);
+  RUN_TEST(test_samples_are_written_in_blocks);
+  RUN_TEST(test_session_before_clock_sync_is_parked);
+  RUN_TEST(test_writer_drops_are_counted);
+  return UNITY_END();
+}
@@ -0,0 +1,367 @@
+/**
+ * @file test_main.cpp
+ * @brief Poll aggregation, rollup tiers and the streamed /api/log_data writers
+ *
+ * PowerLogInterval and the rollups must keep the average, minimum and
+ * maximum of what they consolidate. The JSON format is pinned by a fixed
+ * document in the /api/log_data layout the handler built with String before
+ * the response was streamed (plus the min/max arrays), numbers rounded as
+ * String(v, decimals) rounds them on the ESP32 (see dtostrf() in Arduino.h).
+ * Longer logs are checked against that concatenation and the binary writer
+ * against the documented layout written column by column. Both writers must
+ * give the same bytes for any chunk size the TCP stack asks for. The size
+ * and encode time of both formats for a full log are printed when the tests
+ * run.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "PowerLog.h"
+
+static const size_t CHUNK_SIZES[] = { 1, 3, 7, 64, 536, 1460, 8192 };
+
+/**
+ * @brief Sample pattern with tariff changes, a cost jump (anchor record) and a gap
+ */
+static void fillLog(size_t samples) {
+  uint32_t timestamp = 0;
+  float energy = 0, cost = 0;
+  for (size_t i = 0; i < samples; i++) {
+    timestamp += i == samples / 2 ? 3 * 3600000 : 10000;  // 3 h pause once
+    float power = 50.0f + (i * 37) % 200 + 0.05f * (i % 7);
+    energy += power * 10.0f / 3600.0f;
+    cost   += i == samples / 3 ? 1.5f : power * 10.0f / 3600.0f / 1000.0f * 0.3f;  // Jump > one delta
+    powerLogPush(timestamp, power, power - 10.0f, power + 12.5f, energy, cost, (i / 50) % 2 == 1);
+  }
+}
+
+static std::vector<PowerLogEntry> entries(const PowerLogRange& range) {
+  std::vector<PowerLogEntry> out;
+  PowerLogReader reader(range);
+  PowerLogEntry e;
+  while (reader.next(e)) out.push_back(e);
+  return out;
+}
+
+static std::string number(float value, int decimals) {
+  return String(value, decimals).c_str();
+}
+
+/**
+ * @brief Document as the handler built it before streaming
+ */
+static std::string referenceJson(const PowerLogRange& range, bool cursor) {
+  std::vector<PowerLogEntry> all = entries(range);
+  std::string json = "{";
+  if (cursor) {
+    json += "\"seq\":" + std::to_string(range.seq) + ",\"reset\":" + (range.reset ? "true" : "false") + ",";
+  }
+  json += "\"timestamps\":[";
+  for (size_t i = 0; i < all.size(); i++) json += (i > 0 ? "," : "") + std::to_string(all[i].timestamp);
+  json += "],\"power\":[";
+  for (size_t i = 0; i < all.size(); i++) json += (i > 0 ? "," : "") + number(all[i].power, 2);
+  json += "],\"energy\":[";
+  for (size_t i = 0; i < all.size(); i++) json += (i > 0 ? "," : "") + number(all[i].energy, 3);
+  json += "],\"cost\":[";
+  for (size_t i = 0; i < all.size(); i++) json += (i > 0 ? "," : "") + number(all[i].cost, 4);
+  json += "],\"min\":[";
+  for (size_t i = 0; i < all.size(); i++) json += (i > 0 ? "," : "") + number(all[i].minPower, 2);
+  json += "],\"max\":[";
+  for (size_t i = 0; i < all.size(); i++) json += (i > 0 ? "," : "") + number(all[i].maxPower, 2);
+  json += "]}";
+  return json;
+}
+
+static std::string referenceBinary(const PowerLogRange& range) {
+  std::vector<PowerLogEntry> all = entries(range);
+  std::string bin = "PLOG";
+  uint16_t headerSize = POWER_LOG_BIN_HEADER_SIZE;
+  uint32_t count = all.size();
+  bin += (char)POWER_LOG_BIN_VERSION;
+  bin += (char)(range.reset ? POWER_LOG_BIN_FLAG_RESET : 0);
+  bin.append((const char*)&headerSize, 2);
+  bin.append((const char*)&count, 4);
+  bin.append((const char*)&range.seq, 4);
+  for (const PowerLogEntry& e : all) bin.append((const char*)&e.timestamp, 4);
+  for (const PowerLogEntry& e : all) bin.append((const char*)&e.power, 4);
+  for (const PowerLogEntry& e : all) bin.append((const char*)&e.energy, 4);
+  for (const PowerLogEntry& e : all) bin.append((const char*)&e.cost, 4);
+  for (const PowerLogEntry& e : all) bin.append((const char*)&e.minPower, 4);
+  for (const PowerLogEntry& e : all) bin.append((const char*)&e.maxPower, 4);
+  return bin;
+}
+
+template <typename Writer>
+static std::string drain(Writer& writer, size_t chunk) {
+  std::string out;
+  std::vector<uint8_t> buf(chunk);
+  size_t n;
+  while ((n = writer.read(buf.data(), chunk)) > 0) out.append((const char*)buf.data(), n);
+  return out;
+}
+
+static void checkJson(const PowerLogRange& range, bool cursor) {
+  std::string expected = referenceJson(range, cursor);
+  for (size_t chunk : CHUNK_SIZES) {
+    PowerLogJsonWriter writer(range, cursor);
+    std::string got = drain(writer, chunk);
+    TEST_ASSERT_EQUAL_size_t(expected.size(), got.size());
+    TEST_ASSERT_TRUE(expected == got);
+  }
+}
+
+static void checkBinary(const PowerLogRange& range) {
+  std::string expected = referenceBinary(range);
+  for (size_t chunk : CHUNK_SIZES) {
+    PowerLogBinaryWriter writer(range);
+    TEST_ASSERT_EQUAL_size_t(expected.size(), writer.length());
+    std::string got = drain(writer, chunk);
+    TEST_ASSERT_EQUAL_size_t(expected.size(), got.size());
+    TEST_ASSERT_TRUE(expected == got);
+  }
+}
+
+void setUp() {
+  powerLogClear();
+}
+
+void tearDown() {}
+
+static void test_empty_log() {
+  PowerLogRange range = powerLogRange();
+  TEST_ASSERT_EQUAL_size_t(0, range.total());
+  PowerLogJsonWriter writer(range, false);
+  TEST_ASSERT_EQUAL_STRING("{\"timestamps\":[],\"power\":[],\"energy\":[],\"cost\":[],\"min\":[],\"max\":[]}",
+                           drain(writer, 64).c_str());
+  checkBinary(range);
+}
+
+static void test_json_matches_baseline_format() {
+  // Rounding at every resolution; the costs are halves at 4 decimals, where
+  // String() differs from printf() ("0.0937" and "0.9063" vs "0.0938" and "0.9062")
+  powerLogPush(10000, 123.45f, 100.0f, 150.06f, 0.3429f, 0.09375f, false);
+  powerLogPush(20000, 0.04f, 0.0f, 0.06f, 0.35f, 0.90625f, false);
+  powerLogPush(30000, 2200.0f, 2199.94f, 2300.0f, 12345.678f, 4.321234f, true);
+  const char* expected =
+      "{\"timestamps\":[10000,20000,30000],"
+      "\"power\":[123.50,0.00,2200.00],"
+      "\"energy\":[0.340,0.350,12345.680],"
+      "\"cost\":[0.0937,0.9063,4.3212],"
+      "\"min\":[100.00,0.00,2199.90],"
+      "\"max\":[150.10,0.10,2300.00]}";
+  for (size_t chunk : CHUNK_SIZES) {
+    PowerLogJsonWriter writer(powerLogRange(), false);
+    std::string got = drain(writer, chunk);
+    TEST_ASSERT_EQUAL_STRING(expected, got.c_str());
+  }
+
+  PowerLogJsonWriter writer(powerLogRange(powerLogSeq - 1), true);
+  std::string cursor = "{\"seq\":" + std::to_string(powerLogSeq) + ",\"reset\":false,"
+                       "\"timestamps\":[30000],\"power\":[2200.00],\"energy\":[12345.680],"
+                       "\"cost\":[4.3212],\"min\":[2199.90],\"max\":[2300.00]}";
+  std::string got = drain(writer, 64);
+  TEST_ASSERT_EQUAL_STRING(cursor.c_str(), got.c_str());
+}
+
+static void test_samples_decode_to_pushed_values() {
+  uint32_t timestamp = 0;
+  for (int i = 1; i <= 100; i++) {
+    timestamp += 10000;
+    powerLogPush(timestamp, 12.3f * i, 10.0f, 13.0f * i, 0.25f * i, 0.0125f * i, false);
+  }
+  std::vector<PowerLogEntry> all = entries(powerLogRange());
+  TEST_ASSERT_EQUAL_size_t(100, all.size());
+  for (int i = 1; i <= 100; i++) {
+    const PowerLogEntry& e = all[i - 1];
+    TEST_ASSERT_EQUAL_UINT32(10000u * i, e.timestamp);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 12.3f * i, e.power);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 0.25f * i, e.energy);
+    TEST_ASSERT_FLOAT_WITHIN(0.000005f, 0.0125f * i, e.cost);
+  }
+}
+
+static void test_interval_aggregates_polls() {
+  PowerLogInterval interval;
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, interval.avg());
+  for (float power : { 120.0f, 5.5f, 2300.0f, 80.0f }) interval.add(power);
+  TEST_ASSERT_EQUAL_UINT16(4, interval.count);
+  TEST_ASSERT_EQUAL_FLOAT(626.375f, interval.avg());
+  TEST_ASSERT_EQUAL_FLOAT(5.5f, interval.minPower);
+  TEST_ASSERT_EQUAL_FLOAT(2300.0f, interval.maxPower);
+
+  // After a reset the first poll sets min and max again
+  interval.reset();
+  interval.add(300.0f);
+  TEST_ASSERT_EQUAL_FLOAT(300.0f, interval.avg());
+  TEST_ASSERT_EQUAL_FLOAT(300.0f, interval.minPower);
+  TEST_ASSERT_EQUAL_FLOAT(300.0f, interval.maxPower);
+
+  // The count saturates instead of wrapping to 0
+  for (uint32_t i = 0; i < 70000; i++) interval.add(300.0f);
+  TEST_ASSERT_EQUAL_UINT16(0xFFFF, interval.count);
+}
+
+static void test_rollups_keep_min_avg_max() {
+  // Sample i at i * 10 s: i W average, 0.5 W below and 2 W above it
+  const int samples = 4 * 360;  // 4 h, 1-minute and 10-minute rollups before the samples
+  for (int i = 1; i <= samples; i++) {
+    powerLogPush(i * 10000, i, i - 0.5f, i + 2.0f, i * 0.01f, 0, false);
+  }
+  PowerLogRange range = powerLogRange();
+  TEST_ASSERT_GREATER_THAN(1, range.coarseCount);
+  TEST_ASSERT_GREATER_THAN(1, range.fineCount);
+  std::vector<PowerLogEntry> all = entries(range);
+
+  // 10-minute bucket m holds samples 60m..60m+59, shown at its end
+  const PowerLogEntry& coarse = all[1];
+  uint32_t m = coarse.timestamp / POWER_LOG_COARSE_MS - 1;
+  TEST_ASSERT_EQUAL_UINT32((m + 1) * POWER_LOG_COARSE_MS, coarse.timestamp);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 60 * m + 29.5f, coarse.power);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 60 * m - 0.5f, coarse.minPower);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 60 * m + 61.0f, coarse.maxPower);
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, (60 * m + 59) * 0.01f, coarse.energy);
+
+  // 1-minute bucket k holds samples 6k..6k+5
+  const PowerLogEntry& fine = all[range.coarseCount + 1];
+  uint32_t k = fine.timestamp / POWER_LOG_FINE_MS - 1;
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 6 * k + 2.5f, fine.power);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 6 * k - 0.5f, fine.minPower);
+  TEST_ASSERT_FLOAT_WITHIN(0.05f, 6 * k + 7.0f, fine.maxPower);
+
+  // Then the samples as pushed, in time order throughout
+  const PowerLogEntry& first = all[range.coarseCount + range.fineCount];
+  TEST_ASSERT_EQUAL_FLOAT(first.power - 0.5f, first.minPower);
+  TEST_ASSERT_EQUAL_FLOAT(first.power + 2.0f, first.maxPower);
+  for (size_t i = 1; i < all.size(); i++) TEST_ASSERT_TRUE(all[i - 1].timestamp < all[i].timestamp);
+}
+
+static void test_partial_log_matches_reference() {
+  fillLog(200);
+  checkJson(powerLogRange(), false);
+  checkBinary(powerLogRange());
+}
+
+static void test_wrapped_log_with_rollups_matches_reference() {
+  fillLog(3 * MAX_LOG_ENTRIES);
+  PowerLogRange range = powerLogRange();
+  TEST_ASSERT_GREATER_THAN(0, range.fineCount);
+  TEST_ASSERT_GREATER_THAN(0, range.coarseCount);
+  TEST_ASSERT_EQUAL_size_t(MAX_LOG_ENTRIES, range.count);
+  checkJson(range, false);
+  checkBinary(range);
+}
+
+static void test_binary_against_json_size_and_time() {
+  // Full log as the chart loads it, both encoded in TCP segment sized chunks
+  const int runs = 50;
+  fillLog(3 * MAX_LOG_ENTRIES);
+  PowerLogRange range = powerLogRange();
+  size_t jsonBytes = 0, binBytes = 0;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++) {
+    PowerLogJsonWriter writer(range, false);
+    jsonBytes = drain(writer, 1460).size();
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++) {
+    PowerLogBinaryWriter writer(range);
+    binBytes = drain(writer, 1460).size();
+  }
+  auto t2 = std::chrono::steady_clock::now();
+
+  auto us = [](std::chrono::steady_clock::duration d) {
+    return (unsigned)std::chrono::duration_cast<std::chrono::microseconds>(d).count() / runs;
+  };
+  printf("  %u entries: JSON %u bytes in %u us, binary %u bytes in %u us\n",
+         (unsigned)range.total(), (unsigned)jsonBytes, us(t1 - t0), (unsigned)binBytes, us(t2 - t1));
+  TEST_ASSERT_EQUAL_size_t(POWER_LOG_BIN_HEADER_SIZE + range.total() * 6 * 4, binBytes);
+  TEST_ASSERT_LESS_THAN(jsonBytes, binBytes);
+  TEST_ASSERT_TRUE(t2 - t1 < t1 - t0);  // No number formatting
+}
+
+static void test_history_span_covers_all_tiers() {
+  TEST_ASSERT_EQUAL_UINT32(0, powerLogSpanMs());
+  uint32_t timestamp = 0;
+  for (int i = 0; i < 20 * 360; i++) {  // 20 h at 10 s
+    timestamp += 10000;
+    powerLogPush(timestamp, 100.0f, 90.0f, 110.0f, i * 0.3f, i * 0.0001f, false);
+  }
+  std::vector<PowerLogEntry> all = entries(powerLogRange());
+  TEST_ASSERT_EQUAL_UINT32(all.back().timestamp - all.front().timestamp, powerLogSpanMs());
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32((POWER_LOG_COARSE_ENTRIES - 1) * POWER_LOG_COARSE_MS, powerLogSpanMs());
+  TEST_ASSERT_LESS_OR_EQUAL(POWER_LOG_MAX_ENTRIES, all.size());
+
+  TEST_ASSERT_EQUAL_UINT32(POWER_LOG_COARSE_ENTRIES * 10, powerLogHistoryMinutes(10));
+  TEST_ASSERT_EQUAL_UINT32(MAX_LOG_ENTRIES * 5, powerLogHistoryMinutes(300));
+}
+
+static void test_cursor_ranges_match_reference() {
+  fillLog(3 * MAX_LOG_ENTRIES);
+  // Some new samples, none, and a cursor from before a reboot (reset)
+  const uint32_t cursors[] = { powerLogSeq - 37, powerLogSeq, powerLogSeq + 1000 };
+  for (uint32_t since : cursors) {
+    PowerLogRange range = powerLogRange(since);
+    checkJson(range, true);
+    checkBinary(range);
+  }
+  TEST_ASSERT_EQUAL_size_t(37, powerLogRange(powerLogSeq - 37).count);
+  TEST_ASSERT_TRUE(powerLogRange(powerLogSeq + 1000).reset);
+}
+
+static void test_push_while_streaming_never_shifts_values() {
+  // A log interval passing between two chunks: the document stays exact or
+  // ends early, it never continues with values of other samples
+  for (int pushes : { 1, 40 }) {
+    powerLogClear();
+    fillLog(2 * MAX_LOG_ENTRIES);
+    PowerLogRange range = powerLogRange();
+    std::string expected = referenceJson(range, false);
+    std::string expectedBin = referenceBinary(range);
+
+    PowerLogJsonWriter writer(range, false);
+    PowerLogBinaryWriter binWriter(range);
+    uint8_t buf[256];
+    std::string got, gotBin;
+    size_t n = writer.read(buf, sizeof(buf));
+    got.append((const char*)buf, n);
+    n = binWriter.read(buf, sizeof(buf));
+    gotBin.append((const char*)buf, n);
+
+    PowerLogEntry last;
+    powerLogLast(last);
+    for (int i = 1; i <= pushes; i++) {
+      powerLogPush(last.timestamp + 10000 * i, 99, 98, 100, last.energy + 5.0f * i, last.cost + 0.5f * i, false);
+    }
+    got += drain(writer, sizeof(buf));
+    gotBin += drain(binWriter, sizeof(buf));
+
+    TEST_ASSERT_TRUE(got.size() <= expected.size() && expected.compare(0, got.size(), got) == 0);
+    TEST_ASSERT_TRUE(gotBin.size() <= expectedBin.size() && expectedBin.compare(0, gotBin.size(), gotBin) == 0);
+    if (pushes == 1) {
+      TEST_ASSERT_TRUE(expected == got);  // Overwritten samples were copied at construction
+      TEST_ASSERT_TRUE(expectedBin == gotBin);
+    } else {
+      TEST_ASSERT_LESS_THAN(expected.size(), got.size());
+    }
+  }
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_log);
+  RUN_TEST(test_json_matches_baseline_format);
+  RUN_TEST(test_samples_decode_to_pushed_values);
+  RUN_TEST(test_interval_aggregates_polls);
+  RUN_TEST(test_rollups_keep_min_avg_max);
+  RUN_TEST(test_partial_log_matches_reference);
+  RUN_TEST(test_wrapped_log_with_rollups_matches_reference);
+  RUN_TEST(test_binary_against_json_size_and_time);
+  RUN_TEST(test_history_span_covers_all_tiers);
+  RUN_TEST(test_cursor_ranges_match_reference);
+  RUN_TEST(test_push_while_streaming_never_shifts_values);
+  return UNITY_END();
+}
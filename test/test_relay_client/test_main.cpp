@@ -0,0 +1,208 @@
+/**
+ * @file test_main.cpp
+ * @brief Loop latency of the relay client against slow and unreachable relays
+ *
+ * The relay workers run as threads against stand-in relays (see the
+ * HTTPClient stand-in) that answer after an injected delay or not at all.
+ * A simulated loop() submits reports and drains results at the firmware's
+ * 5 ms cadence; every iteration must stay short no matter how long the
+ * relays take, and a fast relay must not wait behind a slow one.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <chrono>
+#include "RelayClient.h"
+
+constexpr uint32_t LOOP_CADENCE_MS  = 5;     ///< delay() at the end of loop()
+constexpr uint32_t LOOP_BUDGET_US   = 5000;  ///< Longest iteration allowed, excluding the delay
+constexpr const char* REPORT_BODY =
+    "{\"power\":12.34,\"Ws\":12.1,\"relay\":true,\"temperature\":30.5,"
+    "\"boot_id\":\"A1B2C3\",\"energy_since_boot\":123456.7,\"time_since_boot\":3600}";
+
+/**
+ * @brief Results and iteration times seen by the simulated loop
+ */
+struct LoopRun {
+  uint32_t iterations = 0;
+  uint32_t maxIterationUs = 0;
+  uint32_t results[MAX_RELAYS] = {};
+  uint32_t parsed[MAX_RELAYS] = {};
+  uint32_t failed[MAX_RELAYS] = {};
+};
+
+static StandInRelay fastRelay, slowRelay, deadRelay;
+static const char* const HOSTS[MAX_RELAYS] = { "10.0.0.1", "10.0.0.2", "10.0.0.3" };
+
+static uint64_t micros64() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void collect(LoopRun& run, const RelayResult& result, bool pending[]) {
+  pending[result.relayId] = false;
+  run.results[result.relayId]++;
+  if (result.ok) run.parsed[result.relayId]++;
+  if (result.httpCode < 0) run.failed[result.relayId]++;
+}
+
+/**
+ * @brief loop() of the firmware reduced to relay polling: one report in flight per relay
+ */
+static LoopRun runLoop(uint32_t durationMs) {
+  LoopRun run;
+  bool pending[MAX_RELAYS] = {};
+  uint32_t start = millis();
+  while (millis() - start < durationMs) {
+    uint64_t t0 = micros64();
+    for (uint8_t id = 0; id < MAX_RELAYS; id++) {
+      if (!pending[id]) pending[id] = relayClientSubmit(id, RelayDriverMyStrom, RelayReqReport, HOSTS[id]);
+    }
+    RelayResult result;
+    while (relayClientPoll(result)) collect(run, result, pending);
+    uint32_t us = (uint32_t)(micros64() - t0);
+    if (us > run.maxIterationUs) run.maxIterationUs = us;
+    run.iterations++;
+    delay(LOOP_CADENCE_MS);
+  }
+
+  // Let the requests in flight finish, the workers must be idle when the test ends
+  uint32_t settle = millis();
+  while ((pending[0] || pending[1] || pending[2]) && millis() - settle < 2000) {
+    RelayResult result;
+    while (relayClientPoll(result)) collect(run, result, pending);
+    delay(LOOP_CADENCE_MS);
+  }
+  return run;
+}
+
+void setUp() {
+  fastRelay.delayMs   = 5;
+  fastRelay.reachable = true;
+  slowRelay.delayMs   = 250;
+  slowRelay.reachable = true;
+  deadRelay.reachable = false;
+}
+
+void tearDown() {}
+
+static void test_loop_stays_responsive() {
+  LoopRun run = runLoop(2000);
+  printf("  %u iterations, longest %u us; results: fast %u, slow %u, unreachable %u\n",
+         run.iterations, run.maxIterationUs, run.results[0], run.results[1], run.results[2]);
+
+  // A blocking client would spend >= 250 ms per iteration on the slow relay
+  TEST_ASSERT_LESS_THAN_UINT32(LOOP_BUDGET_US, run.maxIterationUs);
+  TEST_ASSERT_GREATER_THAN_UINT32(2000 / (LOOP_CADENCE_MS + 1) / 2, run.iterations);
+
+  // Each relay is served at its own pace
+  TEST_ASSERT_GREATER_THAN_UINT32(50, run.results[0]);
+  TEST_ASSERT_EQUAL_UINT32(run.results[0], run.parsed[0]);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(4, run.results[1]);
+  TEST_ASSERT_EQUAL_UINT32(run.results[1], run.parsed[1]);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(3, run.results[2]);
+  TEST_ASSERT_EQUAL_UINT32(run.results[2], run.failed[2]);
+}
+
+static void test_results_kept_while_loop_stalls() {
+  // More results than the result queue holds, while loop() is blocked
+  // (e.g. ensureWifi()) for less than RELAY_RESULT_WAIT_MS
+  deadRelay.reachable = true;
+  deadRelay.delayMs   = 5;
+  uint32_t submitted = 0;
+  for (uint8_t id = 0; id < MAX_RELAYS; id++) {
+    for (uint8_t n = 0; n < RELAY_REQUEST_QUEUE_LEN; n++) {
+      if (relayClientSubmit(id, RelayDriverMyStrom, RelayReqReport, HOSTS[id])) submitted++;
+    }
+  }
+  TEST_ASSERT_GREATER_THAN_UINT32(RELAY_RESULT_QUEUE_LEN, submitted);
+  delay(RELAY_RESULT_WAIT_MS / 2);
+
+  uint32_t received = 0;
+  uint32_t start = millis();
+  while (received < submitted && millis() - start < 2000) {
+    RelayResult result;
+    while (relayClientPoll(result)) received++;
+    delay(LOOP_CADENCE_MS);
+  }
+  TEST_ASSERT_EQUAL_UINT32(submitted, received);
+}
+
+static void test_submit_never_blocks_on_full_queue() {
+  slowRelay.delayMs = 250;
+  uint32_t accepted = 0;
+  uint64_t t0 = micros64();
+  for (uint8_t n = 0; n < 2 * RELAY_REQUEST_QUEUE_LEN; n++) {
+    if (relayClientSubmit(1, RelayDriverMyStrom, RelayReqReport, HOSTS[1])) accepted++;
+  }
+  uint32_t us = (uint32_t)(micros64() - t0);
+  TEST_ASSERT_LESS_THAN_UINT32(LOOP_BUDGET_US, us);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(RELAY_REQUEST_QUEUE_LEN + 1, accepted);  // + the one being executed
+
+  uint32_t received = 0;
+  uint32_t start = millis();
+  while (received < accepted && millis() - start < 4000) {
+    RelayResult result;
+    while (relayClientPoll(result)) received++;
+    delay(LOOP_CADENCE_MS);
+  }
+  TEST_ASSERT_EQUAL_UINT32(accepted, received);
+}
+
+/**
+ * @brief Submit one request and wait for its result
+ */
+static bool request(uint8_t id, RelayRequestType type, RelayResult& result) {
+  if (!relayClientSubmit(id, RelayDriverMyStrom, type, HOSTS[id])) return false;
+  uint32_t start = millis();
+  while (millis() - start < 3000) {
+    if (relayClientPoll(result)) return true;
+    delay(LOOP_CADENCE_MS);
+  }
+  return false;
+}
+
+static void test_stale_socket_retry_skips_sent_toggle() {
+  // A report leaves a kept-alive socket, then the relay answers too late
+  RelayResult result;
+  TEST_ASSERT_TRUE(request(0, RelayReqReport, result));
+  fastRelay.delayMs = RELAY_HTTP_TIMEOUT_MS + 100;
+  uint32_t before = fastRelay.requests;
+  TEST_ASSERT_TRUE(request(0, RelayReqToggle, result));
+  TEST_ASSERT_EQUAL_INT(HTTPC_ERROR_READ_TIMEOUT, result.httpCode);
+  TEST_ASSERT_EQUAL_UINT32(1, fastRelay.requests - before);  // Reached the relay, not sent again
+
+  // Idempotent requests are repeated on a new socket
+  fastRelay.delayMs = 5;
+  TEST_ASSERT_TRUE(request(0, RelayReqReport, result));
+  fastRelay.delayMs = RELAY_HTTP_TIMEOUT_MS + 100;
+  before = fastRelay.requests;
+  TEST_ASSERT_TRUE(request(0, RelayReqOff, result));
+  TEST_ASSERT_EQUAL_UINT32(2, fastRelay.requests - before);
+
+  // A toggle that could not be sent is repeated
+  fastRelay.delayMs = 5;
+  TEST_ASSERT_TRUE(request(0, RelayReqReport, result));
+  fastRelay.reachable = false;
+  TEST_ASSERT_TRUE(request(0, RelayReqToggle, result));
+  TEST_ASSERT_EQUAL_INT(HTTPC_ERROR_CONNECTION_REFUSED, result.httpCode);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(2 * RELAY_HTTP_TIMEOUT_MS, result.latencyMs);  // Two connect attempts
+}
+
+int main(int, char**) {
+  fastRelay.body = REPORT_BODY;
+  slowRelay.body = REPORT_BODY;
+  deadRelay.body = REPORT_BODY;
+  standInRelays[HOSTS[0]] = &fastRelay;
+  standInRelays[HOSTS[1]] = &slowRelay;
+  standInRelays[HOSTS[2]] = &deadRelay;
+  relayClientBegin();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_loop_stays_responsive);
+  RUN_TEST(test_results_kept_while_loop_stalls);
+  RUN_TEST(test_submit_never_blocks_on_full_queue);
+  RUN_TEST(test_stale_socket_retry_skips_sent_toggle);
+  return UNITY_END();
+}
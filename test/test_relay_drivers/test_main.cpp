@@ -0,0 +1,295 @@
+/**
+ * @file test_main.cpp
+ * @brief Relay driver parsers and the streamed, filtered report parse
+ *
+ * Bodies are fed one character at a time like the HTTP stream, through the
+ * driver's filter into the same static pool the relay workers use. The pool
+ * high-water mark of each driver and the heap use of a parse (none) are
+ * checked against the String and full JsonDocument path polling used
+ * before.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include <new>
+#include "RelayDrivers.h"
+
+static size_t heapAllocs = 0;  ///< operator new calls, String bodies and std containers
+
+void* operator new(size_t size) {
+  heapAllocs++;
+  void* p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+/**
+ * @brief Heap allocator for JsonDocument that counts what it hands out
+ */
+struct CountingHeapAllocator : ArduinoJson::Allocator {
+  size_t calls = 0;
+  size_t bytes = 0;
+
+  void* allocate(size_t size) override {
+    calls++;
+    bytes += size;
+    return malloc(size);
+  }
+  void deallocate(void* ptr) override { free(ptr); }
+  void* reallocate(void* ptr, size_t newSize) override {
+    calls++;
+    bytes += newSize;
+    return realloc(ptr, newSize);
+  }
+};
+
+static const char* const MYSTROM_REPORT =
+    "{\"power\":12.34,\"Ws\":12.1,\"relay\":true,\"temperature\":30.5,"
+    "\"boot_id\":\"A1B2C3\",\"energy_since_boot\":123456.7,\"time_since_boot\":3600}";
+static const char* const SHELLY_GEN2_REPORT =
+    "{\"id\":0,\"source\":\"init\",\"output\":false,\"apower\":8.7,\"voltage\":236.1,"
+    "\"current\":0.045,\"aenergy\":{\"total\":6.532,\"by_minute\":[45.3,47.3,46.1],"
+    "\"minute_ts\":1654511700},\"temperature\":{\"tC\":41.7,\"tF\":117.1}}";
+static const char* const TASMOTA_REPORT =
+    "{\"Status\":{\"Module\":0,\"DeviceName\":\"Printer\",\"Power\":1},"
+    "\"StatusPRM\":{\"Baudrate\":115200,\"StartupUTC\":\"2025-01-01T10:00:00\",\"Sleep\":50},"
+    "\"StatusSTS\":{\"Time\":\"2025-01-01T12:00:00\",\"Uptime\":\"0T02:00:00\",\"UptimeSec\":7200,"
+    "\"POWER\":\"ON\",\"Wifi\":{\"RSSI\":70}},"
+    "\"StatusSNS\":{\"Time\":\"2025-01-01T12:00:00\",\"ENERGY\":{\"Total\":1234.567,\"Yesterday\":1.2,"
+    "\"Today\":0.3,\"Power\":56,\"Voltage\":231},\"ESP32\":{\"Temperature\":45.2}}}";
+
+/**
+ * @brief Reader over a string literal, counts the reads like a socket would see them
+ */
+struct BodyStream {
+  const char* body;
+  size_t pos   = 0;
+  size_t reads = 0;
+
+  explicit BodyStream(const char* text) : body(text) {}
+
+  int read() {
+    reads++;
+    return body[pos] ? (unsigned char)body[pos++] : -1;
+  }
+
+  size_t readBytes(char* out, size_t len) {
+    size_t n = 0;
+    while (n < len && body[pos]) out[n++] = body[pos++];
+    reads += n;
+    return n;
+  }
+};
+
+static StaticPoolAllocator allocator;
+static RelayResult result;
+
+template <typename Driver>
+static bool parse(const char* body) {
+  JsonDocument filter;
+  Driver::initFilter(filter);
+  memset(&result, 0, sizeof(result));
+  BodyStream stream(body);
+  return parseReport<Driver>(allocator, filter, stream, result);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_mystrom_report() {
+  TEST_ASSERT_TRUE(parse<MyStromDriver>(MYSTROM_REPORT));
+  const RelayReport& r = result.report;
+  TEST_ASSERT_TRUE(r.relay);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.34f, r.power);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 12.1f, r.ws);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 30.5f, r.temperature);
+  TEST_ASSERT_EQUAL_STRING("A1B2C3", r.bootId);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 123456.7f, (float)r.energyBoot);
+  TEST_ASSERT_EQUAL_UINT32(3600, r.timeBoot);
+}
+
+/**
+ * @brief Full Shelly Gen1 /status, padded to three times the report pool
+ */
+static String shellyGen1Status() {
+  String body = "{\"wifi_sta\":{\"connected\":true,\"ssid\":\"workshop\",\"ip\":\"192.168.1.50\",\"rssi\":-61},"
+                "\"cloud\":{\"enabled\":false,\"connected\":false},\"mqtt\":{\"connected\":false},"
+                "\"time\":\"12:00\",\"unixtime\":1700000000,\"serial\":42,\"has_update\":false,"
+                "\"mac\":\"AABBCCDDEEFF\",\"cfg_changed_cnt\":3,\"actions_stats\":{\"skipped\":0},"
+                "\"relays\":[{\"ison\":true,\"has_timer\":false,\"timer_started\":0,\"timer_duration\":0,"
+                "\"timer_remaining\":0,\"overpower\":false,\"source\":\"http\"}],"
+                "\"meters\":[{\"power\":45.6,\"overpower\":0.0,\"is_valid\":true,\"timestamp\":1700000000,"
+                "\"counters\":[45.1,44.9,46.0],\"total\":98765}],"
+                "\"temperature\":41.2,\"overtemperature\":false,\"tmp\":{\"tC\":41.2,\"tF\":106.2,\"is_valid\":true},"
+                "\"update\":{\"status\":\"idle\",\"has_update\":false,\"new_version\":\"\",\"old_version\":\"\"},"
+                "\"ram_total\":52064,\"ram_free\":39224,\"fs_size\":233681,\"fs_free\":162648,\"uptime\":7200,\"padding\":\"";
+  while (body.length() < 3 * RELAY_REPORT_POOL_SIZE) body += "0123456789abcdef";
+  body += "\"}";
+  return body;
+}
+
+static void test_shelly_gen1_status_streamed_through_filter() {
+  // Full /status is larger than the report pool, only the filtered fields are kept
+  String body = shellyGen1Status();
+  TEST_ASSERT_TRUE(parse<ShellyGen1Driver>(body.c_str()));
+  const RelayReport& r = result.report;
+  TEST_ASSERT_TRUE(r.relay);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 45.6f, r.power);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 41.2f, r.temperature);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f, 98765.0f * 60.0f, (float)r.energyBoot);  // Watt-minutes -> Ws
+  TEST_ASSERT_EQUAL_UINT32(7200, r.timeBoot);
+  TEST_ASSERT_EQUAL_STRING("", r.bootId);
+}
+
+static void test_shelly_gen2_switch_status() {
+  TEST_ASSERT_TRUE(parse<ShellyGen2Driver>(SHELLY_GEN2_REPORT));
+  const RelayReport& r = result.report;
+  TEST_ASSERT_FALSE(r.relay);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 8.7f, r.power);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 41.7f, r.temperature);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 6.532f * 3600.0f, (float)r.energyBoot);  // Wh -> Ws
+}
+
+static void test_tasmota_status0() {
+  TEST_ASSERT_TRUE(parse<TasmotaDriver>(TASMOTA_REPORT));
+  const RelayReport& r = result.report;
+  TEST_ASSERT_TRUE(r.relay);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 56.0f, r.power);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 45.2f, r.temperature);
+  TEST_ASSERT_EQUAL_UINT32(7200, r.timeBoot);
+  TEST_ASSERT_EQUAL_STRING("2025-01-01T10:00:00", r.bootId);
+}
+
+static void test_lifetime_counters_keep_watt_hour_resolution() {
+  // A large lifetime counter must still resolve the energy of one log interval
+  TEST_ASSERT_TRUE(parse<TasmotaDriver>(
+      "{\"StatusSTS\":{\"POWER\":\"ON\"},\"StatusSNS\":{\"ENERGY\":{\"Total\":12345.678}}}"));
+  double before = result.report.energyBoot;
+  TEST_ASSERT_TRUE(parse<TasmotaDriver>(
+      "{\"StatusSTS\":{\"POWER\":\"ON\"},\"StatusSNS\":{\"ENERGY\":{\"Total\":12345.679}}}"));
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 3600.0f, (float)(result.report.energyBoot - before));  // 1 Wh
+
+  TEST_ASSERT_TRUE(parse<ShellyGen2Driver>("{\"output\":true,\"aenergy\":{\"total\":987654.321}}"));
+  before = result.report.energyBoot;
+  TEST_ASSERT_TRUE(parse<ShellyGen2Driver>("{\"output\":true,\"aenergy\":{\"total\":987654.331}}"));
+  TEST_ASSERT_FLOAT_WITHIN(1.0f, 36.0f, (float)(result.report.energyBoot - before));  // 0.01 Wh
+}
+
+static void test_wrong_driver_is_rejected() {
+  TEST_ASSERT_FALSE(parse<ShellyGen2Driver>("{\"power\":12.3,\"relay\":true}"));
+  TEST_ASSERT_EQUAL_STRING("unexpected status format", result.error);
+  TEST_ASSERT_FALSE(parse<TasmotaDriver>("{\"power\":12.3,\"relay\":true}"));
+  TEST_ASSERT_FALSE(parse<MyStromDriver>("{\"output\":true,\"apower\":1}"));
+}
+
+static void test_truncated_body_is_an_error() {
+  TEST_ASSERT_FALSE(parse<MyStromDriver>("{\"power\":12.34,\"relay\":tr"));
+  TEST_ASSERT_NOT_NULL(result.error);
+  TEST_ASSERT_FALSE(parse<MyStromDriver>(""));
+  TEST_ASSERT_NOT_NULL(result.error);
+}
+
+static void test_pool_is_reused_across_reports() {
+  // Every parse starts over in the same pool, nothing accumulates
+  for (int i = 0; i < 200; i++) {
+    TEST_ASSERT_TRUE(parse<MyStromDriver>(
+        "{\"power\":1.5,\"relay\":true,\"boot_id\":\"0123456789012345678901234567890\"}"));
+  }
+  TEST_ASSERT_EQUAL_STRING("0123456789012345678901234567890", result.report.bootId);
+}
+
+/**
+ * @brief Parse one report, counting the heap allocations of parseReport() alone
+ * @return Pool bytes the report took
+ */
+template <typename Driver>
+static size_t poolUsed(const char* body, size_t& heap) {
+  JsonDocument filter;
+  Driver::initFilter(filter);
+  memset(&result, 0, sizeof(result));
+  BodyStream stream(body);
+  size_t before = heapAllocs;
+  bool ok = parseReport<Driver>(allocator, filter, stream, result);
+  heap += heapAllocs - before;
+  return ok ? allocator.used() : 0;
+}
+
+static void test_pool_high_water_per_driver() {
+  // Host pointers are 64-bit, the ESP32's slots and string nodes are smaller
+  const size_t limit = RELAY_REPORT_POOL_SIZE * 3 / 4;
+  String gen1 = shellyGen1Status();
+  size_t heap = 0;
+  const size_t used[] = {
+    poolUsed<MyStromDriver>(MYSTROM_REPORT, heap),
+    poolUsed<ShellyGen1Driver>(gen1.c_str(), heap),
+    poolUsed<ShellyGen2Driver>(SHELLY_GEN2_REPORT, heap),
+    poolUsed<TasmotaDriver>(TASMOTA_REPORT, heap),
+  };
+  printf("  pool high-water of %u bytes: myStrom %u, Shelly Gen1 %u, Shelly Gen2 %u, Tasmota %u\n",
+         (unsigned)RELAY_REPORT_POOL_SIZE, (unsigned)used[0], (unsigned)used[1], (unsigned)used[2],
+         (unsigned)used[3]);
+  TEST_ASSERT_EQUAL_size_t(0, heap);
+  for (size_t u : used) {
+    TEST_ASSERT_GREATER_THAN(0, u);  // 0 = parse failed
+    TEST_ASSERT_LESS_THAN(limit, u);
+  }
+}
+
+static void test_heap_and_time_against_string_path() {
+  // Before the streamed parse: the body was read into a String and parsed
+  // unfiltered into a heap JsonDocument
+  const int runs = 200;
+  String gen1 = shellyGen1Status();
+  JsonDocument filter;
+  ShellyGen1Driver::initFilter(filter);
+
+  auto t0 = std::chrono::steady_clock::now();
+  size_t heapBefore = heapAllocs;
+  for (int i = 0; i < runs; i++) {
+    BodyStream stream(gen1.c_str());
+    TEST_ASSERT_TRUE(parseReport<ShellyGen1Driver>(allocator, filter, stream, result));
+  }
+  size_t streamedHeap = heapAllocs - heapBefore;
+  auto t1 = std::chrono::steady_clock::now();
+
+  CountingHeapAllocator heap;
+  heapBefore = heapAllocs;
+  for (int i = 0; i < runs; i++) {
+    String payload(gen1.c_str(), gen1.length());  // http.getString()
+    JsonDocument doc(&heap);
+    TEST_ASSERT_FALSE(deserializeJson(doc, payload));
+    TEST_ASSERT_TRUE(ShellyGen1Driver::parse(doc, result.report));
+  }
+  size_t stringHeap = heapAllocs - heapBefore + heap.calls;
+  auto t2 = std::chrono::steady_clock::now();
+
+  auto us = [](std::chrono::steady_clock::duration d) {
+    return (unsigned)std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+  };
+  printf("  %u-byte Shelly Gen1 status, %d parses: streamed %u us, 0 heap allocations; "
+         "String + full document %u us, %u heap allocations (%u bytes)\n",
+         gen1.length(), runs, us(t1 - t0), us(t2 - t1), (unsigned)stringHeap,
+         (unsigned)(heap.bytes + runs * gen1.length()));
+  TEST_ASSERT_EQUAL_size_t(0, streamedHeap);
+  TEST_ASSERT_GREATER_OR_EQUAL(2 * runs, stringHeap);  // At least the body and the document
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_mystrom_report);
+  RUN_TEST(test_shelly_gen1_status_streamed_through_filter);
+  RUN_TEST(test_shelly_gen2_switch_status);
+  RUN_TEST(test_tasmota_status0);
+  RUN_TEST(test_lifetime_counters_keep_watt_hour_resolution);
+  RUN_TEST(test_wrong_driver_is_rejected);
+  RUN_TEST(test_truncated_body_is_an_error);
+  RUN_TEST(test_pool_is_reused_across_reports);
+  RUN_TEST(test_pool_high_water_per_driver);
+  RUN_TEST(test_heap_and_time_against_string_path);
+  return UNITY_END();
+}
@@ -0,0 +1,116 @@
+/**
+ * @file test_main.cpp
+ * @brief Band lookup and cost integration of a low tariff window over midnight
+ *
+ * Schedule: low tariff 22:00 to 06:00 at 0.20, high tariff 0.30 otherwise,
+ * local time UTC. A printer drawing 1 kW from 21:00 to 07:00 uses 1 kWh in
+ * the high band before 22:00, 8 kWh in the low band and 1 kWh in the high
+ * band after 06:00: 0.30 + 1.60 + 0.30 = 2.20.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <stdlib.h>
+#include "Tariff.h"
+
+constexpr float  PRICE_HIGH = 0.30f;
+constexpr float  PRICE_LOW  = 0.20f;
+constexpr time_t DAY        = 1704844800;  ///< Wednesday 2024-01-10 00:00 UTC
+constexpr time_t HOUR       = 3600;
+constexpr float  POWER_W    = 1000.0f;
+
+/**
+ * @brief Energy counter of a constant POWER_W load started at 21:00
+ */
+static float energyAt(time_t now) {
+  return (float)((double)(now - (DAY + 21 * HOUR)) * POWER_W / 3600.0);
+}
+
+void setUp() {
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  tariffLoad(PRICE_HIGH, PRICE_LOW, 22, 6);  // The stub NVS is empty: daily window
+}
+
+void tearDown() {}
+
+static void test_band_boundaries() {
+  TariffBand band = tariffBandAt(DAY + 21 * HOUR + 59 * 60);
+  TEST_ASSERT_FALSE(band.low);
+  TEST_ASSERT_EQUAL_FLOAT(PRICE_HIGH, band.price);
+  TEST_ASSERT_EQUAL_INT32(22 * HOUR, band.until - DAY);
+
+  band = tariffBandAt(DAY + 22 * HOUR);
+  TEST_ASSERT_TRUE(band.low);
+  TEST_ASSERT_EQUAL_FLOAT(PRICE_LOW, band.price);
+  TEST_ASSERT_EQUAL_INT32(30 * HOUR, band.until - DAY);  // 06:00 the next day
+
+  band = tariffBandAt(DAY + 30 * HOUR);
+  TEST_ASSERT_FALSE(band.low);
+  TEST_ASSERT_EQUAL_INT32(46 * HOUR, band.until - DAY);
+}
+
+static void test_overnight_session_at_log_interval() {
+  TariffCostMeter meter;
+  time_t start = DAY + 21 * HOUR;
+  meter.reset(energyAt(start), start);
+  TEST_ASSERT_FALSE(meter.lowTariff());
+
+  float cost = 0;
+  for (time_t now = start + 10; now <= DAY + 31 * HOUR; now += 10) {
+    cost = meter.add(energyAt(now), now);
+    if (now == DAY + 23 * HOUR) {
+      TEST_ASSERT_TRUE(meter.lowTariff());
+      TEST_ASSERT_FLOAT_WITHIN(0.001f, PRICE_HIGH + PRICE_LOW, cost);
+    }
+  }
+  TEST_ASSERT_FALSE(meter.lowTariff());
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 2 * PRICE_HIGH + 8 * PRICE_LOW, cost);
+}
+
+static void test_interval_straddling_the_switch_is_split() {
+  // Samples at 21:50 and 22:20: 1/3 of the energy at the high price, 2/3 low
+  TariffCostMeter meter;
+  meter.reset(0, DAY + 21 * HOUR + 50 * 60);
+  float cost = meter.add(300.0f, DAY + 22 * HOUR + 20 * 60);
+  TEST_ASSERT_FLOAT_WITHIN(0.00001f, (100.0f * PRICE_HIGH + 200.0f * PRICE_LOW) / 1000.0f, cost);
+  TEST_ASSERT_TRUE(meter.lowTariff());
+}
+
+static void test_gap_over_both_switches_is_split() {
+  // No sample between 21:00 and 07:00 (e.g. WiFi lost): same cost as logged every 10 s
+  TariffCostMeter meter;
+  meter.reset(energyAt(DAY + 21 * HOUR), DAY + 21 * HOUR);
+  float cost = meter.add(energyAt(DAY + 31 * HOUR), DAY + 31 * HOUR);
+  TEST_ASSERT_FLOAT_WITHIN(0.0001f, 2 * PRICE_HIGH + 8 * PRICE_LOW, cost);
+}
+
+static void test_clock_set_during_session() {
+  // Uptime seconds before NTP, then the real time inside the low band
+  TariffCostMeter meter;
+  meter.reset(0, 120);
+  TEST_ASSERT_FALSE(meter.lowTariff());
+  float cost = meter.add(500.0f, DAY + 23 * HOUR);
+  TEST_ASSERT_FLOAT_WITHIN(0.00001f, 500.0f * PRICE_LOW / 1000.0f, cost);
+  TEST_ASSERT_TRUE(meter.lowTariff());
+}
+
+static void test_counter_going_back_adds_nothing() {
+  TariffCostMeter meter;
+  meter.reset(1000.0f, DAY + 12 * HOUR);
+  float cost = meter.add(10.0f, DAY + 12 * HOUR + 10);  // Relay counter reset
+  TEST_ASSERT_FLOAT_WITHIN(0.000001f, 0.0f, cost);
+  cost = meter.add(110.0f, DAY + 12 * HOUR + 20);
+  TEST_ASSERT_FLOAT_WITHIN(0.00001f, 100.0f * PRICE_HIGH / 1000.0f, cost);
+}
+
+int main(int, char**) {
+  UNITY_BEGIN();
+  RUN_TEST(test_band_boundaries);
+  RUN_TEST(test_overnight_session_at_log_interval);
+  RUN_TEST(test_interval_straddling_the_switch_is_split);
+  RUN_TEST(test_gap_over_both_switches_is_split);
+  RUN_TEST(test_clock_set_during_session);
+  RUN_TEST(test_counter_going_back_adds_nothing);
+  return UNITY_END();
+}
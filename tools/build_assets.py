@@ -0,0 +1,181 @@
+"""
+Build the SPIFFS image contents from data/.
+
+PlatformIO pre-script: minifies the web UI, fingerprints app.js/style.css
+(app.<hash>.js) so browsers may cache them for good, gzips every file and
+writes assets.txt (served path + ETag per line) for WebAssets.cpp. The
+output directory is the project's data_dir (dist/, not in git).
+
+The same gzipped files are also written as C arrays to
+WebAssetsEmbedded.h in the build directory; firmware built with
+-DEMBED_WEB_ASSETS serves them from flash without touching SPIFFS.
+
+Also runs stand-alone: python tools/build_assets.py [out_dir [header]]
+"""
+
+import gzip
+import hashlib
+import os
+import re
+import shutil
+import sys
+
+SKIP_SUFFIXES = (".backup", "_backup.html")
+MIME_TYPES = {
+    ".html": "text/html", ".css": "text/css", ".js": "application/javascript",
+    ".json": "application/json", ".png": "image/png", ".jpg": "image/jpeg",
+    ".ico": "image/x-icon",
+}   # Same as getContentType() in WebUi.cpp
+FINGERPRINT = (".js", ".css")   # Referenced from index.html, cached forever
+MANIFEST = "assets.txt"
+
+
+def minify_js(text):
+    """Line based: drops indentation, blank lines and comment-only lines.
+    Lines inside multi-line template literals are kept verbatim."""
+    out = []
+    in_template = False
+    in_block = False
+    for line in text.splitlines():
+        stripped = line.strip()
+        if in_template:
+            out.append(line)
+        elif in_block:
+            if "*/" in stripped:
+                in_block = False
+            continue
+        elif stripped.startswith("/*"):
+            in_block = "*/" not in stripped
+            continue
+        elif not stripped or stripped.startswith("//"):
+            continue
+        else:
+            out.append(stripped)
+        # An odd number of unescaped backticks opens or closes a template literal
+        if re.sub(r"\\.", "", line).count("`") % 2:
+            in_template = not in_template
+    return "\n".join(out) + "\n"
+
+
+def minify_css(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"\s+", " ", text)
+    text = re.sub(r"\s*([{};,])\s*", r"\1", text)
+    text = re.sub(r":\s+", ":", text)
+    return text.replace(";}", "}").strip() + "\n"
+
+
+def minify_html(text):
+    text = re.sub(r"<!--.*?-->", "", text, flags=re.S)
+    lines = (line.strip() for line in text.splitlines())
+    return "\n".join(line for line in lines if line) + "\n"
+
+
+MINIFIERS = {".js": minify_js, ".css": minify_css, ".html": minify_html}
+
+
+def short_hash(data):
+    return hashlib.sha1(data).hexdigest()[:8]
+
+
+def fnv1a(text):
+    """32-bit FNV-1a, matches webAssetPathHash() in WebAssets.cpp"""
+    h = 0x811C9DC5
+    for b in text.encode("utf-8"):
+        h = ((h ^ b) * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def write_header(entries, path):
+    """entries: (served path, hash, gzipped bytes), one constexpr array each"""
+    lines = [
+        "// Generated by tools/build_assets.py from data/, do not edit\n",
+        "#pragma once\n",
+        "#include <stdint.h>\n\n",
+    ]
+    for i, (name, digest, gz) in enumerate(entries):
+        lines.append("alignas(4) constexpr uint8_t WEB_ASSET_DATA_%d[%d] = {\n" % (i, len(gz)))
+        for off in range(0, len(gz), 16):
+            lines.append("  " + ",".join("0x%02x" % b for b in gz[off:off + 16]) + ",\n")
+        lines.append("};\n\n")
+
+    lines.append("constexpr EmbeddedWebAsset EMBEDDED_WEB_ASSETS[] = {\n")
+    for i, (name, digest, gz) in enumerate(entries):
+        ext = os.path.splitext(name)[1]
+        lines.append('  { 0x%08xu, "%s", "\\"%s\\"", "%s", %s, WEB_ASSET_DATA_%d, %d },\n' % (
+            fnv1a(name), name, digest, MIME_TYPES.get(ext, "text/plain"),
+            "true" if digest in name else "false", i, len(gz)))
+    lines.append("};\n")
+
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "w") as f:
+        f.writelines(lines)
+
+
+def build(src_dir, out_dir, header=None):
+    if os.path.isdir(out_dir):
+        shutil.rmtree(out_dir)
+    os.makedirs(out_dir)
+
+    assets = {}     # Served name -> minified bytes
+    renames = {}    # Original name -> fingerprinted name
+    for name in sorted(os.listdir(src_dir)):
+        path = os.path.join(src_dir, name)
+        if not os.path.isfile(path) or name.endswith(SKIP_SUFFIXES):
+            continue
+        ext = os.path.splitext(name)[1]
+        with open(path, "rb") as f:
+            data = f.read()
+        if ext in MINIFIERS:
+            data = MINIFIERS[ext](data.decode("utf-8")).encode("utf-8")
+        if ext in FINGERPRINT:
+            base = os.path.splitext(name)[0]
+            renames[name] = "%s.%s%s" % (base, short_hash(data), ext)
+            name = renames[name]
+        assets[name] = data
+
+    # Point index.html at the fingerprinted names
+    for name in list(assets):
+        if name.endswith(".html"):
+            html = assets[name].decode("utf-8")
+            for old, new in renames.items():
+                html = html.replace("'/%s'" % old, "'/%s'" % new)
+                html = html.replace('"/%s"' % old, '"/%s"' % new)
+            assets[name] = html.encode("utf-8")
+
+    manifest = []
+    embedded = []
+    total_src = total_gz = 0
+    for name, data in sorted(assets.items()):
+        gz = gzip.compress(data, 9, mtime=0)
+        with open(os.path.join(out_dir, name + ".gz"), "wb") as f:
+            f.write(gz)
+        manifest.append("/%s %s\n" % (name, short_hash(data)))
+        embedded.append(("/" + name, short_hash(data), gz))
+        total_src += len(data)
+        total_gz += len(gz)
+        print("  /%-28s %7d -> %6d bytes" % (name, len(data), len(gz)))
+
+    with open(os.path.join(out_dir, MANIFEST), "w") as f:
+        f.writelines(manifest)
+    print("Web assets: %d bytes minified, %d bytes gzipped" % (total_src, total_gz))
+
+    if header:
+        write_header(embedded, header)
+
+
+def main(project_dir, out_dir, header=None):
+    print("Building web assets into %s" % out_dir)
+    build(os.path.join(project_dir, "data"), out_dir, header)
+
+
+if __name__ == "__main__":
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    main(root, sys.argv[1] if len(sys.argv) > 1 else os.path.join(root, "dist"),
+         sys.argv[2] if len(sys.argv) > 2 else None)
+else:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+    generated = os.path.join(env.subst("$BUILD_DIR"), "generated")  # noqa: F821
+    main(env.subst("$PROJECT_DIR"), env.subst("$PROJECT_DATA_DIR"),  # noqa: F821
+         os.path.join(generated, "WebAssetsEmbedded.h"))
+    env.Append(CPPPATH=[generated])  # noqa: F821